@@ -0,0 +1,150 @@
+#!/usr/bin/env python3
+# Plays a game to the end in every mode through the control socket of a
+# build with ALLOC_CHECK=1 (see `make alloc-check`). An allocation in one
+# of the checked sections aborts the game, so the check passes only if
+# the game exits cleanly and reports the sections it checked.
+#
+# Needs a display, run it under xvfb-run (or GDK_BACKEND=broadway).
+
+import json
+import os
+import socket
+import subprocess
+import sys
+import tempfile
+import time
+
+TIMEOUT = 30
+# Every third typed or chosen answer is wrong, so the correct location is shown.
+WRONG_ANSWER_PERIOD = 3
+
+
+class ControlError(Exception):
+    pass
+
+
+class Control:
+    def __init__(self, path):
+        self.socket = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self.socket.settimeout(TIMEOUT)
+        self.socket.connect(path)
+        self.input = self.socket.makefile("r", encoding="utf-8")
+        self.id = 0
+
+    def send(self, command, **arguments):
+        self.id += 1
+        arguments.update(id=self.id, command=command)
+        self.socket.sendall((json.dumps(arguments) + "\n").encode("utf-8"))
+
+        line = self.input.readline()
+        if not line:
+            raise ControlError("%s: the game exited" % command)
+
+        reply = json.loads(line)
+        if not reply.get("ok"):
+            raise ControlError("%s: %s" % (command, reply.get("error")))
+
+        return reply
+
+    def quit(self):
+        # The game may exit before the reply is written.
+        self.id += 1
+        self.socket.sendall((json.dumps({"id": self.id, "command": "quit"}) + "\n").encode("utf-8"))
+
+
+def wait_for_socket(path, process):
+    deadline = time.monotonic() + TIMEOUT
+
+    while not os.path.exists(path):
+        if process.poll() is not None or time.monotonic() > deadline:
+            raise ControlError("the control socket was not created")
+        time.sleep(0.1)
+
+
+def play(control, mode):
+    reply = control.send("start", mode=mode, difficulty="easy")
+    answer_count = 0
+
+    while reply["state"] != "showing_end_game_dialog":
+        if reply["state"] == "showing_correct_location":
+            time.sleep(0.1)
+            reply = control.send("state")
+            continue
+
+        city = reply["city"]
+        answer_count += 1
+        wrong = answer_count % WRONG_ANSWER_PERIOD == 0
+
+        if mode == "selection":
+            reply = control.send("click", city=city)
+        elif mode == "choice":
+            if wrong:
+                city = next((choice for choice in reply["choices"] if choice != city), city)
+            reply = control.send("choose", city=city)
+        elif wrong:
+            reply = control.send("type", text="?")
+        else:
+            reply = control.send("type", text=city)
+
+    print("%s: %d answers, %d correct" % (mode, answer_count, reply["correct_count"]))
+    control.send("stop")
+
+
+def main():
+    if len(sys.argv) != 2:
+        print("Usage: %s EXECUTABLE" % sys.argv[0], file=sys.stderr)
+        return 2
+
+    with tempfile.TemporaryDirectory() as directory:
+        # The leaderboard, the heatmap and the caches of the user are not touched.
+        environment = dict(os.environ)
+        for name in ("XDG_DATA_HOME", "XDG_CACHE_HOME", "XDG_CONFIG_HOME"):
+            environment[name] = os.path.join(directory, name.lower())
+
+        socket_path = os.path.join(directory, "control")
+        log = open(os.path.join(directory, "stderr.log"), "w+")
+        process = subprocess.Popen(
+            [
+                sys.argv[1],
+                "--control-socket", socket_path,
+                "--snapshot", os.path.join(directory, "game.snapshot"),
+                "--record", os.path.join(directory, "game.recording"),
+                "--telemetry", os.path.join(directory, "telemetry.jsonl"),
+            ],
+            env=environment,
+            stderr=log,
+        )
+
+        try:
+            wait_for_socket(socket_path, process)
+            control = Control(socket_path)
+
+            for mode in ("selection", "typing", "choice"):
+                play(control, mode)
+
+            control.quit()
+            process.wait(timeout=TIMEOUT)
+        except (ControlError, OSError, subprocess.TimeoutExpired) as error:
+            process.kill()
+            process.wait()
+            log.seek(0)
+            sys.stderr.write(log.read())
+            log.close()
+            print("alloc-check failed: %s" % error, file=sys.stderr)
+            return 1
+
+        log.seek(0)
+        errors = log.read()
+        log.close()
+
+    sys.stderr.write(errors)
+
+    if process.returncode != 0 or "sections checked" not in errors:
+        print("alloc-check failed: exit status %d" % process.returncode, file=sys.stderr)
+        return 1
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
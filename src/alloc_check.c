@@ -0,0 +1,113 @@
+#include <stddef.h>
+#include <errno.h>
+#include <glib.h>
+#include "alloc_check.h"
+
+// Interposes the allocation functions of glibc. The hooks only count the
+// allocations made while the calling thread is inside a checked section,
+// the memory itself always comes from the glibc allocator, so the other
+// threads (telemetry, watchdog) and the rest of the UI thread are not
+// affected.
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+
+static __thread const gchar *section_name = NULL;
+static __thread gsize allocation_count = 0;
+static __thread gsize allocation_size = 0;
+static gsize checked_count = 0;
+
+static inline void alloc_check_count(size_t size);
+
+void *malloc(size_t size) {
+    alloc_check_count(size);
+
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    alloc_check_count(count * size);
+
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    alloc_check_count(size);
+
+    return __libc_realloc(ptr, size);
+}
+
+void *memalign(size_t alignment, size_t size) {
+    alloc_check_count(size);
+
+    return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+    alloc_check_count(size);
+
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size) {
+    void *memory;
+
+    if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0) {
+        return EINVAL;
+    }
+
+    alloc_check_count(size);
+
+    memory = __libc_memalign(alignment, size);
+    if (memory == NULL) {
+        return ENOMEM;
+    }
+
+    *ptr = memory;
+
+    return 0;
+}
+
+void alloc_check_begin(const gchar *section) {
+    g_return_if_fail(section != NULL);
+    g_return_if_fail(section_name == NULL);
+
+    allocation_count = 0;
+    allocation_size = 0;
+    section_name = section;
+}
+
+void alloc_check_end(void) {
+    const gchar *section;
+
+    g_return_if_fail(section_name != NULL);
+
+    // Disarmed first, g_error allocates.
+    section = section_name;
+    section_name = NULL;
+    checked_count++;
+
+    if (allocation_count > 0) {
+        g_error(
+            "alloc-check: %" G_GSIZE_FORMAT " allocations (%" G_GSIZE_FORMAT
+            " bytes) in %s",
+            allocation_count, allocation_size, section
+        );
+    }
+}
+
+void alloc_check_report(void) {
+    g_printerr(
+        "alloc-check: %" G_GSIZE_FORMAT " sections checked, no allocations\n",
+        checked_count
+    );
+}
+
+static inline void alloc_check_count(size_t size) {
+    if (section_name != NULL) {
+        allocation_count++;
+        allocation_size += size;
+    }
+}
@@ -0,0 +1,24 @@
+#ifndef ALLOC_CHECK_H
+#define ALLOC_CHECK_H
+
+#include <glib.h>
+
+// Built with `make ALLOC_CHECK=1` the allocator is hooked and every heap
+// allocation made by the UI thread between ALLOC_CHECK_BEGIN and
+// ALLOC_CHECK_END aborts the program, naming the section. Otherwise the
+// macros expand to nothing.
+#ifdef ALLOC_CHECK
+void alloc_check_begin(const gchar *section);
+void alloc_check_end(void);
+void alloc_check_report(void);
+
+#define ALLOC_CHECK_BEGIN(section) alloc_check_begin(section)
+#define ALLOC_CHECK_END() alloc_check_end()
+#define ALLOC_CHECK_REPORT() alloc_check_report()
+#else
+#define ALLOC_CHECK_BEGIN(section) ((void) 0)
+#define ALLOC_CHECK_END() ((void) 0)
+#define ALLOC_CHECK_REPORT() ((void) 0)
+#endif
+
+#endif
@@ -0,0 +1,90 @@
+#include <gtk/gtk.h>
+#include "asset_cache.h"
+
+#define ASSETS_PATH "/ns/dragi/gradovi-srbije/assets"
+#define MAX_ASSET_SCALE 3
+
+// "<name>@<scale>x" -> cairo_surface_t, the surfaces are created once
+// for every scale factor and shared by all of the widgets.
+static GHashTable *surfaces = NULL;
+// Pixel data of all of the surfaces, in bytes.
+static gsize surfaces_size = 0;
+
+static cairo_surface_t *asset_cache_load_surface(const gchar *key, gint scale);
+static void asset_cache_surface_free(gpointer user_data);
+
+cairo_surface_t *asset_cache_get_surface(const gchar *name, gint scale) {
+    g_return_val_if_fail(name != NULL, NULL);
+
+    gchar *key;
+    cairo_surface_t *surface;
+
+    scale = CLAMP(scale, 1, MAX_ASSET_SCALE);
+
+    if (surfaces == NULL) {
+        surfaces = g_hash_table_new_full(
+            g_str_hash, g_str_equal,
+            g_free, asset_cache_surface_free
+        );
+    }
+
+    key = g_strdup_printf("%s@%dx", name, scale);
+    surface = (cairo_surface_t *) g_hash_table_lookup(surfaces, key);
+
+    if (surface == NULL) {
+        surface = asset_cache_load_surface(key, scale);
+        if (surface == NULL) {
+            g_free(key);
+            return NULL;
+        }
+
+        g_hash_table_insert(surfaces, key, surface);
+        surfaces_size += (gsize) cairo_image_surface_get_stride(surface) *
+                         (gsize) cairo_image_surface_get_height(surface);
+    } else {
+        g_free(key);
+    }
+
+    return surface;
+}
+
+void asset_cache_clear(void) {
+    if (surfaces != NULL) {
+        g_hash_table_destroy(surfaces);
+        surfaces = NULL;
+        surfaces_size = 0;
+    }
+}
+
+gsize asset_cache_get_memory_size(void) {
+    return surfaces_size;
+}
+
+static cairo_surface_t *asset_cache_load_surface(const gchar *key, gint scale) {
+    gchar *path;
+    GdkPixbuf *pixbuf;
+    GError *error = NULL;
+    cairo_surface_t *surface;
+
+    path = g_strdup_printf(ASSETS_PATH "/%s", key);
+    pixbuf = gdk_pixbuf_new_from_resource(path, &error);
+    g_free(path);
+
+    if (error != NULL) {
+        g_printerr("%s\n", error->message);
+
+        g_error_free(error);
+        return NULL;
+    }
+
+    // The device scale keeps the logical size of the surface the same
+    // for every variant, GTK then draws it without any resampling.
+    surface = gdk_cairo_surface_create_from_pixbuf(pixbuf, scale, NULL);
+    g_object_unref(G_OBJECT(pixbuf));
+
+    return surface;
+}
+
+static void asset_cache_surface_free(gpointer user_data) {
+    cairo_surface_destroy((cairo_surface_t *) user_data);
+}
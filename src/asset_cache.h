@@ -0,0 +1,10 @@
+#ifndef ASSET_CACHE_H
+#define ASSET_CACHE_H
+
+#include <gtk/gtk.h>
+
+cairo_surface_t *asset_cache_get_surface(const gchar *name, gint scale);
+void asset_cache_clear(void);
+gsize asset_cache_get_memory_size(void);
+
+#endif
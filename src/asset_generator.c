@@ -0,0 +1,169 @@
+#include <stdlib.h>
+#include <glib.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+// Renders the images listed in the assets manifest (resources/assets.ini)
+// for every supported scale factor at build time, so that nothing has to
+// be resampled while the game is running. The images are saved as
+// OUTPUT_DIR/<alias>@<scale>x.png, together with the assets.gresource.xml
+// used to bundle them.
+
+#define ASSETS_PREFIX "/ns/dragi/gradovi-srbije/assets"
+
+static gboolean save_image(const gchar *alias, const gchar *source_path,
+                           gint height, gint *scales, gsize scales_count,
+                           const gchar *output_dir, GString *gresource_xml
+);
+
+int main(int argc, char *argv[]) {
+    gsize i;
+    gint height;
+    gint *scales;
+    gsize scales_count;
+    gchar **aliases;
+    gchar *source_dir, *source_name, *source_path, *path;
+    gboolean saved;
+    GString *gresource_xml;
+    GKeyFile *manifest;
+    GError *error = NULL;
+
+    if (argc < 3) {
+        g_printerr("Usage: %s MANIFEST OUTPUT_DIR\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    manifest = g_key_file_new();
+    g_key_file_load_from_file(manifest, argv[1], G_KEY_FILE_NONE, &error);
+
+    if (error != NULL) {
+        g_printerr("%s\n", error->message);
+
+        g_error_free(error);
+        g_key_file_free(manifest);
+        exit(EXIT_FAILURE);
+    }
+
+    source_dir = g_key_file_get_string(manifest, "assets", "source_dir", NULL);
+    height = g_key_file_get_integer(manifest, "assets", "height", NULL);
+    scales = g_key_file_get_integer_list(manifest, "assets", "scales", &scales_count, NULL);
+    aliases = g_key_file_get_keys(manifest, "images", NULL, NULL);
+
+    if (source_dir == NULL || height <= 0 || scales == NULL || aliases == NULL) {
+        g_printerr("%s: invalid manifest!\n", argv[1]);
+
+        g_free(source_dir);
+        g_free(scales);
+        g_strfreev(aliases);
+        g_key_file_free(manifest);
+        exit(EXIT_FAILURE);
+    }
+
+    if (g_mkdir_with_parents(argv[2], 0755) != 0) {
+        g_printerr("Could not create %s!\n", argv[2]);
+        exit(EXIT_FAILURE);
+    }
+
+    gresource_xml = g_string_new(
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<gresources>\n"
+        "  <gresource prefix=\"" ASSETS_PREFIX "\">\n"
+    );
+
+    saved = TRUE;
+    for (i = 0; aliases[i] != NULL && saved; i++) {
+        source_name = g_key_file_get_string(manifest, "images", aliases[i], NULL);
+        source_path = g_build_filename(source_dir, source_name, NULL);
+
+        saved = save_image(
+            aliases[i], source_path, height, scales, scales_count,
+            argv[2], gresource_xml
+        );
+
+        g_free(source_path);
+        g_free(source_name);
+    }
+
+    g_string_append(gresource_xml, "  </gresource>\n</gresources>\n");
+
+    if (saved) {
+        path = g_build_filename(argv[2], "assets.gresource.xml", NULL);
+        saved = g_file_set_contents(path, gresource_xml->str, -1, &error);
+        g_free(path);
+
+        if (error != NULL) {
+            g_printerr("%s\n", error->message);
+            g_error_free(error);
+        }
+    }
+
+    g_string_free(gresource_xml, TRUE);
+    g_strfreev(aliases);
+    g_free(scales);
+    g_free(source_dir);
+    g_key_file_free(manifest);
+
+    exit(saved ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+static gboolean save_image(const gchar *alias, const gchar *source_path,
+                           gint height, gint *scales, gsize scales_count,
+                           const gchar *output_dir, GString *gresource_xml
+) {
+    gsize i;
+    gint scaled_width, scaled_height;
+    gchar *name, *path, *escaped_name;
+    gboolean saved;
+    GdkPixbuf *source, *scaled;
+    GError *error = NULL;
+
+    source = gdk_pixbuf_new_from_file(source_path, &error);
+    if (error != NULL) {
+        g_printerr("%s\n", error->message);
+
+        g_error_free(error);
+        return FALSE;
+    }
+
+    saved = TRUE;
+    for (i = 0; i < scales_count && saved; i++) {
+        scaled_height = height * scales[i];
+        scaled_width = MAX(
+            1,
+            (gdk_pixbuf_get_width(source) * scaled_height +
+             gdk_pixbuf_get_height(source) / 2) / gdk_pixbuf_get_height(source)
+        );
+
+        scaled = gdk_pixbuf_scale_simple(
+            source,
+            scaled_width,
+            scaled_height,
+            GDK_INTERP_HYPER
+        );
+
+        name = g_strdup_printf("%s@%dx", alias, scales[i]);
+        path = g_strdup_printf("%s/%s.png", output_dir, name);
+
+        saved = gdk_pixbuf_save(scaled, path, "png", &error, NULL);
+        if (error != NULL) {
+            g_printerr("%s\n", error->message);
+            g_error_free(error);
+            error = NULL;
+        }
+
+        escaped_name = g_markup_escape_text(name, -1);
+        g_string_append_printf(
+            gresource_xml,
+            "    <file alias=\"%s\">%s.png</file>\n",
+            escaped_name, escaped_name
+        );
+
+        g_free(escaped_name);
+        g_free(path);
+        g_free(name);
+        g_object_unref(G_OBJECT(scaled));
+    }
+
+    g_object_unref(G_OBJECT(source));
+
+    return saved;
+}
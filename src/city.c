@@ -1,13 +1,36 @@
+#include <string.h>
 #include <glib.h>
 #include "city.h"
 #include "map_point.h"
+#include "transliteration.h"
 
 struct city_t {
     gchar *name;
     gchar *description;
     Map_point *map_point;
+
+    // Lower case name in both scripts, built once so that the answers and
+    // the completion are matched without transliterating the input. The
+    // ASCII key has the same characters as the Latin key, without the
+    // diacritics.
+    gchar *latin_key;
+    gchar *ascii_key;
+    gchar *cyrillic_key;
+    // The keys point into an index cache, they are not freed.
+    gboolean borrowed_keys;
 };
 
+// The cities and their own strings, in bytes. The cities are only
+// created and changed on the main thread.
+static gsize allocated_size = 0;
+
+static gsize city_get_memory_size(City *city);
+static void city_build_keys(City *city);
+static void city_free_keys(City *city);
+static gboolean city_key_has_prefix(const gchar *key, const gchar *ascii_key,
+                                    const gchar *word, const gchar *word_end
+);
+
 City *city_create(const gchar *name, const gchar *description,
                   Map_point *map_point
 ) {
@@ -15,15 +38,37 @@ City *city_create(const gchar *name, const gchar *description,
     city->name = g_strdup(name);
     city->description = g_strdup(description);
     city->map_point = map_point;
+    city_build_keys(city);
+    allocated_size += city_get_memory_size(city);
+    return city;
+}
+
+City *city_create_with_keys(const gchar *name, const gchar *description,
+                            Map_point *map_point, const gchar *latin_key,
+                            const gchar *ascii_key, const gchar *cyrillic_key
+) {
+    City *city = g_slice_new(City);
+    city->name = g_strdup(name);
+    city->description = g_strdup(description);
+    city->map_point = map_point;
+    city->latin_key = (gchar *) latin_key;
+    city->ascii_key = (gchar *) ascii_key;
+    city->cyrillic_key = (gchar *) cyrillic_key;
+    city->borrowed_keys = TRUE;
+    allocated_size += city_get_memory_size(city);
     return city;
 }
 
 void city_destroy(City *city) {
     g_return_if_fail(city != NULL);
 
+    allocated_size -= city_get_memory_size(city);
     g_free(city->name);
     g_free(city->description);
-    map_point_destroy(city->map_point);
+    city_free_keys(city);
+    if (city->map_point != NULL) {
+        map_point_destroy(city->map_point);
+    }
     g_slice_free(City, city);
 }
 
@@ -36,11 +81,18 @@ gchar *city_get_name(City *city) {
 void city_set_name(City *city, const gchar *name) {
     g_return_if_fail(city != NULL);
 
+    allocated_size -= city_get_memory_size(city);
+
     if (city->name != NULL) {
         g_free(city->name);
     }
 
     city->name = g_strdup(name);
+
+    city_free_keys(city);
+    city_build_keys(city);
+
+    allocated_size += city_get_memory_size(city);
 }
 
 gchar *city_get_description(City *city) {
@@ -52,11 +104,15 @@ gchar *city_get_description(City *city) {
 void city_set_description(City *city, const gchar *description) {
     g_return_if_fail(city != NULL);
 
+    allocated_size -= city_get_memory_size(city);
+
     if (city->description != NULL) {
         g_free(city->description);
     }
 
     city->description = g_strdup(description);
+
+    allocated_size += city_get_memory_size(city);
 }
 
 Map_point *city_get_map_point(City *city) {
@@ -74,3 +130,182 @@ void city_set_map_point(City *city, Map_point *map_point) {
 
     city->map_point = map_point;
 }
+
+Map_point *city_steal_map_point(City *city) {
+    g_return_val_if_fail(city != NULL, NULL);
+
+    Map_point *map_point;
+
+    // The caller becomes the owner of the map point.
+    map_point = city->map_point;
+    city->map_point = NULL;
+
+    return map_point;
+}
+
+const gchar *city_get_latin_key(City *city) {
+    g_return_val_if_fail(city != NULL, NULL);
+
+    return city->latin_key;
+}
+
+const gchar *city_get_ascii_key(City *city) {
+    g_return_val_if_fail(city != NULL, NULL);
+
+    return city->ascii_key;
+}
+
+const gchar *city_get_cyrillic_key(City *city) {
+    g_return_val_if_fail(city != NULL, NULL);
+
+    return city->cyrillic_key;
+}
+
+gboolean city_matches_name(City *city, const gchar *name) {
+    g_return_val_if_fail(city != NULL, FALSE);
+    g_return_val_if_fail(name != NULL, FALSE);
+
+    const gchar *key;
+
+    key = transliteration_is_cyrillic(name) ? city->cyrillic_key : city->latin_key;
+
+    while (*key != '\0' && *name != '\0') {
+        if (g_utf8_get_char(key) != g_unichar_tolower(g_utf8_get_char(name))) {
+            return FALSE;
+        }
+
+        key = g_utf8_next_char(key);
+        name = g_utf8_next_char(name);
+    }
+
+    return *key == '\0' && *name == '\0';
+}
+
+gboolean city_matches_search(City *city, const gchar *search) {
+    g_return_val_if_fail(city != NULL, FALSE);
+    g_return_val_if_fail(search != NULL, FALSE);
+
+    gboolean cyrillic, found;
+    const gchar *key, *ascii_key;
+    const gchar *word, *word_end;
+
+    cyrillic = transliteration_is_cyrillic(search);
+
+    // Every word of the search has to be a prefix of a word of the name,
+    // the Latin words may be typed without the diacritics.
+    for (word = search; *word != '\0'; word = word_end) {
+        if (!g_unichar_isalnum(g_utf8_get_char(word))) {
+            word_end = g_utf8_next_char(word);
+            continue;
+        }
+
+        word_end = word;
+        while (*word_end != '\0' && g_unichar_isalnum(g_utf8_get_char(word_end))) {
+            word_end = g_utf8_next_char(word_end);
+        }
+
+        key = cyrillic ? city->cyrillic_key : city->latin_key;
+        ascii_key = cyrillic ? NULL : city->ascii_key;
+        found = FALSE;
+
+        while (*key != '\0' && !found) {
+            found = city_key_has_prefix(key, ascii_key, word, word_end);
+
+            // The start of the next word of the name.
+            while (*key != '\0' && g_unichar_isalnum(g_utf8_get_char(key))) {
+                key = g_utf8_next_char(key);
+                ascii_key = ascii_key != NULL ? g_utf8_next_char(ascii_key) : NULL;
+            }
+            while (*key != '\0' && !g_unichar_isalnum(g_utf8_get_char(key))) {
+                key = g_utf8_next_char(key);
+                ascii_key = ascii_key != NULL ? g_utf8_next_char(ascii_key) : NULL;
+            }
+        }
+
+        if (!found) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+gsize city_get_allocated_size(void) {
+    return allocated_size;
+}
+
+void city_compute_keys(const gchar *name, gchar **latin_key, gchar **ascii_key,
+                       gchar **cyrillic_key
+) {
+    g_return_if_fail(name != NULL);
+
+    *latin_key = transliteration_to_latin(name);
+    *ascii_key = transliteration_strip_diacritics(*latin_key);
+    *cyrillic_key = transliteration_to_cyrillic(name);
+}
+
+static gsize city_get_memory_size(City *city) {
+    guint i;
+    gsize size;
+    const gchar *strings[] = {
+        city->name, city->description,
+        city->latin_key, city->ascii_key, city->cyrillic_key
+    };
+
+    // The map point is owned by the widgets, it is not counted. Neither
+    // are the borrowed keys, they are counted with their index cache.
+    size = sizeof(City);
+    for (i = 0; i < (city->borrowed_keys ? 2 : G_N_ELEMENTS(strings)); i++) {
+        if (strings[i] != NULL) {
+            size += strlen(strings[i]) + 1;
+        }
+    }
+
+    return size;
+}
+
+static void city_build_keys(City *city) {
+    city->borrowed_keys = FALSE;
+
+    if (city->name == NULL) {
+        city->latin_key = NULL;
+        city->ascii_key = NULL;
+        city->cyrillic_key = NULL;
+        return;
+    }
+
+    city_compute_keys(city->name, &city->latin_key, &city->ascii_key, &city->cyrillic_key);
+}
+
+static void city_free_keys(City *city) {
+    if (city->borrowed_keys) {
+        return;
+    }
+
+    g_free(city->latin_key);
+    g_free(city->ascii_key);
+    g_free(city->cyrillic_key);
+}
+
+static gboolean city_key_has_prefix(const gchar *key, const gchar *ascii_key,
+                                    const gchar *word, const gchar *word_end
+) {
+    gunichar c;
+
+    for (; word < word_end; word = g_utf8_next_char(word)) {
+        if (*key == '\0') {
+            return FALSE;
+        }
+
+        c = g_unichar_tolower(g_utf8_get_char(word));
+        if (c != g_utf8_get_char(key) &&
+            (ascii_key == NULL || c != g_utf8_get_char(ascii_key))) {
+            return FALSE;
+        }
+
+        key = g_utf8_next_char(key);
+        ascii_key = ascii_key != NULL ? g_utf8_next_char(ascii_key) : NULL;
+    }
+
+    return TRUE;
+}
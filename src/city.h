@@ -9,6 +9,10 @@ typedef struct city_t City;
 City *city_create(const gchar *name, const gchar *description,
                   Map_point *map_point
 );
+City *city_create_with_keys(const gchar *name, const gchar *description,
+                            Map_point *map_point, const gchar *latin_key,
+                            const gchar *ascii_key, const gchar *cyrillic_key
+);
 void city_destroy(City *city);
 gchar *city_get_name(City *city);
 void city_set_name(City *city, const gchar *name);
@@ -16,5 +20,15 @@ gchar *city_get_description(City *city);
 void city_set_description(City *city, const gchar *description);
 Map_point *city_get_map_point(City *city);
 void city_set_map_point(City *city, Map_point *map_point);
+Map_point *city_steal_map_point(City *city);
+const gchar *city_get_latin_key(City *city);
+const gchar *city_get_ascii_key(City *city);
+const gchar *city_get_cyrillic_key(City *city);
+gboolean city_matches_name(City *city, const gchar *name);
+gboolean city_matches_search(City *city, const gchar *search);
+gsize city_get_allocated_size(void);
+void city_compute_keys(const gchar *name, gchar **latin_key, gchar **ascii_key,
+                       gchar **cyrillic_key
+);
 
 #endif
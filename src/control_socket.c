@@ -0,0 +1,481 @@
+#include <string.h>
+#include <gtk/gtk.h>
+#include <glib/gstdio.h>
+#include <json-glib/json-glib.h>
+#ifdef G_OS_UNIX
+#include <sys/stat.h>
+#include <gio/gunixsocketaddress.h>
+#endif
+#include "control_socket.h"
+
+// Upper bound for waiting on the frame that shows the result of a command,
+// the frame clock does not run while the window is iconified.
+#define CONTROL_SOCKET_FRAME_TIMEOUT 1000
+
+// Local (Unix domain) socket that accepts one JSON object per line:
+//
+//   {"id": 1, "command": "start", ...}
+//
+// The connections are served on the main loop, so the commands run
+// exactly like the signal handlers of the user interface. The commands of
+// a connection are executed one at a time, the next line is read only
+// after the reply to the previous one has been written:
+//
+//   {"id": 1, "command": "start", "ok": true, ..., "handler_us": 850, "latency_us": 16400}
+//
+// handler_us is the time spent in the command itself and latency_us the
+// time until the first frame showing its result was painted.
+typedef struct control_socket_command_t {
+    Control_socket_func func;
+    gpointer user_data;
+} Control_socket_command;
+
+struct control_socket_t {
+    GSocketService *service;
+    gchar *path;
+    GtkWidget *window;
+    GHashTable *commands;
+    GList *connections;
+};
+
+typedef struct control_socket_connection_t {
+    Control_socket *control_socket;
+    GSocketConnection *connection;
+    GDataInputStream *input;
+    GCancellable *cancellable;
+    // An asynchronous read or write is in progress.
+    gboolean pending;
+    gboolean closed;
+
+    JsonBuilder *builder;
+    gchar *reply;
+    gint64 start_time;
+    gint64 handler_time;
+    GdkFrameClock *frame_clock;
+    gulong after_paint_id;
+    guint timeout_id;
+} Control_socket_connection;
+
+static gboolean control_socket_on_incoming(G_GNUC_UNUSED GSocketService *service,
+                                           GSocketConnection *connection,
+                                           G_GNUC_UNUSED GObject *source_object,
+                                           gpointer user_data
+);
+static void control_socket_read_command(Control_socket_connection *connection);
+static void control_socket_on_line_read(GObject *source_object, GAsyncResult *result,
+                                        gpointer user_data
+);
+static void control_socket_execute(Control_socket_connection *connection, const gchar *line);
+static void control_socket_on_after_paint(G_GNUC_UNUSED GdkFrameClock *frame_clock,
+                                          gpointer user_data
+);
+static gboolean control_socket_on_frame_timeout(gpointer user_data);
+static void control_socket_send_reply(Control_socket_connection *connection);
+static void control_socket_on_reply_written(GObject *source_object, GAsyncResult *result,
+                                            gpointer user_data
+);
+static void control_socket_stop_waiting(Control_socket_connection *connection);
+static void control_socket_close(Control_socket_connection *connection);
+static void control_socket_connection_free(Control_socket_connection *connection);
+
+Control_socket *control_socket_create(const gchar *path, GtkWidget *window, GError **error) {
+    g_return_val_if_fail(path != NULL, NULL);
+    g_return_val_if_fail(GTK_IS_WIDGET(window), NULL);
+
+#ifdef G_OS_UNIX
+    GStatBuf stat_buf;
+    GSocketAddress *address;
+    Control_socket *control_socket;
+
+    // Left behind by a previous run that did not exit cleanly.
+    if (g_lstat(path, &stat_buf) == 0 && S_ISSOCK(stat_buf.st_mode)) {
+        g_unlink(path);
+    }
+
+    control_socket = g_slice_new0(Control_socket);
+    control_socket->service = g_socket_service_new();
+    control_socket->path = g_strdup(path);
+    control_socket->window = g_object_ref(window);
+    control_socket->commands = g_hash_table_new_full(
+        g_str_hash, g_str_equal,
+        g_free, g_free
+    );
+
+    address = g_unix_socket_address_new(path);
+    if (!g_socket_listener_add_address(
+            G_SOCKET_LISTENER(control_socket->service), address,
+            G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_DEFAULT,
+            NULL, NULL, error)) {
+        g_object_unref(G_OBJECT(address));
+
+        // Nothing was created, so the path must not be removed.
+        g_clear_pointer(&control_socket->path, g_free);
+        control_socket_destroy(control_socket);
+        return NULL;
+    }
+    g_object_unref(G_OBJECT(address));
+
+    g_signal_connect(
+        control_socket->service, "incoming",
+        G_CALLBACK(control_socket_on_incoming), control_socket
+    );
+    g_socket_service_start(control_socket->service);
+
+    return control_socket;
+#else
+    g_set_error(
+        error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+        "Control sockets are not supported on this platform"
+    );
+    return NULL;
+#endif
+}
+
+void control_socket_destroy(Control_socket *control_socket) {
+    g_return_if_fail(control_socket != NULL);
+
+    g_socket_service_stop(control_socket->service);
+    g_socket_listener_close(G_SOCKET_LISTENER(control_socket->service));
+
+    while (control_socket->connections != NULL) {
+        control_socket_close((Control_socket_connection *) control_socket->connections->data);
+    }
+
+    if (control_socket->path != NULL) {
+        g_unlink(control_socket->path);
+        g_free(control_socket->path);
+    }
+
+    g_hash_table_destroy(control_socket->commands);
+    g_object_unref(G_OBJECT(control_socket->window));
+    g_object_unref(G_OBJECT(control_socket->service));
+    g_slice_free(Control_socket, control_socket);
+}
+
+void control_socket_add(Control_socket *control_socket, const gchar *name,
+                        Control_socket_func func, gpointer user_data
+) {
+    g_return_if_fail(control_socket != NULL);
+    g_return_if_fail(name != NULL);
+    g_return_if_fail(func != NULL);
+
+    Control_socket_command *command;
+
+    command = g_new(Control_socket_command, 1);
+    command->func = func;
+    command->user_data = user_data;
+
+    g_hash_table_replace(control_socket->commands, g_strdup(name), command);
+}
+
+const gchar *control_socket_get_string_member(JsonObject *command, const gchar *name) {
+    g_return_val_if_fail(command != NULL, NULL);
+    g_return_val_if_fail(name != NULL, NULL);
+
+    JsonNode *node;
+
+    node = json_object_get_member(command, name);
+    if (node == NULL || json_node_get_value_type(node) != G_TYPE_STRING) {
+        return NULL;
+    }
+
+    return json_node_get_string(node);
+}
+
+static gboolean control_socket_on_incoming(G_GNUC_UNUSED GSocketService *service,
+                                           GSocketConnection *connection,
+                                           G_GNUC_UNUSED GObject *source_object,
+                                           gpointer user_data
+) {
+    Control_socket *control_socket = (Control_socket *) user_data;
+    Control_socket_connection *control_connection;
+
+    control_connection = g_slice_new0(Control_socket_connection);
+    control_connection->control_socket = control_socket;
+    control_connection->connection = g_object_ref(connection);
+    control_connection->input = g_data_input_stream_new(
+        g_io_stream_get_input_stream(G_IO_STREAM(connection))
+    );
+    control_connection->cancellable = g_cancellable_new();
+
+    control_socket->connections = g_list_prepend(
+        control_socket->connections,
+        control_connection
+    );
+
+    control_socket_read_command(control_connection);
+
+    return TRUE;
+}
+
+static void control_socket_read_command(Control_socket_connection *connection) {
+    connection->pending = TRUE;
+
+    g_data_input_stream_read_line_async(
+        connection->input, G_PRIORITY_DEFAULT, connection->cancellable,
+        control_socket_on_line_read, connection
+    );
+}
+
+static void control_socket_on_line_read(GObject *source_object, GAsyncResult *result,
+                                        gpointer user_data
+) {
+    Control_socket_connection *connection = (Control_socket_connection *) user_data;
+
+    gchar *line;
+    GError *error = NULL;
+
+    line = g_data_input_stream_read_line_finish_utf8(
+        G_DATA_INPUT_STREAM(source_object), result, NULL, &error
+    );
+    connection->pending = FALSE;
+
+    if (connection->closed) {
+        g_free(line);
+        g_clear_error(&error);
+        control_socket_connection_free(connection);
+        return;
+    }
+
+    // End of the stream or an invalid line.
+    if (line == NULL) {
+        if (error != NULL) {
+            g_printerr("control socket: %s\n", error->message);
+            g_error_free(error);
+        }
+
+        control_socket_close(connection);
+        return;
+    }
+
+    g_strstrip(line);
+    if (line[0] == '\0') {
+        control_socket_read_command(connection);
+    } else {
+        control_socket_execute(connection, line);
+    }
+
+    g_free(line);
+}
+
+static void control_socket_execute(Control_socket_connection *connection, const gchar *line) {
+    gboolean ok;
+    const gchar *name;
+    JsonNode *root;
+    JsonObject *object;
+    JsonParser *parser;
+    GdkFrameClock *frame_clock;
+    Control_socket_command *command;
+    GError *error = NULL;
+
+    connection->start_time = g_get_monotonic_time();
+    connection->builder = json_builder_new();
+    json_builder_begin_object(connection->builder);
+
+    parser = json_parser_new();
+    ok = json_parser_load_from_data(parser, line, -1, &error);
+
+    root = ok ? json_parser_get_root(parser) : NULL;
+    object = root != NULL && JSON_NODE_HOLDS_OBJECT(root) ? json_node_get_object(root) : NULL;
+    name = object != NULL ? control_socket_get_string_member(object, "command") : NULL;
+
+    if (object != NULL && json_object_has_member(object, "id")) {
+        json_builder_set_member_name(connection->builder, "id");
+        json_builder_add_value(
+            connection->builder,
+            json_node_copy(json_object_get_member(object, "id"))
+        );
+    }
+
+    if (name != NULL) {
+        json_builder_set_member_name(connection->builder, "command");
+        json_builder_add_string_value(connection->builder, name);
+    }
+
+    command = name != NULL ? g_hash_table_lookup(connection->control_socket->commands, name) : NULL;
+
+    if (error != NULL) {
+        ok = FALSE;
+    } else if (name == NULL) {
+        ok = FALSE;
+        g_set_error(
+            &error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+            "Expected an object with a command member"
+        );
+    } else if (command == NULL) {
+        ok = FALSE;
+        g_set_error(
+            &error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+            "Unknown command %s", name
+        );
+    } else {
+        ok = command->func(object, connection->builder, command->user_data, &error);
+    }
+
+    connection->handler_time = g_get_monotonic_time() - connection->start_time;
+
+    json_builder_set_member_name(connection->builder, "ok");
+    json_builder_add_boolean_value(connection->builder, ok);
+
+    if (error != NULL) {
+        json_builder_set_member_name(connection->builder, "error");
+        json_builder_add_string_value(connection->builder, error->message);
+        g_error_free(error);
+    }
+
+    g_object_unref(G_OBJECT(parser));
+
+    frame_clock = gtk_widget_get_mapped(connection->control_socket->window) ?
+                  gtk_widget_get_frame_clock(connection->control_socket->window) :
+                  NULL;
+
+    if (!ok || frame_clock == NULL) {
+        control_socket_send_reply(connection);
+        return;
+    }
+
+    // The reply is sent once the result of the command is on the screen.
+    connection->frame_clock = g_object_ref(frame_clock);
+    connection->after_paint_id = g_signal_connect(
+        connection->frame_clock, "after-paint",
+        G_CALLBACK(control_socket_on_after_paint), connection
+    );
+    connection->timeout_id = g_timeout_add(
+        CONTROL_SOCKET_FRAME_TIMEOUT,
+        control_socket_on_frame_timeout,
+        connection
+    );
+    gdk_frame_clock_request_phase(connection->frame_clock, GDK_FRAME_CLOCK_PHASE_AFTER_PAINT);
+}
+
+static void control_socket_on_after_paint(G_GNUC_UNUSED GdkFrameClock *frame_clock,
+                                          gpointer user_data
+) {
+    control_socket_send_reply((Control_socket_connection *) user_data);
+}
+
+static gboolean control_socket_on_frame_timeout(gpointer user_data) {
+    Control_socket_connection *connection = (Control_socket_connection *) user_data;
+
+    // Removed by control_socket_stop_waiting otherwise.
+    connection->timeout_id = 0;
+    control_socket_send_reply(connection);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void control_socket_send_reply(Control_socket_connection *connection) {
+    JsonNode *root;
+    JsonGenerator *generator;
+    gchar *data;
+
+    control_socket_stop_waiting(connection);
+
+    json_builder_set_member_name(connection->builder, "handler_us");
+    json_builder_add_int_value(connection->builder, connection->handler_time);
+    json_builder_set_member_name(connection->builder, "latency_us");
+    json_builder_add_int_value(
+        connection->builder,
+        g_get_monotonic_time() - connection->start_time
+    );
+    json_builder_end_object(connection->builder);
+
+    root = json_builder_get_root(connection->builder);
+    generator = json_generator_new();
+    json_generator_set_root(generator, root);
+    data = json_generator_to_data(generator, NULL);
+
+    connection->reply = g_strconcat(data, "\n", NULL);
+    connection->pending = TRUE;
+
+    g_output_stream_write_all_async(
+        g_io_stream_get_output_stream(G_IO_STREAM(connection->connection)),
+        connection->reply, strlen(connection->reply),
+        G_PRIORITY_DEFAULT, connection->cancellable,
+        control_socket_on_reply_written, connection
+    );
+
+    g_free(data);
+    g_object_unref(G_OBJECT(generator));
+    json_node_unref(root);
+    g_clear_object(&connection->builder);
+}
+
+static void control_socket_on_reply_written(GObject *source_object, GAsyncResult *result,
+                                            gpointer user_data
+) {
+    Control_socket_connection *connection = (Control_socket_connection *) user_data;
+
+    gboolean written;
+    GError *error = NULL;
+
+    written = g_output_stream_write_all_finish(
+        G_OUTPUT_STREAM(source_object), result, NULL, &error
+    );
+    connection->pending = FALSE;
+    g_clear_pointer(&connection->reply, g_free);
+
+    if (connection->closed) {
+        g_clear_error(&error);
+        control_socket_connection_free(connection);
+        return;
+    }
+
+    if (!written) {
+        g_printerr("control socket: %s\n", error->message);
+        g_error_free(error);
+
+        control_socket_close(connection);
+        return;
+    }
+
+    control_socket_read_command(connection);
+}
+
+static void control_socket_stop_waiting(Control_socket_connection *connection) {
+    if (connection->frame_clock != NULL) {
+        if (connection->after_paint_id != 0) {
+            g_signal_handler_disconnect(connection->frame_clock, connection->after_paint_id);
+            connection->after_paint_id = 0;
+        }
+
+        g_clear_object(&connection->frame_clock);
+    }
+
+    if (connection->timeout_id != 0) {
+        g_source_remove(connection->timeout_id);
+        connection->timeout_id = 0;
+    }
+}
+
+static void control_socket_close(Control_socket_connection *connection) {
+    Control_socket *control_socket = connection->control_socket;
+
+    control_socket->connections = g_list_remove(control_socket->connections, connection);
+
+    control_socket_stop_waiting(connection);
+    g_clear_object(&connection->builder);
+    g_cancellable_cancel(connection->cancellable);
+
+    // A stream with a pending read or write cannot be closed, the callback
+    // of the cancelled operation closes and frees it.
+    connection->closed = TRUE;
+    if (!connection->pending) {
+        control_socket_connection_free(connection);
+    }
+}
+
+static void control_socket_connection_free(Control_socket_connection *connection) {
+    GError *error = NULL;
+
+    if (!g_io_stream_close(G_IO_STREAM(connection->connection), NULL, &error)) {
+        g_printerr("control socket: %s\n", error->message);
+        g_error_free(error);
+    }
+
+    g_free(connection->reply);
+    g_object_unref(G_OBJECT(connection->cancellable));
+    g_object_unref(G_OBJECT(connection->input));
+    g_object_unref(G_OBJECT(connection->connection));
+    g_slice_free(Control_socket_connection, connection);
+}
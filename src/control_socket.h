@@ -0,0 +1,20 @@
+#ifndef CONTROL_SOCKET_H
+#define CONTROL_SOCKET_H
+
+#include <gtk/gtk.h>
+#include <json-glib/json-glib.h>
+
+typedef struct control_socket_t Control_socket;
+// Called on the main loop, the members of the reply are added to builder.
+typedef gboolean (*Control_socket_func)(JsonObject *command, JsonBuilder *builder,
+                                        gpointer user_data, GError **error
+);
+
+Control_socket *control_socket_create(const gchar *path, GtkWidget *window, GError **error);
+void control_socket_destroy(Control_socket *control_socket);
+void control_socket_add(Control_socket *control_socket, const gchar *name,
+                        Control_socket_func func, gpointer user_data
+);
+const gchar *control_socket_get_string_member(JsonObject *command, const gchar *name);
+
+#endif
@@ -0,0 +1,227 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+// Writes a synthetic dataset in the format of resources/data/cities.json
+// with COUNT cities, used to test how the game scales past the 29 real
+// cities. The names are built from Serbian syllables (with č, ć, đ, š, ž,
+// lj, nj and dž) and are unique, the lengths of the descriptions follow
+// the real ones (about 300 to 1000 bytes) with a few much longer ones.
+// The same SEED always gives the same dataset.
+
+#define DEFAULT_SEED 1
+#define MAX_NAME_ATTEMPTS 16
+
+static const gchar *name_prefixes[] = {
+    "Gornji", "Donji", "Novi", "Stari", "Mali", "Veliki", "Sremski",
+    "Banatski", "Bački", "Zlatni", "Đurđev", "Čačanski"
+};
+static const gchar *name_starts[] = {
+    "Beo", "Kra", "Ža", "Če", "Ša", "Lo", "Vr", "Ću", "Đa", "Sme", "Pan",
+    "Kru", "Lje", "Nje", "Dže", "Zre", "Su", "Pri", "Pro", "Va", "Ja", "Go",
+    "Do", "Bi", "Ra", "Mla", "Sre", "Ne", "Pi", "Ši", "Žu", "Či", "Ti", "Ub"
+};
+static const gchar *name_middles[] = {
+    "go", "lje", "še", "ča", "ći", "đe", "ra", "vo", "ni", "ko", "ža", "me",
+    "do", "la", "nje", "džo", "ši", "ru", "ba", "te"
+};
+static const gchar *name_ends[] = {
+    "grad", "vac", "ovo", "evo", "ica", "ac", "ar", "in", "nik", "ište",
+    "ani", "ci", "jevo", "ovac", "njak", "ljevo", "čin", "šte", "žane", "ć"
+};
+static const gchar *description_words[] = {
+    "grad", "reka", "Dunav", "Sava", "Morava", "nizija", "Šumadija", "brdo",
+    "čuvena", "tvrđava", "crkva", "manastir", "područje", "okrug", "stanovnika",
+    "privreda", "džamija", "ljudi", "njiva", "poljoprivreda", "industrija",
+    "veliki", "stari", "južno", "severno", "istočno", "zapadno", "nalazi", "se",
+    "je", "i", "u", "na", "od", "sa", "koji", "kroz", "između", "opštine",
+    "naselje", "srednjovekovni", "vek", "dolina", "planina", "jezero", "šuma",
+    "železnička", "pruga", "put", "trg", "ulica", "škola", "fakultet", "muzej",
+    "pozorište", "biblioteka", "spomenik", "zemljište", "ravnica", "kotlina",
+    "izvor", "banja", "vinograd", "žito", "kukuruz", "šećerana", "rudnik"
+};
+
+static gchar *generate_name(GRand *random_generator);
+static gchar *generate_description(GRand *random_generator);
+static void append_capitalized(GString *string, const gchar *word);
+static void append_json_string(GString *string, const gchar *value);
+
+#define RANDOM_ITEM(random_generator, array) \
+    (array)[g_rand_int_range((random_generator), 0, G_N_ELEMENTS(array))]
+
+int main(int argc, char *argv[]) {
+    guint i;
+    guint count;
+    guint32 seed;
+    gint attempt;
+    gchar *name, *unique_name, *description;
+    FILE *output;
+    GRand *random_generator;
+    GString *record;
+    GHashTable *names;
+
+    if (argc < 3) {
+        g_printerr("Usage: %s COUNT OUTPUT [SEED]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    count = (guint) g_ascii_strtoull(argv[1], NULL, 10);
+    seed = argc > 3 ? (guint32) g_ascii_strtoull(argv[3], NULL, 10) : DEFAULT_SEED;
+
+    if (count == 0) {
+        g_printerr("Invalid count!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    output = g_fopen(argv[2], "w");
+    if (output == NULL) {
+        g_printerr("Could not open %s: %s\n", argv[2], g_strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    random_generator = g_rand_new_with_seed(seed);
+    names = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    record = g_string_new(NULL);
+
+    fputs("[\n", output);
+
+    for (i = 0; i < count; i++) {
+        name = NULL;
+        for (attempt = 0; attempt < MAX_NAME_ATTEMPTS; attempt++) {
+            g_free(name);
+            name = generate_name(random_generator);
+
+            if (!g_hash_table_contains(names, name)) {
+                break;
+            }
+        }
+
+        // The syllables are used up for large datasets.
+        if (g_hash_table_contains(names, name)) {
+            unique_name = g_strdup_printf("%s %u", name, i);
+            g_free(name);
+            name = unique_name;
+        }
+
+        g_hash_table_add(names, name);
+        description = generate_description(random_generator);
+
+        g_string_assign(record, "    {\n        \"name\": ");
+        append_json_string(record, name);
+        g_string_append(record, ",\n        \"description\": ");
+        append_json_string(record, description);
+        g_string_append(record, i + 1 < count ? "\n    },\n" : "\n    }\n");
+
+        fwrite(record->str, 1, record->len, output);
+
+        g_free(description);
+    }
+
+    fputs("]\n", output);
+
+    g_string_free(record, TRUE);
+    g_hash_table_destroy(names);
+    g_rand_free(random_generator);
+
+    if (fclose(output) != 0) {
+        g_printerr("Could not write %s: %s\n", argv[2], g_strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    exit(EXIT_SUCCESS);
+}
+
+static gchar *generate_name(GRand *random_generator) {
+    gint i, middles;
+    GString *name;
+
+    name = g_string_new(NULL);
+
+    if (g_rand_int_range(random_generator, 0, 5) == 0) {
+        g_string_append(name, RANDOM_ITEM(random_generator, name_prefixes));
+        g_string_append_c(name, ' ');
+    }
+
+    g_string_append(name, RANDOM_ITEM(random_generator, name_starts));
+
+    middles = g_rand_int_range(random_generator, 0, 3);
+    for (i = 0; i < middles; i++) {
+        g_string_append(name, RANDOM_ITEM(random_generator, name_middles));
+    }
+
+    g_string_append(name, RANDOM_ITEM(random_generator, name_ends));
+
+    return g_string_free(name, FALSE);
+}
+
+static gchar *generate_description(GRand *random_generator) {
+    gint i, words;
+    gsize length;
+    GString *description;
+
+    length = (gsize) g_rand_int_range(random_generator, 280, 1060);
+    // A few cities have much longer descriptions.
+    if (g_rand_int_range(random_generator, 0, 20) == 0) {
+        length *= 4;
+    }
+
+    description = g_string_sized_new(length + 128);
+
+    while (description->len < length) {
+        if (description->len > 0) {
+            // The paragraphs are separated like in cities.json.
+            g_string_append(
+                description,
+                g_rand_int_range(random_generator, 0, 4) == 0 ? "\n \n" : " "
+            );
+        }
+
+        words = g_rand_int_range(random_generator, 6, 19);
+        append_capitalized(description, RANDOM_ITEM(random_generator, description_words));
+
+        for (i = 1; i < words; i++) {
+            g_string_append_c(description, ' ');
+            g_string_append(description, RANDOM_ITEM(random_generator, description_words));
+        }
+
+        g_string_append_c(description, '.');
+    }
+
+    return g_string_free(description, FALSE);
+}
+
+static void append_capitalized(GString *string, const gchar *word) {
+    g_string_append_unichar(string, g_unichar_toupper(g_utf8_get_char(word)));
+    g_string_append(string, g_utf8_next_char(word));
+}
+
+static void append_json_string(GString *string, const gchar *value) {
+    const gchar *i;
+
+    g_string_append_c(string, '"');
+
+    for (i = value; *i != '\0'; i++) {
+        switch (*i) {
+            case '"':
+                g_string_append(string, "\\\"");
+                break;
+            case '\\':
+                g_string_append(string, "\\\\");
+                break;
+            case '\n':
+                g_string_append(string, "\\n");
+                break;
+            default:
+                if ((guchar) *i < 0x20) {
+                    g_string_append_printf(string, "\\u%04x", (guchar) *i);
+                } else {
+                    g_string_append_c(string, *i);
+                }
+                break;
+        }
+    }
+
+    g_string_append_c(string, '"');
+}
@@ -0,0 +1,163 @@
+#include <gtk/gtk.h>
+#include "frame_timer.h"
+
+// A one-shot timer that fires on the frame clock of a widget.
+//
+// The only wakeup before the deadline is a single timeout, after which
+// the callback runs in the next frame of the widget, together with the
+// rest of the drawing. A suspended timer keeps its deadline but has no
+// sources installed, so it causes no wakeups at all.
+
+struct frame_timer_t {
+    GtkWidget *widget;
+    Frame_timer_func callback;
+    gpointer user_data;
+    gint64 deadline;
+    gboolean active;
+    gboolean suspended;
+    guint timeout_id;
+    guint tick_id;
+};
+
+static void frame_timer_schedule(Frame_timer *timer);
+static void frame_timer_unschedule(Frame_timer *timer);
+static gboolean frame_timer_on_timeout(gpointer user_data);
+static gboolean frame_timer_on_tick(G_GNUC_UNUSED GtkWidget *widget,
+                                    G_GNUC_UNUSED GdkFrameClock *frame_clock,
+                                    gpointer user_data
+);
+
+Frame_timer *frame_timer_create(GtkWidget *widget, Frame_timer_func callback,
+                                gpointer user_data
+) {
+    g_return_val_if_fail(GTK_IS_WIDGET(widget), NULL);
+    g_return_val_if_fail(callback != NULL, NULL);
+
+    Frame_timer *timer;
+
+    timer = g_slice_new0(Frame_timer);
+    timer->widget = g_object_ref(widget);
+    timer->callback = callback;
+    timer->user_data = user_data;
+
+    return timer;
+}
+
+void frame_timer_destroy(Frame_timer *timer) {
+    g_return_if_fail(timer != NULL);
+
+    frame_timer_unschedule(timer);
+    g_object_unref(timer->widget);
+    g_slice_free(Frame_timer, timer);
+}
+
+void frame_timer_start(Frame_timer *timer, gint64 delay) {
+    g_return_if_fail(timer != NULL);
+
+    frame_timer_unschedule(timer);
+
+    timer->deadline = g_get_monotonic_time() + MAX(delay, 0);
+    timer->active = TRUE;
+
+    if (!timer->suspended) {
+        frame_timer_schedule(timer);
+    }
+}
+
+void frame_timer_stop(Frame_timer *timer) {
+    g_return_if_fail(timer != NULL);
+
+    frame_timer_unschedule(timer);
+    timer->active = FALSE;
+}
+
+gboolean frame_timer_is_active(Frame_timer *timer) {
+    g_return_val_if_fail(timer != NULL, FALSE);
+
+    return timer->active;
+}
+
+void frame_timer_suspend(Frame_timer *timer) {
+    g_return_if_fail(timer != NULL);
+
+    frame_timer_unschedule(timer);
+    timer->suspended = TRUE;
+}
+
+void frame_timer_resume(Frame_timer *timer) {
+    g_return_if_fail(timer != NULL);
+
+    if (!timer->suspended) {
+        return;
+    }
+
+    timer->suspended = FALSE;
+
+    // A deadline that passed while the timer was suspended fires
+    // in the first frame after the resume.
+    if (timer->active) {
+        frame_timer_schedule(timer);
+    }
+}
+
+static void frame_timer_schedule(Frame_timer *timer) {
+    gint64 remaining;
+
+    remaining = timer->deadline - g_get_monotonic_time();
+
+    if (remaining > 0) {
+        timer->timeout_id = g_timeout_add(
+            (guint) ((remaining + 999) / 1000),
+            frame_timer_on_timeout,
+            timer
+        );
+    } else {
+        timer->tick_id = gtk_widget_add_tick_callback(
+            timer->widget,
+            frame_timer_on_tick,
+            timer,
+            NULL
+        );
+    }
+}
+
+static void frame_timer_unschedule(Frame_timer *timer) {
+    if (timer->timeout_id > 0) {
+        g_source_remove(timer->timeout_id);
+        timer->timeout_id = 0;
+    }
+
+    if (timer->tick_id > 0) {
+        gtk_widget_remove_tick_callback(timer->widget, timer->tick_id);
+        timer->tick_id = 0;
+    }
+}
+
+static gboolean frame_timer_on_timeout(gpointer user_data) {
+    Frame_timer *timer = (Frame_timer *) user_data;
+
+    timer->timeout_id = 0;
+    timer->tick_id = gtk_widget_add_tick_callback(
+        timer->widget,
+        frame_timer_on_tick,
+        timer,
+        NULL
+    );
+
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean frame_timer_on_tick(G_GNUC_UNUSED GtkWidget *widget,
+                                    G_GNUC_UNUSED GdkFrameClock *frame_clock,
+                                    gpointer user_data
+) {
+    Frame_timer *timer = (Frame_timer *) user_data;
+
+    timer->tick_id = 0;
+    timer->active = FALSE;
+
+    // The callback is allowed to start the timer again.
+    timer->callback(timer->user_data);
+
+    return G_SOURCE_REMOVE;
+}
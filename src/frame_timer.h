@@ -0,0 +1,19 @@
+#ifndef FRAME_TIMER_H
+#define FRAME_TIMER_H
+
+#include <gtk/gtk.h>
+
+typedef struct frame_timer_t Frame_timer;
+typedef void (*Frame_timer_func)(gpointer user_data);
+
+Frame_timer *frame_timer_create(GtkWidget *widget, Frame_timer_func callback,
+                                gpointer user_data
+);
+void frame_timer_destroy(Frame_timer *timer);
+void frame_timer_start(Frame_timer *timer, gint64 delay);
+void frame_timer_stop(Frame_timer *timer);
+gboolean frame_timer_is_active(Frame_timer *timer);
+void frame_timer_suspend(Frame_timer *timer);
+void frame_timer_resume(Frame_timer *timer);
+
+#endif
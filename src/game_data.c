@@ -1,29 +1,58 @@
 #include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
 #include <json-glib/json-glib.h>
 #include "city.h"
+#include "index_cache.h"
 #include "resources.h"
 #include "game_data.h"
 
 struct game_data_t {
     GHashTable *cities;
+    // The caches the keys of the cities are borrowed from. The cities
+    // moved by a merge keep the caches of their source.
+    GPtrArray *index_caches;
 };
 
+typedef struct game_data_loader_t {
+    Game_data *data;
+    Index_cache *index_cache;
+    // The cache is rebuilt, it missed the keys of a city or the dataset
+    // was saved again since it was built.
+    gboolean stale;
+    // The first invalid element, the rest of them are skipped.
+    GError *error;
+} Game_data_loader;
+
+// Off in the command line tools: they use a cache that is there, but
+// do not start a thread that their exit would cut short.
+static gboolean index_cache_rebuild = TRUE;
+
+static Game_data *game_data_create_from_bytes(GBytes *bytes, const gchar *path,
+                                              gint64 mtime, GError **error
+);
 static void game_data_add_city(G_GNUC_UNUSED JsonArray *array,
-                               G_GNUC_UNUSED guint index_,
+                               guint index_,
                                JsonNode *element_node,
                                gpointer user_data
 );
+static GPtrArray *game_data_get_names(JsonArray *array);
+static const gchar *game_data_get_string_member(JsonObject *object, const gchar *member_name,
+                                                const gchar *default_value, guint index_,
+                                                GError **error
+);
 static void game_data_city_free(gpointer user_data);
+static gboolean game_data_city_changed(City *city, City *source_city);
+static gboolean game_data_has_index_cache(Game_data *data, Index_cache *index_cache);
 
 Game_data *game_data_create() {
     GResource *resource;
-    GInputStream *stream;
+    GBytes *bytes;
     Game_data *data;
     GError *error = NULL;
-    JsonParser *parser;
 
     resource = gradovi_srbije_get_resource();
-    stream = g_resource_open_stream(
+    bytes = g_resource_lookup_data(
         resource, "/ns/dragi/gradovi-srbije/cities.json",
         G_RESOURCE_LOOKUP_FLAGS_NONE, &error
     );
@@ -35,39 +64,56 @@ Game_data *game_data_create() {
         return NULL;
     }
 
-    parser = json_parser_new_immutable();
-    json_parser_load_from_stream(parser, stream, NULL, &error);
+    // The built-in cities have no modification time, a change that keeps
+    // their size is caught by the names of the cache.
+    data = game_data_create_from_bytes(bytes, NULL, 0, &error);
 
     if (error != NULL) {
         g_printerr("%s\n", error->message);
 
         g_error_free(error);
-        g_object_unref(G_OBJECT(parser));
-        g_object_unref(G_OBJECT(stream));
-        return NULL;
     }
 
-    data = g_slice_new(Game_data);
-    data->cities = g_hash_table_new_full(
-        g_str_hash, g_str_equal,
-        NULL, game_data_city_free
-    );
+    g_bytes_unref(bytes);
+    return data;
+}
 
-    json_array_foreach_element(
-        json_node_get_array(json_parser_get_root(parser)),
-        game_data_add_city,
-        data
-    );
+Game_data *game_data_create_from_file(const gchar *path, GError **error) {
+    g_return_val_if_fail(path != NULL, NULL);
 
-    g_object_unref(G_OBJECT(parser));
-    g_object_unref(G_OBJECT(stream));
+    gsize length;
+    gint64 mtime;
+    gchar *contents;
+    GBytes *bytes;
+    Game_data *data;
+    GStatBuf stat_buf;
+
+    // Before it is read, a change in between only costs a rebuild of the
+    // cache on the next load.
+    mtime = g_stat(path, &stat_buf) == 0 ? (gint64) stat_buf.st_mtime : 0;
+
+    // Read rather than mapped, the file can be truncated by an editor
+    // while it is parsed.
+    if (!g_file_get_contents(path, &contents, &length, error)) {
+        return NULL;
+    }
+
+    bytes = g_bytes_new_take(contents, length);
+    data = game_data_create_from_bytes(bytes, path, mtime, error);
+
+    g_bytes_unref(bytes);
     return data;
 }
 
+void game_data_set_index_cache_rebuild(gboolean rebuild) {
+    index_cache_rebuild = rebuild;
+}
+
 void game_data_destroy(Game_data *data) {
     g_return_if_fail(data != NULL);
 
     g_hash_table_destroy(data->cities);
+    g_ptr_array_unref(data->index_caches);
     g_slice_free(Game_data, data);
 }
 
@@ -83,33 +129,304 @@ GList *game_data_get_cities(Game_data *data) {
     return g_hash_table_get_values(data->cities);
 }
 
+gsize game_data_get_table_size(Game_data *data) {
+    g_return_val_if_fail(data != NULL, 0);
+
+    guint capacity;
+
+    // An estimate: GHashTable keeps its keys, values and hashes in arrays
+    // with a power of two size, at most 3/4 full. The cities themselves
+    // are counted by city_get_allocated_size.
+    capacity = 8;
+    while (capacity * 3 / 4 < g_hash_table_size(data->cities)) {
+        capacity *= 2;
+    }
+
+    return sizeof(Game_data) + capacity * (2 * sizeof(gpointer) + sizeof(guint));
+}
+
+gsize game_data_get_index_cache_size(Game_data *data) {
+    g_return_val_if_fail(data != NULL, 0);
+
+    guint i;
+    gsize size = 0;
+
+    for (i = 0; i < data->index_caches->len; i++) {
+        size += index_cache_get_memory_size(g_ptr_array_index(data->index_caches, i));
+    }
+
+    return size;
+}
+
+guint game_data_merge(Game_data *data, Game_data *source, gboolean structural,
+                      Game_data_change_func func, gpointer user_data
+) {
+    g_return_val_if_fail(data != NULL, 0);
+    g_return_val_if_fail(source != NULL, 0);
+
+    guint i, skipped_count;
+    gboolean moved;
+    City *city, *source_city;
+    GHashTableIter iter;
+    gpointer value;
+
+    // Changes of the existing cities are applied in place, so the map
+    // points and everything else that points to the cities stay valid.
+    // Adding and removing cities is structural: the list of the cities
+    // changes, so it can be postponed (while a game is running) and the
+    // number of the postponed changes is returned. The removed cities are
+    // looked up first, before the added ones are moved out of the source.
+    skipped_count = 0;
+    moved = FALSE;
+
+    g_hash_table_iter_init(&iter, data->cities);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        city = (City *) value;
+
+        if (g_hash_table_contains(source->cities, city_get_name(city))) {
+            continue;
+        }
+
+        if (!structural) {
+            skipped_count++;
+        } else {
+            func(city, GAME_DATA_CITY_REMOVED, user_data);
+            g_hash_table_iter_remove(&iter);
+        }
+    }
+
+    g_hash_table_iter_init(&iter, source->cities);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        source_city = (City *) value;
+        city = g_hash_table_lookup(data->cities, city_get_name(source_city));
+
+        if (city != NULL) {
+            if (game_data_city_changed(city, source_city)) {
+                city_set_description(city, city_get_description(source_city));
+                func(city, GAME_DATA_CITY_CHANGED, user_data);
+            }
+        } else if (!structural) {
+            skipped_count++;
+        } else {
+            // Moved from the source, the key is owned by the city.
+            g_hash_table_iter_steal(&iter);
+            g_hash_table_insert(data->cities, city_get_name(source_city), source_city);
+            func(source_city, GAME_DATA_CITY_ADDED, user_data);
+            moved = TRUE;
+        }
+    }
+
+    // The moved cities can borrow their keys from the caches of the source.
+    for (i = 0; moved && i < source->index_caches->len; i++) {
+        if (!game_data_has_index_cache(data, g_ptr_array_index(source->index_caches, i))) {
+            g_ptr_array_add(
+                data->index_caches,
+                index_cache_ref(g_ptr_array_index(source->index_caches, i))
+            );
+        }
+    }
+
+    return skipped_count;
+}
+
+static Game_data *game_data_create_from_bytes(GBytes *bytes, const gchar *path,
+                                              gint64 mtime, GError **error
+) {
+    gsize size;
+    gchar *cache_path;
+    const gchar *contents;
+    Game_data *data;
+    Game_data_loader loader;
+    JsonNode *root;
+    JsonParser *parser;
+
+    contents = (const gchar *) g_bytes_get_data(bytes, &size);
+    if (contents == NULL) {
+        contents = "";
+    }
+
+    parser = json_parser_new_immutable();
+
+    if (!json_parser_load_from_data(parser, contents, (gssize) size, error)) {
+        g_object_unref(G_OBJECT(parser));
+        return NULL;
+    }
+
+    root = json_parser_get_root(parser);
+    if (root == NULL || !JSON_NODE_HOLDS_ARRAY(root)) {
+        g_set_error(
+            error, JSON_PARSER_ERROR, JSON_PARSER_ERROR_INVALID_DATA,
+            "The cities have to be stored in an array!"
+        );
+
+        g_object_unref(G_OBJECT(parser));
+        return NULL;
+    }
+
+    data = g_slice_new(Game_data);
+    data->cities = g_hash_table_new_full(
+        g_str_hash, g_str_equal,
+        NULL, game_data_city_free
+    );
+    data->index_caches = g_ptr_array_new_with_free_func((GDestroyNotify) index_cache_unref);
+
+    // The keys of the cities come from the cache while the dataset is the
+    // one it was built for, otherwise it is rebuilt in the background.
+    cache_path = index_cache_get_path(path);
+
+    loader.data = data;
+    loader.index_cache = index_cache_open(cache_path, bytes, mtime, &loader.stale);
+    loader.error = NULL;
+
+    json_array_foreach_element(
+        json_node_get_array(root),
+        game_data_add_city,
+        &loader
+    );
+
+    // Nothing of an invalid dataset is used, a reload keeps the old one.
+    if (loader.error != NULL) {
+        g_propagate_error(error, loader.error);
+
+        if (loader.index_cache != NULL) {
+            index_cache_unref(loader.index_cache);
+        }
+        game_data_destroy(data);
+        data = NULL;
+    } else {
+        if (loader.index_cache != NULL) {
+            g_ptr_array_add(data->index_caches, loader.index_cache);
+        }
+
+        if ((loader.index_cache == NULL || loader.stale) && index_cache_rebuild) {
+            index_cache_build(cache_path, bytes, mtime, game_data_get_names(json_node_get_array(root)));
+        }
+    }
+
+    g_free(cache_path);
+    g_object_unref(G_OBJECT(parser));
+    return data;
+}
+
 static void game_data_add_city(G_GNUC_UNUSED JsonArray *array,
-                               G_GNUC_UNUSED guint index_,
+                               guint index_,
                                JsonNode *element_node,
                                gpointer user_data
 ) {
+    Game_data_loader *loader = (Game_data_loader *) user_data;
+
     City *city;
     JsonObject *element_object;
+    const gchar *name, *description;
+    const gchar *latin_key, *ascii_key, *cyrillic_key;
+
+    if (loader->error != NULL) {
+        return;
+    }
+
+    if (!JSON_NODE_HOLDS_OBJECT(element_node)) {
+        g_set_error(
+            &loader->error, JSON_PARSER_ERROR, JSON_PARSER_ERROR_INVALID_DATA,
+            "City %u is not an object", index_
+        );
+        return;
+    }
 
     element_object = json_node_get_object(element_node);
 
-    city = city_create(
-        json_node_get_string(
-            json_object_get_member(element_object, "name")
-        ),
-        json_node_get_string(
-            json_object_get_member(element_object, "description")
-        ),
-        NULL
-    );
+    name = game_data_get_string_member(element_object, "name", NULL, index_, &loader->error);
+    if (name == NULL) {
+        return;
+    }
+
+    description = game_data_get_string_member(element_object, "description", "", index_, &loader->error);
+    if (description == NULL) {
+        return;
+    }
+
+    if (loader->index_cache != NULL &&
+        index_cache_get_keys(loader->index_cache, index_, name, &latin_key, &ascii_key, &cyrillic_key)) {
+        city = city_create_with_keys(name, description, NULL, latin_key, ascii_key, cyrillic_key);
+    } else {
+        loader->stale = TRUE;
+        city = city_create(name, description, NULL);
+    }
 
-    g_hash_table_insert(
-        ((Game_data *) user_data)->cities,
+    // The key belongs to the city, so a duplicate name has to replace
+    // the key together with the city it frees.
+    g_hash_table_replace(
+        loader->data->cities,
         city_get_name(city),
         city
     );
 }
 
+static GPtrArray *game_data_get_names(JsonArray *array) {
+    guint i;
+    GPtrArray *names;
+
+    // An entry for every element, so the entries of the cache are in the
+    // order of the dataset. Only called for a dataset that was loaded, so
+    // every element is a city with a name.
+    names = g_ptr_array_new_full(json_array_get_length(array), g_free);
+
+    for (i = 0; i < json_array_get_length(array); i++) {
+        g_ptr_array_add(
+            names,
+            g_strdup(json_object_get_string_member(json_array_get_object_element(array, i), "name"))
+        );
+    }
+
+    return names;
+}
+
+static const gchar *game_data_get_string_member(JsonObject *object, const gchar *member_name,
+                                                const gchar *default_value, guint index_,
+                                                GError **error
+) {
+    JsonNode *node;
+
+    node = json_object_get_member(object, member_name);
+
+    if (node == NULL) {
+        if (default_value == NULL) {
+            g_set_error(
+                error, JSON_PARSER_ERROR, JSON_PARSER_ERROR_INVALID_DATA,
+                "City %u has no %s", index_, member_name
+            );
+        }
+
+        return default_value;
+    }
+
+    // json_node_get_string returns NULL for anything else.
+    if (!JSON_NODE_HOLDS_VALUE(node) || json_node_get_value_type(node) != G_TYPE_STRING) {
+        g_set_error(
+            error, JSON_PARSER_ERROR, JSON_PARSER_ERROR_INVALID_DATA,
+            "The %s of city %u is not a string", member_name, index_
+        );
+        return NULL;
+    }
+
+    return json_node_get_string(node);
+}
+
 static void game_data_city_free(gpointer user_data) {
     city_destroy((City *) user_data);
 }
+
+static gboolean game_data_city_changed(City *city, City *source_city) {
+    return g_strcmp0(city_get_description(city), city_get_description(source_city)) != 0;
+}
+
+static gboolean game_data_has_index_cache(Game_data *data, Index_cache *index_cache) {
+    guint i;
+
+    for (i = 0; i < data->index_caches->len; i++) {
+        if (g_ptr_array_index(data->index_caches, i) == index_cache) {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
@@ -5,10 +5,24 @@
 #include "city.h"
 
 typedef struct game_data_t Game_data;
+typedef enum game_data_change_t {
+    GAME_DATA_CITY_CHANGED,
+    GAME_DATA_CITY_ADDED,
+    GAME_DATA_CITY_REMOVED
+} Game_data_change;
+// Called after a city has been added or changed and before it is removed.
+typedef void (*Game_data_change_func)(City *city, Game_data_change change, gpointer user_data);
 
 Game_data *game_data_create();
+Game_data *game_data_create_from_file(const gchar *path, GError **error);
+void game_data_set_index_cache_rebuild(gboolean rebuild);
 void game_data_destroy(Game_data *data);
 City *game_data_get_city(Game_data *data, const gchar *name);
 GList *game_data_get_cities(Game_data *data);
+gsize game_data_get_table_size(Game_data *data);
+gsize game_data_get_index_cache_size(Game_data *data);
+guint game_data_merge(Game_data *data, Game_data *source, gboolean structural,
+                      Game_data_change_func func, gpointer user_data
+);
 
 #endif
@@ -1,9 +1,9 @@
+#include <string.h>
 #include <glib.h>
+#include "kd_tree.h"
 #include "game_logic.h"
 #include "city.h"
 
-#define CITIES_COUNT 29
-
 #define GAME_RETURN_IF_RUNNING(game)                    \
 if (game_is_running(game)) {                            \
     g_warning("In %s: the game is running!", __func__); \
@@ -28,21 +28,76 @@ if (!game_is_running(game)) {                                   \
     return val;                                                 \
 }                                                               \
 
+// Snapshot format, all of the numbers are little endian:
+//
+//   header     "GSSN", version (u32), mode (u8), difficulty (u8),
+//              reserved (u16), seed (u32), city count (u32), question
+//              count (u32), question index (u32), correct count (u32),
+//              incorrect count (u32), hash of the questions (u32),
+//              elapsed time (u64)
+//   questions  swap index (u32) of every question
+//   answers    Game_answer (u8) of every question
+//
+// The questions are stored as the swaps of the shuffle, so restoring a
+// game replays them on the list of cities instead of looking the cities
+// up. The hash of the names of the questions catches a different list.
+#define GAME_SNAPSHOT_MAGIC "GSSN"
+#define GAME_SNAPSHOT_VERSION 1
+#define GAME_SNAPSHOT_HEADER_SIZE 48
+#define GAME_FNV_OFFSET 2166136261u
+#define GAME_FNV_PRIME 16777619u
+// Nearest cities kept for every city, the distractors of a question are
+// drawn from them, so the same city is not always asked the same way.
+#define GAME_DISTRACTOR_COUNT 6
+
 typedef enum game_state_t {NOT_RUNNING, RUNNING} Game_state;
 
 struct game_t {
     GList *cities;
+    // The cities in random order, used for sampling without replacement.
+    GPtrArray *shuffled_cities;
+    // The swaps of the last shuffle, undone before the next one, so the
+    // cities of a game only depend on its seed.
+    GArray *swap_indices;
+    // Draws the seeds of the games.
+    GRand *random_generator;
+    GRand *own_random_generator;
+    // Picks the cities, reseeded at the start of every game, and the
+    // choices, reseeded for every question.
+    GRand *game_random_generator;
+    guint32 seed;
+    gboolean has_next_seed;
+    guint32 next_seed;
     Game_state state;
     Game_mode mode;
     Game_difficulty difficulty;
     GList *random_cities;
     GList *current_node;
+    guint question_count;
+    guint question_index;
+    // Game_answer of every question.
+    GByteArray *answers;
     guint correct_answer_count;
     guint incorrect_answer_count;
     guint remaining_questions_count;
+    // City -> NULL terminated array of its nearest cities, built when the
+    // cities are set, so the first CHOICE game does not wait for it. The
+    // cities given to game_create may not have their map points yet, so
+    // without game_set_cities it is built by the first CHOICE question.
+    GHashTable *distractors;
+    City *choices[GAME_CHOICE_COUNT];
+    guint choice_count;
 };
 
 static void game_pick_random_cities(Game *game);
+static void game_build_distractors(Game *game);
+static void game_pick_choices(Game *game);
+static gboolean game_has_choice(Game *game, City *city);
+static void game_reset_shuffle(Game *game);
+static void game_swap_cities(Game *game, guint i, guint j);
+static guint32 game_hash_questions(Game *game);
+static void game_write_u32(guint8 *buffer, guint32 value);
+static guint32 game_read_u32(const guint8 *buffer);
 
 Game *game_create(GList *cities) {
     g_return_val_if_fail(cities != NULL, NULL);
@@ -51,6 +106,16 @@ Game *game_create(GList *cities) {
 
     game = g_slice_new0(Game);
     game->cities = cities;
+    game->shuffled_cities = g_ptr_array_sized_new(g_list_length(cities));
+    game->swap_indices = g_array_new(FALSE, FALSE, sizeof(guint32));
+    game->answers = g_byte_array_new();
+    game->own_random_generator = g_rand_new();
+    game->random_generator = game->own_random_generator;
+    game->game_random_generator = g_rand_new_with_seed(0);
+
+    for (; cities != NULL; cities = cities->next) {
+        g_ptr_array_add(game->shuffled_cities, cities->data);
+    }
 
     return game;
 }
@@ -59,6 +124,14 @@ void game_destroy(Game *game) {
     g_return_if_fail(game != NULL);
 
     g_list_free(game->random_cities);
+    g_ptr_array_free(game->shuffled_cities, TRUE);
+    g_array_free(game->swap_indices, TRUE);
+    g_byte_array_free(game->answers, TRUE);
+    if (game->distractors != NULL) {
+        g_hash_table_destroy(game->distractors);
+    }
+    g_rand_free(game->own_random_generator);
+    g_rand_free(game->game_random_generator);
     g_slice_free(Game, game);
 }
 
@@ -72,7 +145,8 @@ void game_set_mode(Game *game, Game_mode mode) {
     g_return_if_fail(game != NULL);
     g_return_if_fail(
         mode == SELECTION ||
-        mode == TYPING
+        mode == TYPING ||
+        mode == CHOICE
     );
 
     GAME_RETURN_IF_RUNNING(game);
@@ -100,6 +174,56 @@ void game_set_difficulty(Game *game, Game_difficulty difficulty) {
     game->remaining_questions_count = (guint) game->difficulty;
 }
 
+void game_set_random_generator(Game *game, GRand *random_generator) {
+    g_return_if_fail(game != NULL);
+
+    GAME_RETURN_IF_RUNNING(game);
+
+    // The generator is not owned by the game, NULL restores the default
+    // one. Only the seeds of the games are drawn from it.
+    if (random_generator == NULL) {
+        game->random_generator = game->own_random_generator;
+    } else {
+        game->random_generator = random_generator;
+    }
+}
+
+void game_set_seed(Game *game, guint32 seed) {
+    g_return_if_fail(game != NULL);
+
+    GAME_RETURN_IF_RUNNING(game);
+
+    // Only for the next game, the games after it draw their seeds again.
+    game->has_next_seed = TRUE;
+    game->next_seed = seed;
+}
+
+guint32 game_get_seed(Game *game) {
+    g_return_val_if_fail(game != NULL, 0);
+
+    return game->seed;
+}
+
+void game_set_cities(Game *game, GList *cities) {
+    g_return_if_fail(game != NULL);
+
+    GAME_RETURN_IF_RUNNING(game);
+
+    // The list is not owned by the game, only the shuffled copy.
+    game->cities = cities;
+    g_ptr_array_set_size(game->shuffled_cities, 0);
+    g_array_set_size(game->swap_indices, 0);
+
+    for (; cities != NULL; cities = cities->next) {
+        g_ptr_array_add(game->shuffled_cities, cities->data);
+    }
+
+    if (game->distractors != NULL) {
+        g_hash_table_destroy(game->distractors);
+    }
+    game_build_distractors(game);
+}
+
 City *game_get_current_city(Game *game) {
     g_return_val_if_fail(game != NULL, NULL);
 
@@ -136,6 +260,58 @@ guint game_get_remaining_questions_count(Game *game) {
     return game->remaining_questions_count;
 }
 
+guint game_get_question_count(Game *game) {
+    g_return_val_if_fail(game != NULL, 0);
+
+    GAME_RETURN_VAL_IF_NOT_RUNNING(game, 0);
+
+    return game->question_count;
+}
+
+guint game_get_question_index(Game *game) {
+    g_return_val_if_fail(game != NULL, 0);
+
+    GAME_RETURN_VAL_IF_NOT_RUNNING(game, 0);
+
+    return game->question_index;
+}
+
+City *game_get_question_city(Game *game, guint index) {
+    g_return_val_if_fail(game != NULL, NULL);
+
+    GAME_RETURN_VAL_IF_NOT_RUNNING(game, NULL);
+
+    if (index >= game->question_count) {
+        return NULL;
+    }
+
+    // The cities of a game are at the start of the shuffled array.
+    return (City *) g_ptr_array_index(game->shuffled_cities, index);
+}
+
+Game_answer game_get_answer(Game *game, guint index) {
+    g_return_val_if_fail(game != NULL, GAME_NOT_ANSWERED);
+
+    GAME_RETURN_VAL_IF_NOT_RUNNING(game, GAME_NOT_ANSWERED);
+
+    if (index >= game->answers->len) {
+        return GAME_NOT_ANSWERED;
+    }
+
+    return (Game_answer) game->answers->data[index];
+}
+
+guint game_get_current_choices(Game *game, City **choices) {
+    g_return_val_if_fail(game != NULL, 0);
+    g_return_val_if_fail(choices != NULL, 0);
+
+    GAME_RETURN_VAL_IF_NOT_RUNNING(game, 0);
+
+    memcpy(choices, game->choices, game->choice_count * sizeof(City *));
+
+    return game->choice_count;
+}
+
 gboolean game_is_running(Game *game) {
     g_return_val_if_fail(game != NULL, FALSE);
 
@@ -147,9 +323,20 @@ void game_start(Game *game) {
 
     GAME_RETURN_IF_RUNNING(game);
 
+    if (game->has_next_seed) {
+        game->seed = game->next_seed;
+        game->has_next_seed = FALSE;
+    } else {
+        game->seed = g_rand_int(game->random_generator);
+    }
+    g_rand_set_seed(game->game_random_generator, game->seed);
+
     game_pick_random_cities(game);
     game->current_node = game->random_cities;
+    game->question_index = 0;
     game->state = RUNNING;
+
+    game_pick_choices(game);
 }
 
 void game_stop(Game *game) {
@@ -161,6 +348,10 @@ void game_stop(Game *game) {
     game->state = NOT_RUNNING;
     game->random_cities = NULL;
     game->current_node = NULL;
+    game->question_count = 0;
+    game->question_index = 0;
+    game->choice_count = 0;
+    g_byte_array_set_size(game->answers, 0);
     game->correct_answer_count = 0;
     game->incorrect_answer_count = 0;
     game->remaining_questions_count = (guint) game->difficulty;
@@ -173,21 +364,14 @@ gboolean game_check_user_answer(Game *game, const gchar *name) {
 
     City *city;
     gboolean correct;
-    gchar *city_name_casefold;
-    gchar *user_answer_casefold;
 
     city = game_get_current_city(game);
-    if (city == NULL) {
+    if (city == NULL || name == NULL) {
         return FALSE;
     }
 
-    city_name_casefold = g_utf8_casefold(
-        city_get_name(city),
-        -1
-    );
-    user_answer_casefold = g_utf8_casefold(name, -1);
-
-    if (g_strcmp0(city_name_casefold, user_answer_casefold) == 0) {
+    // Accepted in both scripts, without allocating.
+    if (city_matches_name(city, name)) {
         correct = TRUE;
         game->correct_answer_count++;
     } else {
@@ -195,8 +379,7 @@ gboolean game_check_user_answer(Game *game, const gchar *name) {
         game->incorrect_answer_count++;
     }
 
-    g_free(city_name_casefold);
-    g_free(user_answer_casefold);
+    game->answers->data[game->question_index] = correct ? GAME_CORRECT_ANSWER : GAME_INCORRECT_ANSWER;
 
     return correct;
 }
@@ -211,43 +394,369 @@ gboolean game_next_question(Game *game) {
     }
 
     game->current_node = game->current_node->next;
+    game->question_index++;
     game->remaining_questions_count--;
 
+    game_pick_choices(game);
+
     return game->current_node != NULL;
 }
 
+gsize game_get_snapshot_size(Game *game) {
+    g_return_val_if_fail(game != NULL, 0);
+
+    GAME_RETURN_VAL_IF_NOT_RUNNING(game, 0);
+
+    return GAME_SNAPSHOT_HEADER_SIZE + game->question_count * (sizeof(guint32) + 1);
+}
+
+void game_write_snapshot(Game *game, guint64 elapsed, guint8 *snapshot) {
+    g_return_if_fail(game != NULL);
+    g_return_if_fail(snapshot != NULL);
+
+    GAME_RETURN_IF_NOT_RUNNING(game);
+
+    guint i;
+    guint8 *position;
+
+    // Into a buffer of game_get_snapshot_size bytes, so a snapshot can be
+    // taken right after an answer without allocating.
+    memset(snapshot, 0, GAME_SNAPSHOT_HEADER_SIZE);
+    memcpy(snapshot, GAME_SNAPSHOT_MAGIC, 4);
+    game_write_u32(snapshot + 4, GAME_SNAPSHOT_VERSION);
+    snapshot[8] = (guint8) game->mode;
+    snapshot[9] = (guint8) game->difficulty;
+    game_write_u32(snapshot + 12, game->seed);
+    game_write_u32(snapshot + 16, game->shuffled_cities->len);
+    game_write_u32(snapshot + 20, game->question_count);
+    game_write_u32(snapshot + 24, game->question_index);
+    game_write_u32(snapshot + 28, game->correct_answer_count);
+    game_write_u32(snapshot + 32, game->incorrect_answer_count);
+    game_write_u32(snapshot + 36, game_hash_questions(game));
+    game_write_u32(snapshot + 40, (guint32) elapsed);
+    game_write_u32(snapshot + 44, (guint32) (elapsed >> 32));
+
+    position = snapshot + GAME_SNAPSHOT_HEADER_SIZE;
+    for (i = 0; i < game->question_count; i++, position += sizeof(guint32)) {
+        game_write_u32(position, g_array_index(game->swap_indices, guint32, i));
+    }
+    memcpy(position, game->answers->data, game->question_count);
+}
+
+gboolean game_restore_snapshot(Game *game, GBytes *snapshot, guint64 *elapsed,
+                               GError **error
+) {
+    g_return_val_if_fail(game != NULL, FALSE);
+    g_return_val_if_fail(snapshot != NULL, FALSE);
+
+    GAME_RETURN_VAL_IF_RUNNING(game, FALSE);
+
+    guint i;
+    gsize size;
+    guint32 swap_index;
+    guint32 question_count, question_index;
+    guint32 correct_count, incorrect_count;
+    const guint8 *data, *answers;
+
+    data = g_bytes_get_data(snapshot, &size);
+
+    if (size < GAME_SNAPSHOT_HEADER_SIZE ||
+        memcmp(data, GAME_SNAPSHOT_MAGIC, 4) != 0 ||
+        game_read_u32(data + 4) != GAME_SNAPSHOT_VERSION) {
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "Not a game snapshot!");
+        return FALSE;
+    }
+
+    question_count = game_read_u32(data + 20);
+    question_index = game_read_u32(data + 24);
+    correct_count = game_read_u32(data + 28);
+    incorrect_count = game_read_u32(data + 32);
+
+    // A snapshot is taken while a question is asked, so there is always a
+    // current city. The counts are compared without overflowing.
+    if ((data[8] != SELECTION && data[8] != TYPING && data[8] != CHOICE) ||
+        (data[9] != EASY && data[9] != MEDIUM && data[9] != HARD) ||
+        game_read_u32(data + 16) != game->shuffled_cities->len ||
+        question_count == 0 ||
+        question_count > MIN((guint) data[9], game->shuffled_cities->len) ||
+        question_index >= question_count ||
+        correct_count > question_count ||
+        incorrect_count > question_count - correct_count ||
+        size != GAME_SNAPSHOT_HEADER_SIZE + question_count * (sizeof(guint32) + 1)) {
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "The snapshot does not match the cities!");
+        return FALSE;
+    }
+
+    answers = data + GAME_SNAPSHOT_HEADER_SIZE + question_count * sizeof(guint32);
+    for (i = 0; i < question_count; i++) {
+        if (answers[i] != GAME_NOT_ANSWERED &&
+            answers[i] != GAME_CORRECT_ANSWER &&
+            answers[i] != GAME_INCORRECT_ANSWER) {
+            g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "The snapshot has an invalid answer!");
+            return FALSE;
+        }
+    }
+
+    // Replays the shuffle of the snapshot.
+    game_reset_shuffle(game);
+    for (i = 0; i < question_count; i++) {
+        swap_index = game_read_u32(data + GAME_SNAPSHOT_HEADER_SIZE + i * sizeof(guint32));
+
+        if (swap_index < i || swap_index >= game->shuffled_cities->len) {
+            break;
+        }
+
+        game_swap_cities(game, i, swap_index);
+        g_array_append_val(game->swap_indices, swap_index);
+    }
+
+    game->question_count = question_count;
+
+    if (i < question_count || game_hash_questions(game) != game_read_u32(data + 36)) {
+        game->question_count = 0;
+        game_reset_shuffle(game);
+
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "The snapshot does not match the cities!");
+        return FALSE;
+    }
+
+    game->mode = (Game_mode) data[8];
+    game->difficulty = (Game_difficulty) data[9];
+    game->seed = game_read_u32(data + 12);
+    game->question_index = question_index;
+    game->correct_answer_count = correct_count;
+    game->incorrect_answer_count = incorrect_count;
+    game->remaining_questions_count = question_count - question_index;
+
+    g_byte_array_set_size(game->answers, 0);
+    g_byte_array_append(game->answers, answers, question_count);
+
+    for (i = question_count; i > 0; i--) {
+        game->random_cities = g_list_prepend(
+            game->random_cities,
+            g_ptr_array_index(game->shuffled_cities, i - 1)
+        );
+    }
+    game->current_node = g_list_nth(game->random_cities, question_index);
+    game->state = RUNNING;
+
+    game_pick_choices(game);
+
+    if (elapsed != NULL) {
+        *elapsed = game_read_u32(data + 40) | (guint64) game_read_u32(data + 44) << 32;
+    }
+
+    return TRUE;
+}
+
 static void game_pick_random_cities(Game *game) {
+    guint i, count;
+    guint32 swap_index;
     gint32 random_index;
-    guint picked_cities_count;
+    GPtrArray *cities;
 
-    GRand *random_generator;
+    cities = game->shuffled_cities;
+    count = MIN(game->remaining_questions_count, cities->len);
 
-    random_generator = g_rand_new();
+    game_reset_shuffle(game);
 
-    picked_cities_count = 0;
-    do {
+    // Partial Fisher-Yates shuffle, every city is picked at most once
+    // and only the first count positions are touched.
+    for (i = 0; i < count; i++) {
         random_index = g_rand_int_range(
-            random_generator,
-            0,
-            CITIES_COUNT
+            game->game_random_generator,
+            (gint32) i,
+            (gint32) cities->len
         );
 
-        City *random_city = (City *) g_list_nth_data(
-            game->cities,
-            (guint) random_index
+        swap_index = (guint32) random_index;
+        game_swap_cities(game, i, swap_index);
+        g_array_append_val(game->swap_indices, swap_index);
+
+        game->random_cities = g_list_prepend(
+            game->random_cities,
+            g_ptr_array_index(cities, i)
         );
+    }
+
+    game->random_cities = g_list_reverse(game->random_cities);
+    game->remaining_questions_count = count;
+    game->question_count = count;
 
-        if (g_list_index(game->random_cities, random_city) != -1) {
+    g_byte_array_set_size(game->answers, count);
+    memset(game->answers->data, GAME_NOT_ANSWERED, count);
+}
+
+static void game_build_distractors(Game *game) {
+    gint x, y;
+    guint i, j, count, found;
+    guint nearest[GAME_DISTRACTOR_COUNT];
+    gdouble *points;
+    GList *node;
+    City **located_cities, **distractors;
+    Map_point *map_point;
+    Kd_tree *tree;
+
+    game->distractors = g_hash_table_new_full(
+        g_direct_hash, g_direct_equal,
+        NULL, g_free
+    );
+
+    points = g_new(gdouble, 2 * game->shuffled_cities->len);
+    located_cities = g_new(City *, game->shuffled_cities->len);
+
+    // In the order of the city list, so the ties are always broken the
+    // same way. Cities without a map point have no location.
+    count = 0;
+    for (node = game->cities; node != NULL; node = node->next) {
+        map_point = city_get_map_point((City *) node->data);
+        if (map_point == NULL) {
             continue;
         }
 
-        game->random_cities = g_list_append(
-            game->random_cities,
-            random_city
+        map_point_get_position(map_point, &x, &y);
+        points[2 * count] = x;
+        points[2 * count + 1] = y;
+        located_cities[count++] = (City *) node->data;
+    }
+
+    if (count > 0) {
+        tree = kd_tree_create(points, count);
+
+        for (i = 0; i < count; i++) {
+            found = kd_tree_find_nearest(tree, i, nearest, GAME_DISTRACTOR_COUNT);
+
+            distractors = g_new0(City *, found + 1);
+            for (j = 0; j < found; j++) {
+                distractors[j] = located_cities[nearest[j]];
+            }
+
+            g_hash_table_insert(game->distractors, located_cities[i], distractors);
+        }
+
+        kd_tree_destroy(tree);
+    }
+
+    g_free(located_cities);
+    g_free(points);
+}
+
+static void game_pick_choices(Game *game) {
+    guint i, j, count;
+    City *city, *candidate;
+    City *candidates[GAME_DISTRACTOR_COUNT];
+    City **distractors;
+    GPtrArray *cities;
+
+    game->choice_count = 0;
+
+    if (game->mode != CHOICE || game->current_node == NULL) {
+        return;
+    }
+
+    // The choices of a question only depend on the seed of the game and
+    // the question, so a restored game shows the same ones.
+    g_rand_set_seed(game->game_random_generator, game->seed ^ game->question_index);
+
+    if (game->distractors == NULL) {
+        game_build_distractors(game);
+    }
+
+    city = (City *) game->current_node->data;
+    cities = game->shuffled_cities;
+
+    count = 0;
+    distractors = (City **) g_hash_table_lookup(game->distractors, city);
+    for (; distractors != NULL && distractors[count] != NULL; count++) {
+        candidates[count] = distractors[count];
+    }
+
+    // Partial Fisher-Yates shuffle of the nearest cities.
+    for (i = 0; i < count && game->choice_count < GAME_CHOICE_COUNT - 1; i++) {
+        j = (guint) g_rand_int_range(game->game_random_generator, (gint32) i, (gint32) count);
+
+        candidate = candidates[j];
+        candidates[j] = candidates[i];
+        candidates[i] = candidate;
+
+        game->choices[game->choice_count++] = candidate;
+    }
+
+    // Cities without a location, or without enough neighbours, get random
+    // distractors instead.
+    while (game->choice_count < GAME_CHOICE_COUNT - 1 && game->choice_count + 1 < cities->len) {
+        candidate = g_ptr_array_index(
+            cities,
+            g_rand_int_range(game->game_random_generator, 0, (gint32) cities->len)
         );
 
-        picked_cities_count++;
-    } while (picked_cities_count < game->remaining_questions_count);
+        if (candidate != city && !game_has_choice(game, candidate)) {
+            game->choices[game->choice_count++] = candidate;
+        }
+    }
+
+    // The correct answer at a random position.
+    i = (guint) g_rand_int_range(game->game_random_generator, 0, (gint32) game->choice_count + 1);
+    game->choices[game->choice_count++] = game->choices[i];
+    game->choices[i] = city;
+}
+
+static gboolean game_has_choice(Game *game, City *city) {
+    guint i;
+
+    for (i = 0; i < game->choice_count; i++) {
+        if (game->choices[i] == city) {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+static void game_reset_shuffle(Game *game) {
+    guint i;
+
+    // Back to the order of the city list, in O(count) instead of O(n).
+    for (i = game->swap_indices->len; i > 0; i--) {
+        game_swap_cities(game, i - 1, g_array_index(game->swap_indices, guint32, i - 1));
+    }
+    g_array_set_size(game->swap_indices, 0);
+}
+
+static void game_swap_cities(Game *game, guint i, guint j) {
+    gpointer city;
+
+    city = g_ptr_array_index(game->shuffled_cities, j);
+    g_ptr_array_index(game->shuffled_cities, j) = g_ptr_array_index(game->shuffled_cities, i);
+    g_ptr_array_index(game->shuffled_cities, i) = city;
+}
+
+static guint32 game_hash_questions(Game *game) {
+    guint i;
+    guint32 hash = GAME_FNV_OFFSET;
+    const gchar *name;
+
+    // FNV-1a of the names of the questions, with the NULs.
+    for (i = 0; i < game->question_count; i++) {
+        name = city_get_name((City *) g_ptr_array_index(game->shuffled_cities, i));
+
+        do {
+            hash = (hash ^ (guint8) *name) * GAME_FNV_PRIME;
+        } while (*name++ != '\0');
+    }
+
+    return hash;
+}
+
+static void game_write_u32(guint8 *buffer, guint32 value) {
+    value = GUINT32_TO_LE(value);
+    memcpy(buffer, &value, sizeof(value));
+}
+
+static guint32 game_read_u32(const guint8 *buffer) {
+    guint32 value;
+
+    memcpy(&value, buffer, sizeof(value));
 
-    g_rand_free(random_generator);
+    return GUINT32_FROM_LE(value);
 }
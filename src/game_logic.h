@@ -4,9 +4,17 @@
 #include <glib.h>
 #include "city.h"
 
+// Names offered for a question of the CHOICE mode, the correct one included.
+#define GAME_CHOICE_COUNT 4
+
 typedef struct game_t Game;
 typedef enum game_difficulty_t {EASY = 9, MEDIUM = 19, HARD = 29} Game_difficulty;
-typedef enum game_mode_t {SELECTION, TYPING} Game_mode;
+typedef enum game_mode_t {SELECTION, TYPING, CHOICE} Game_mode;
+typedef enum game_answer_t {
+    GAME_NOT_ANSWERED,
+    GAME_CORRECT_ANSWER,
+    GAME_INCORRECT_ANSWER
+} Game_answer;
 
 Game *game_create(GList *cities);
 void game_destroy(Game *game);
@@ -14,15 +22,29 @@ Game_difficulty game_get_difficulty(Game *game);
 void game_set_difficulty(Game *game, Game_difficulty difficulty);
 Game_mode game_get_mode(Game *game);
 void game_set_mode(Game *game, Game_mode mode);
+void game_set_random_generator(Game *game, GRand *random_generator);
+void game_set_seed(Game *game, guint32 seed);
+guint32 game_get_seed(Game *game);
+void game_set_cities(Game *game, GList *cities);
 City *game_get_current_city(Game *game);
 gchar *game_get_current_city_name(Game *game);
 guint game_get_correct_answer_count(Game *game);
 guint game_get_incorrect_answer_count(Game *game);
 guint game_get_remaining_questions_count(Game *game);
+guint game_get_question_count(Game *game);
+guint game_get_question_index(Game *game);
+City *game_get_question_city(Game *game, guint index);
+Game_answer game_get_answer(Game *game, guint index);
+guint game_get_current_choices(Game *game, City **choices);
 gboolean game_is_running(Game *game);
 void game_start(Game *game);
 void game_stop(Game *game);
 gboolean game_check_user_answer(Game *game, const gchar *name);
 gboolean game_next_question(Game *game);
+gsize game_get_snapshot_size(Game *game);
+void game_write_snapshot(Game *game, guint64 elapsed, guint8 *snapshot);
+gboolean game_restore_snapshot(Game *game, GBytes *snapshot, guint64 *elapsed,
+                               GError **error
+);
 
 #endif
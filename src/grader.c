@@ -0,0 +1,591 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <json-glib/json-glib.h>
+#include "city.h"
+#include "game_data.h"
+#include "work_stealing.h"
+
+// Grades the typed answers collected outside of the game, on paper and
+// online tests, with the rules of the typing mode: an answer is correct
+// when city_matches_name() accepts it, as in game_check_user_answer().
+//
+// The input is a CSV file with the columns student, city and answer (an
+// optional header row is skipped) or a JSON lines file of objects with the
+// same string members. The city is the name from the dataset. The fields
+// of a CSV record may be quoted, but not span lines.
+//
+// The input is read in batches of --batch records. The records of a batch
+// are parsed and graded in chunks by a work-stealing pool and only one
+// batch is kept in memory, so the memory does not grow with the input.
+//
+// The answers of a student are expected to be consecutive, as they are on
+// an answer sheet. The summary of a student is written as soon as the
+// records of the next student start. A student whose answers are not
+// consecutive gets a summary for every run of them.
+
+#define CHUNK_SIZE 1024
+#define FIELD_COUNT 3
+// Malformed records reported one by one, the rest are only counted.
+#define MAX_REPORTED_MALFORMED 10
+#define UTF8_BOM "\xEF\xBB\xBF"
+
+typedef enum grader_status_t {
+    GRADER_CORRECT,
+    GRADER_INCORRECT,
+    GRADER_UNKNOWN_CITY,
+    GRADER_MALFORMED,
+    // Empty lines and the CSV header.
+    GRADER_SKIPPED
+} Grader_status;
+
+typedef struct grader_record_t {
+    // Of the line in the batch buffer. The parsed fields are written over
+    // the line, so the student points into the buffer.
+    gsize offset;
+    const gchar *student;
+    Grader_status status;
+} Grader_record;
+
+typedef struct grader_t {
+    Game_data *data;
+    gboolean jsonl;
+    // One per worker, a parser is not thread-safe.
+    JsonParser **parsers;
+
+    // The lines of the batch, each terminated by a NUL.
+    GString *buffer;
+    Grader_record *records;
+    guint record_count;
+    guint64 line_count;
+    const gchar *input_path;
+
+    FILE *output;
+    JsonGenerator *generator;
+
+    // The current run of the answers of a student, indexed by the status.
+    gboolean has_student;
+    GString *student;
+    guint64 counts[GRADER_MALFORMED];
+
+    guint64 totals[GRADER_SKIPPED];
+    guint64 student_count;
+} Grader;
+
+static const gchar *field_names[FIELD_COUNT] = {"student", "city", "answer"};
+
+static gint thread_count = 0;
+static gint batch_size = 65536;
+static gchar *format_name = NULL;
+static gchar *data_path = NULL;
+static gchar *output_path = NULL;
+static gchar **input_paths = NULL;
+
+static GOptionEntry option_entries[] = {
+    {"threads", 'j', 0, G_OPTION_ARG_INT, &thread_count, "Number of threads (0 for all cores)", "N"},
+    {"batch", 'b', 0, G_OPTION_ARG_INT, &batch_size, "Number of records kept in memory", "N"},
+    {
+        "format", 'f', 0, G_OPTION_ARG_STRING, &format_name,
+        "Format of the input and the summaries: csv or jsonl (by the file extension)", "FORMAT"
+    },
+    {"data", 'd', 0, G_OPTION_ARG_FILENAME, &data_path, "Dataset instead of the built-in cities", "FILE"},
+    {"output", 'o', 0, G_OPTION_ARG_FILENAME, &output_path, "Write the summaries to FILE", "FILE"},
+    {
+        G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &input_paths,
+        NULL, "FILE... (- for the standard input)"
+    },
+    {NULL, 0, 0, G_OPTION_ARG_NONE, NULL, NULL, NULL}
+};
+
+static gboolean grade_file(Grader *grader, Work_stealing *pool, const gchar *path);
+static guint read_batch(Grader *grader, FILE *input);
+static gboolean read_line(FILE *input, GString *buffer);
+static void grade_chunk(guint64 first, guint64 last, guint worker, gpointer user_data);
+static void grade_record(Grader *grader, guint worker, Grader_record *record);
+static gboolean parse_csv(gchar *line, gchar **fields);
+static gboolean parse_json(JsonParser *parser, gchar *line, gchar **fields);
+static void merge_batch(Grader *grader);
+static void write_summary(Grader *grader);
+static void write_csv_field(FILE *output, const gchar *field);
+
+int main(int argc, char *argv[]) {
+    guint i;
+    gint64 start;
+    gdouble elapsed;
+    gboolean graded;
+    Grader grader = {0};
+    Work_stealing *pool;
+    GOptionContext *option_context;
+    GError *error = NULL;
+
+    option_context = g_option_context_new(NULL);
+    g_option_context_set_summary(
+        option_context,
+        "Grades typed answers with the rules of the game and summarizes them per student."
+    );
+    g_option_context_add_main_entries(option_context, option_entries, NULL);
+
+    if (!g_option_context_parse(option_context, &argc, &argv, &error)) {
+        g_printerr("%s\n", error->message);
+
+        g_error_free(error);
+        g_option_context_free(option_context);
+        exit(EXIT_FAILURE);
+    }
+
+    g_option_context_free(option_context);
+
+    if (input_paths == NULL || thread_count < 0 || batch_size <= 0) {
+        g_printerr("Invalid options!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (format_name == NULL) {
+        grader.jsonl = g_str_has_suffix(input_paths[0], ".jsonl") ||
+                       g_str_has_suffix(input_paths[0], ".ndjson");
+    } else if (g_strcmp0(format_name, "jsonl") == 0) {
+        grader.jsonl = TRUE;
+    } else if (g_strcmp0(format_name, "csv") != 0) {
+        g_printerr("Unknown format %s!\n", format_name);
+        exit(EXIT_FAILURE);
+    }
+
+    game_data_set_index_cache_rebuild(FALSE);
+
+    if (data_path != NULL) {
+        grader.data = game_data_create_from_file(data_path, &error);
+    } else {
+        grader.data = game_data_create();
+    }
+
+    if (grader.data == NULL) {
+        if (error != NULL) {
+            g_printerr("%s\n", error->message);
+            g_error_free(error);
+        }
+        exit(EXIT_FAILURE);
+    }
+
+    if (output_path != NULL) {
+        grader.output = fopen(output_path, "w");
+        if (grader.output == NULL) {
+            g_printerr("Could not open %s!\n", output_path);
+            game_data_destroy(grader.data);
+            exit(EXIT_FAILURE);
+        }
+    } else {
+        grader.output = stdout;
+    }
+
+    pool = work_stealing_create((guint) thread_count);
+
+    grader.parsers = g_new0(JsonParser *, work_stealing_get_worker_count(pool));
+    if (grader.jsonl) {
+        for (i = 0; i < work_stealing_get_worker_count(pool); i++) {
+            grader.parsers[i] = json_parser_new();
+        }
+        grader.generator = json_generator_new();
+    } else {
+        fprintf(grader.output, "student,answers,correct,incorrect,unknown_cities,score\n");
+    }
+
+    grader.buffer = g_string_sized_new(64 * (gsize) batch_size);
+    grader.records = g_new(Grader_record, batch_size);
+    grader.student = g_string_new(NULL);
+
+    start = g_get_monotonic_time();
+
+    graded = TRUE;
+    for (i = 0; input_paths[i] != NULL && graded; i++) {
+        graded = grade_file(&grader, pool, input_paths[i]);
+    }
+
+    // The last student.
+    write_summary(&grader);
+    fflush(grader.output);
+
+    elapsed = (g_get_monotonic_time() - start) / (gdouble) G_USEC_PER_SEC;
+
+    g_printerr(
+        "%" G_GUINT64_FORMAT " answers of %" G_GUINT64_FORMAT " students in %.2f s (%.0f answers/s)\n"
+        "%" G_GUINT64_FORMAT " correct, %" G_GUINT64_FORMAT " incorrect, "
+        "%" G_GUINT64_FORMAT " unknown cities, %" G_GUINT64_FORMAT " malformed records\n",
+        grader.totals[GRADER_CORRECT] + grader.totals[GRADER_INCORRECT] + grader.totals[GRADER_UNKNOWN_CITY],
+        grader.student_count, elapsed,
+        (grader.totals[GRADER_CORRECT] + grader.totals[GRADER_INCORRECT]) / MAX(elapsed, 1e-9),
+        grader.totals[GRADER_CORRECT], grader.totals[GRADER_INCORRECT],
+        grader.totals[GRADER_UNKNOWN_CITY], grader.totals[GRADER_MALFORMED]
+    );
+
+    for (i = 0; i < work_stealing_get_worker_count(pool); i++) {
+        if (grader.parsers[i] != NULL) {
+            g_object_unref(G_OBJECT(grader.parsers[i]));
+        }
+    }
+
+    if (grader.generator != NULL) {
+        g_object_unref(G_OBJECT(grader.generator));
+    }
+
+    if (grader.output != stdout) {
+        fclose(grader.output);
+    }
+
+    g_free(grader.parsers);
+    g_free(grader.records);
+    g_string_free(grader.buffer, TRUE);
+    g_string_free(grader.student, TRUE);
+    work_stealing_destroy(pool);
+    game_data_destroy(grader.data);
+    g_strfreev(input_paths);
+
+    exit(graded ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+static gboolean grade_file(Grader *grader, Work_stealing *pool, const gchar *path) {
+    FILE *input;
+    gboolean read;
+
+    if (g_strcmp0(path, "-") == 0) {
+        input = stdin;
+    } else {
+        input = fopen(path, "r");
+        if (input == NULL) {
+            g_printerr("Could not open %s!\n", path);
+            return FALSE;
+        }
+    }
+
+    grader->input_path = path;
+    grader->line_count = 0;
+
+    while (read_batch(grader, input) > 0) {
+        work_stealing_run(pool, grader->record_count, CHUNK_SIZE, grade_chunk, grader);
+        merge_batch(grader);
+
+        // The summaries of the batch are out before the next one is read.
+        fflush(grader->output);
+    }
+
+    read = !ferror(input);
+    if (!read) {
+        g_printerr("Could not read %s!\n", path);
+    }
+
+    if (input != stdin) {
+        fclose(input);
+    }
+
+    return read;
+}
+
+static guint read_batch(Grader *grader, FILE *input) {
+    gsize offset;
+
+    g_string_truncate(grader->buffer, 0);
+    grader->record_count = 0;
+
+    while (grader->record_count < (guint) batch_size) {
+        offset = grader->buffer->len;
+        if (!read_line(input, grader->buffer)) {
+            break;
+        }
+
+        // Spreadsheets start the CSV files they save with a byte order mark.
+        if (grader->line_count == 0 && g_str_has_prefix(grader->buffer->str + offset, UTF8_BOM)) {
+            g_string_erase(grader->buffer, (gssize) offset, strlen(UTF8_BOM));
+        }
+
+        g_string_append_c(grader->buffer, '\0');
+        grader->records[grader->record_count++].offset = offset;
+        grader->line_count++;
+    }
+
+    return grader->record_count;
+}
+
+static gboolean read_line(FILE *input, GString *buffer) {
+    gsize length, start;
+    gboolean read = FALSE;
+    gchar chunk[4096];
+
+    start = buffer->len;
+
+    while (fgets(chunk, sizeof(chunk), input) != NULL) {
+        read = TRUE;
+        length = strlen(chunk);
+        g_string_append_len(buffer, chunk, (gssize) length);
+
+        if (length > 0 && chunk[length - 1] == '\n') {
+            break;
+        }
+    }
+
+    // Without the line ending, LF or CRLF.
+    while (buffer->len > start &&
+           (buffer->str[buffer->len - 1] == '\n' || buffer->str[buffer->len - 1] == '\r')) {
+        g_string_truncate(buffer, buffer->len - 1);
+    }
+
+    return read;
+}
+
+static void grade_chunk(guint64 first, guint64 last, guint worker, gpointer user_data) {
+    guint64 i;
+    Grader *grader = (Grader *) user_data;
+
+    for (i = first; i < last; i++) {
+        grade_record(grader, worker, &grader->records[i]);
+    }
+}
+
+static void grade_record(Grader *grader, guint worker, Grader_record *record) {
+    guint i;
+    gboolean parsed;
+    gchar *line;
+    gchar *fields[FIELD_COUNT];
+    City *city;
+
+    line = grader->buffer->str + record->offset;
+    record->student = NULL;
+
+    if (*line == '\0') {
+        record->status = GRADER_SKIPPED;
+        return;
+    }
+
+    if (grader->jsonl) {
+        parsed = parse_json(grader->parsers[worker], line, fields);
+    } else {
+        parsed = parse_csv(line, fields);
+    }
+
+    // The matching walks the names character by character.
+    for (i = 0; i < FIELD_COUNT && parsed; i++) {
+        parsed = g_utf8_validate(fields[i], -1, NULL);
+    }
+
+    if (!parsed) {
+        record->status = GRADER_MALFORMED;
+        return;
+    }
+
+    // The header can only be the first line of a file, in its first batch.
+    if (!grader->jsonl && record == grader->records && grader->line_count == grader->record_count &&
+        g_strcmp0(fields[0], field_names[0]) == 0 &&
+        g_strcmp0(fields[1], field_names[1]) == 0 &&
+        g_strcmp0(fields[2], field_names[2]) == 0) {
+        record->status = GRADER_SKIPPED;
+        return;
+    }
+
+    record->student = fields[0];
+
+    // Only read, so the cities are shared by the workers.
+    city = game_data_get_city(grader->data, fields[1]);
+    if (city == NULL) {
+        record->status = GRADER_UNKNOWN_CITY;
+    } else if (city_matches_name(city, fields[2])) {
+        record->status = GRADER_CORRECT;
+    } else {
+        record->status = GRADER_INCORRECT;
+    }
+}
+
+static gboolean parse_csv(gchar *line, gchar **fields) {
+    guint i;
+    gchar *read, *write;
+
+    // Unquoted in place, a field is never longer than its text in the line.
+    read = write = line;
+
+    for (i = 0; i < FIELD_COUNT; i++) {
+        fields[i] = write;
+
+        if (*read == '"') {
+            read++;
+
+            while (*read != '"' || read[1] == '"') {
+                if (*read == '\0') {
+                    return FALSE;
+                }
+
+                if (*read == '"') {
+                    read++;
+                }
+                *write++ = *read++;
+            }
+
+            read++;
+        } else {
+            while (*read != ',' && *read != '\0') {
+                *write++ = *read++;
+            }
+        }
+
+        if (i + 1 < FIELD_COUNT ? *read != ',' : *read != '\0') {
+            return FALSE;
+        }
+
+        read++;
+        *write++ = '\0';
+    }
+
+    return TRUE;
+}
+
+static gboolean parse_json(JsonParser *parser, gchar *line, gchar **fields) {
+    guint i;
+    gsize size;
+    gchar *write;
+    JsonNode *root, *node;
+    JsonObject *object;
+
+    if (!json_parser_load_from_data(parser, line, -1, NULL)) {
+        return FALSE;
+    }
+
+    root = json_parser_get_root(parser);
+    if (root == NULL || !JSON_NODE_HOLDS_OBJECT(root)) {
+        return FALSE;
+    }
+
+    object = json_node_get_object(root);
+
+    // The parser has its own copies of the strings, so they are written
+    // over the line. Every value is in the line with its member name and
+    // quotes, so the values fit.
+    write = line;
+
+    for (i = 0; i < FIELD_COUNT; i++) {
+        node = json_object_get_member(object, field_names[i]);
+        if (node == NULL || !JSON_NODE_HOLDS_VALUE(node) ||
+            json_node_get_value_type(node) != G_TYPE_STRING) {
+            return FALSE;
+        }
+
+        size = strlen(json_node_get_string(node)) + 1;
+        memcpy(write, json_node_get_string(node), size);
+
+        fields[i] = write;
+        write += size;
+    }
+
+    return TRUE;
+}
+
+static void merge_batch(Grader *grader) {
+    guint i;
+    Grader_record *record;
+
+    // In the order of the input, so the runs of the students are kept.
+    for (i = 0; i < grader->record_count; i++) {
+        record = &grader->records[i];
+
+        if (record->status == GRADER_SKIPPED) {
+            continue;
+        }
+
+        grader->totals[record->status]++;
+
+        if (record->status == GRADER_MALFORMED) {
+            if (grader->totals[GRADER_MALFORMED] <= MAX_REPORTED_MALFORMED) {
+                g_printerr(
+                    "%s:%" G_GUINT64_FORMAT ": malformed record\n",
+                    grader->input_path,
+                    grader->line_count - grader->record_count + i + 1
+                );
+            }
+            continue;
+        }
+
+        if (!grader->has_student || strcmp(grader->student->str, record->student) != 0) {
+            write_summary(grader);
+
+            g_string_assign(grader->student, record->student);
+            memset(grader->counts, 0, sizeof(grader->counts));
+            grader->has_student = TRUE;
+        }
+
+        grader->counts[record->status]++;
+    }
+}
+
+static void write_summary(Grader *grader) {
+    guint64 answer_count, graded_count;
+    gdouble score;
+    gchar *line;
+    JsonNode *root;
+    JsonBuilder *builder;
+
+    if (!grader->has_student) {
+        return;
+    }
+
+    grader->student_count++;
+
+    // The answers about unknown cities are not graded.
+    graded_count = grader->counts[GRADER_CORRECT] + grader->counts[GRADER_INCORRECT];
+    answer_count = graded_count + grader->counts[GRADER_UNKNOWN_CITY];
+    score = graded_count > 0 ? (gdouble) grader->counts[GRADER_CORRECT] / graded_count : 0.0;
+
+    if (!grader->jsonl) {
+        write_csv_field(grader->output, grader->student->str);
+        fprintf(
+            grader->output,
+            ",%" G_GUINT64_FORMAT ",%" G_GUINT64_FORMAT ",%" G_GUINT64_FORMAT ",%" G_GUINT64_FORMAT ",%.4f\n",
+            answer_count,
+            grader->counts[GRADER_CORRECT],
+            grader->counts[GRADER_INCORRECT],
+            grader->counts[GRADER_UNKNOWN_CITY],
+            score
+        );
+        return;
+    }
+
+    builder = json_builder_new();
+
+    json_builder_begin_object(builder);
+    json_builder_set_member_name(builder, "student");
+    json_builder_add_string_value(builder, grader->student->str);
+    json_builder_set_member_name(builder, "answers");
+    json_builder_add_int_value(builder, (gint64) answer_count);
+    json_builder_set_member_name(builder, "correct");
+    json_builder_add_int_value(builder, (gint64) grader->counts[GRADER_CORRECT]);
+    json_builder_set_member_name(builder, "incorrect");
+    json_builder_add_int_value(builder, (gint64) grader->counts[GRADER_INCORRECT]);
+    json_builder_set_member_name(builder, "unknown_cities");
+    json_builder_add_int_value(builder, (gint64) grader->counts[GRADER_UNKNOWN_CITY]);
+    json_builder_set_member_name(builder, "score");
+    json_builder_add_double_value(builder, score);
+    json_builder_end_object(builder);
+
+    root = json_builder_get_root(builder);
+    json_generator_set_root(grader->generator, root);
+    line = json_generator_to_data(grader->generator, NULL);
+
+    fprintf(grader->output, "%s\n", line);
+
+    g_free(line);
+    json_node_unref(root);
+    g_object_unref(G_OBJECT(builder));
+}
+
+static void write_csv_field(FILE *output, const gchar *field) {
+    const gchar *c;
+
+    if (strpbrk(field, ",\"\r\n") == NULL) {
+        fputs(field, output);
+        return;
+    }
+
+    fputc('"', output);
+    for (c = field; *c != '\0'; c++) {
+        if (*c == '"') {
+            fputc('"', output);
+        }
+        fputc(*c, output);
+    }
+    fputc('"', output);
+}
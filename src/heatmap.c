@@ -0,0 +1,464 @@
+#include <math.h>
+#include <gtk/gtk.h>
+#include "heatmap.h"
+
+// Radius of a city in map units, it grows with the mean response time.
+#define HEATMAP_MIN_RADIUS 10.0
+#define HEATMAP_MAX_RADIUS 28.0
+#define HEATMAP_SLOW_RESPONSE_TIME 10000.0
+#define HEATMAP_ALPHA 0.65
+// A city is stored in the cell of its center, a blob never reaches
+// further than the neighbouring cells.
+#define HEATMAP_CELL_SIZE ((gint) (2 * HEATMAP_MAX_RADIUS))
+#define HEATMAP_CELL_KEY(column, row) GUINT_TO_POINTER(((guint) (row) << 16) | (guint) (column))
+
+// Accuracy (color) and mean response time (size) of every city, drawn as
+// soft blobs into a surface that covers the whole map in map units. The
+// surface is only updated where something changed: an answer marks its
+// city as dirty, the next call of heatmap_get_surface adds the old and the
+// new extents of the dirty cities to the dirty region and redraws only
+// that, using the grid to find the cities that reach into it. Growing the
+// region allocates, so it is left out of recording an answer.
+typedef struct heatmap_city_t {
+    gchar *name;
+    gboolean has_location;
+    gdouble x, y;
+    guint answer_count;
+    guint correct_count;
+    // Sum of the response times in milliseconds.
+    guint64 response_time;
+    // Answered since the last render, with the radius of the blob before.
+    gboolean dirty;
+    gdouble dirty_radius;
+} Heatmap_city;
+
+struct heatmap_t {
+    gint width, height;
+    GHashTable *cities;
+    GHashTable *grid;
+
+    cairo_surface_t *surface;
+    gint scale_factor;
+    cairo_region_t *dirty_region;
+    gboolean has_dirty_cities;
+};
+
+static Heatmap_city *heatmap_get_city(Heatmap *heatmap, const gchar *name);
+static void heatmap_city_free(gpointer data);
+static gdouble heatmap_city_radius(Heatmap_city *city);
+static void heatmap_invalidate_city(Heatmap *heatmap, Heatmap_city *city);
+static void heatmap_invalidate_circle(Heatmap *heatmap, Heatmap_city *city, gdouble radius);
+static void heatmap_invalidate_dirty_cities(Heatmap *heatmap);
+static void heatmap_grid_add(Heatmap *heatmap, Heatmap_city *city);
+static void heatmap_grid_remove(Heatmap *heatmap, Heatmap_city *city);
+static void heatmap_render(Heatmap *heatmap);
+static void heatmap_render_rectangle(Heatmap *heatmap, cairo_t *cr,
+                                     const cairo_rectangle_int_t *rectangle
+);
+static void heatmap_draw_city(cairo_t *cr, Heatmap_city *city);
+
+Heatmap *heatmap_create(gint width, gint height) {
+    g_return_val_if_fail(width > 0 && height > 0, NULL);
+
+    Heatmap *heatmap;
+
+    heatmap = g_slice_new0(Heatmap);
+    heatmap->width = width;
+    heatmap->height = height;
+    heatmap->cities = g_hash_table_new_full(
+        g_str_hash, g_str_equal,
+        NULL, heatmap_city_free
+    );
+    heatmap->grid = g_hash_table_new_full(
+        g_direct_hash, g_direct_equal,
+        NULL, (GDestroyNotify) g_list_free
+    );
+    heatmap->dirty_region = cairo_region_create();
+
+    return heatmap;
+}
+
+void heatmap_destroy(Heatmap *heatmap) {
+    g_return_if_fail(heatmap != NULL);
+
+    if (heatmap->surface != NULL) {
+        cairo_surface_destroy(heatmap->surface);
+    }
+
+    cairo_region_destroy(heatmap->dirty_region);
+    g_hash_table_destroy(heatmap->grid);
+    g_hash_table_destroy(heatmap->cities);
+    g_slice_free(Heatmap, heatmap);
+}
+
+gboolean heatmap_load(Heatmap *heatmap, const gchar *path, GError **error) {
+    g_return_val_if_fail(heatmap != NULL, FALSE);
+    g_return_val_if_fail(path != NULL, FALSE);
+
+    gsize i;
+    gchar **names;
+    GKeyFile *key_file;
+    Heatmap_city *city;
+
+    key_file = g_key_file_new();
+    if (!g_key_file_load_from_file(key_file, path, G_KEY_FILE_NONE, error)) {
+        g_key_file_free(key_file);
+        return FALSE;
+    }
+
+    // One group per city, the locations come from the map.
+    names = g_key_file_get_groups(key_file, NULL);
+    for (i = 0; names[i] != NULL; i++) {
+        city = heatmap_get_city(heatmap, names[i]);
+        heatmap_invalidate_city(heatmap, city);
+
+        city->answer_count = (guint) MAX(0, g_key_file_get_integer(key_file, names[i], "answers", NULL));
+        city->correct_count = (guint) MAX(0, g_key_file_get_integer(key_file, names[i], "correct", NULL));
+        city->correct_count = MIN(city->correct_count, city->answer_count);
+        city->response_time = g_key_file_get_uint64(key_file, names[i], "response_time", NULL);
+
+        heatmap_invalidate_city(heatmap, city);
+    }
+
+    g_strfreev(names);
+    g_key_file_free(key_file);
+
+    return TRUE;
+}
+
+gboolean heatmap_save(Heatmap *heatmap, const gchar *path, GError **error) {
+    g_return_val_if_fail(heatmap != NULL, FALSE);
+    g_return_val_if_fail(path != NULL, FALSE);
+
+    gchar *directory;
+    gboolean saved;
+    gpointer value;
+    GKeyFile *key_file;
+    GHashTableIter iter;
+    Heatmap_city *city;
+
+    key_file = g_key_file_new();
+
+    g_hash_table_iter_init(&iter, heatmap->cities);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        city = (Heatmap_city *) value;
+
+        if (city->answer_count == 0) {
+            continue;
+        }
+
+        g_key_file_set_integer(key_file, city->name, "answers", (gint) city->answer_count);
+        g_key_file_set_integer(key_file, city->name, "correct", (gint) city->correct_count);
+        g_key_file_set_uint64(key_file, city->name, "response_time", city->response_time);
+    }
+
+    directory = g_path_get_dirname(path);
+    g_mkdir_with_parents(directory, 0755);
+    g_free(directory);
+
+    saved = g_key_file_save_to_file(key_file, path, error);
+    g_key_file_free(key_file);
+
+    return saved;
+}
+
+void heatmap_set_location(Heatmap *heatmap, const gchar *name, gdouble x, gdouble y) {
+    g_return_if_fail(heatmap != NULL);
+    g_return_if_fail(name != NULL);
+
+    Heatmap_city *city;
+
+    city = heatmap_get_city(heatmap, name);
+    if (city->has_location && city->x == x && city->y == y) {
+        return;
+    }
+
+    heatmap_invalidate_city(heatmap, city);
+    heatmap_grid_remove(heatmap, city);
+
+    city->has_location = TRUE;
+    city->x = x;
+    city->y = y;
+
+    heatmap_grid_add(heatmap, city);
+    heatmap_invalidate_city(heatmap, city);
+}
+
+void heatmap_clear_location(Heatmap *heatmap, const gchar *name) {
+    g_return_if_fail(heatmap != NULL);
+    g_return_if_fail(name != NULL);
+
+    Heatmap_city *city;
+
+    // The statistics are kept, the city may come back.
+    city = g_hash_table_lookup(heatmap->cities, name);
+    if (city == NULL || !city->has_location) {
+        return;
+    }
+
+    heatmap_invalidate_city(heatmap, city);
+    heatmap_grid_remove(heatmap, city);
+    city->has_location = FALSE;
+}
+
+void heatmap_record_answer(Heatmap *heatmap, const gchar *name, gboolean correct,
+                           guint response_time
+) {
+    g_return_if_fail(heatmap != NULL);
+    g_return_if_fail(name != NULL);
+
+    Heatmap_city *city;
+
+    city = heatmap_get_city(heatmap, name);
+
+    // The old and the new blob share the center, the larger of the two
+    // covers both of them.
+    if (city->answer_count > 0) {
+        city->dirty_radius = MAX(city->dirty_radius, heatmap_city_radius(city));
+    }
+    city->dirty = TRUE;
+    heatmap->has_dirty_cities = TRUE;
+
+    city->answer_count++;
+    city->correct_count += correct ? 1 : 0;
+    city->response_time += response_time;
+}
+
+cairo_surface_t *heatmap_get_surface(Heatmap *heatmap, gint scale_factor) {
+    g_return_val_if_fail(heatmap != NULL, NULL);
+
+    cairo_rectangle_int_t map_rectangle = {0, 0, heatmap->width, heatmap->height};
+
+    if (heatmap->surface == NULL || heatmap->scale_factor != scale_factor) {
+        if (heatmap->surface != NULL) {
+            cairo_surface_destroy(heatmap->surface);
+        }
+
+        // Drawn in map units, one map unit has scale_factor pixels.
+        heatmap->surface = cairo_image_surface_create(
+            CAIRO_FORMAT_ARGB32,
+            heatmap->width * scale_factor,
+            heatmap->height * scale_factor
+        );
+        cairo_surface_set_device_scale(heatmap->surface, scale_factor, scale_factor);
+        heatmap->scale_factor = scale_factor;
+
+        cairo_region_union_rectangle(heatmap->dirty_region, &map_rectangle);
+    }
+
+    if (heatmap->has_dirty_cities) {
+        heatmap_invalidate_dirty_cities(heatmap);
+    }
+
+    if (!cairo_region_is_empty(heatmap->dirty_region)) {
+        heatmap_render(heatmap);
+    }
+
+    return heatmap->surface;
+}
+
+gsize heatmap_get_memory_size(Heatmap *heatmap) {
+    g_return_val_if_fail(heatmap != NULL, 0);
+
+    // Only the surface, it is created when the heatmap is first shown.
+    if (heatmap->surface == NULL) {
+        return 0;
+    }
+
+    return (gsize) cairo_image_surface_get_stride(heatmap->surface) *
+           (gsize) cairo_image_surface_get_height(heatmap->surface);
+}
+
+static Heatmap_city *heatmap_get_city(Heatmap *heatmap, const gchar *name) {
+    Heatmap_city *city;
+
+    city = g_hash_table_lookup(heatmap->cities, name);
+    if (city == NULL) {
+        city = g_slice_new0(Heatmap_city);
+        city->name = g_strdup(name);
+        g_hash_table_insert(heatmap->cities, city->name, city);
+    }
+
+    return city;
+}
+
+static void heatmap_city_free(gpointer data) {
+    Heatmap_city *city = (Heatmap_city *) data;
+
+    g_free(city->name);
+    g_slice_free(Heatmap_city, city);
+}
+
+static gdouble heatmap_city_radius(Heatmap_city *city) {
+    gdouble mean_response_time;
+
+    mean_response_time = city->answer_count > 0 ?
+                         (gdouble) city->response_time / city->answer_count : 0;
+
+    return HEATMAP_MIN_RADIUS + (HEATMAP_MAX_RADIUS - HEATMAP_MIN_RADIUS) *
+           CLAMP(mean_response_time / HEATMAP_SLOW_RESPONSE_TIME, 0.0, 1.0);
+}
+
+static void heatmap_invalidate_city(Heatmap *heatmap, Heatmap_city *city) {
+    if (!city->has_location || city->answer_count == 0) {
+        return;
+    }
+
+    // The blob that was drawn may still have the radius from before the
+    // last answers.
+    heatmap_invalidate_circle(
+        heatmap, city,
+        city->dirty ? MAX(city->dirty_radius, heatmap_city_radius(city)) : heatmap_city_radius(city)
+    );
+}
+
+static void heatmap_invalidate_dirty_cities(Heatmap *heatmap) {
+    gpointer value;
+    GHashTableIter iter;
+    Heatmap_city *city;
+
+    g_hash_table_iter_init(&iter, heatmap->cities);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        city = (Heatmap_city *) value;
+
+        if (!city->dirty) {
+            continue;
+        }
+
+        heatmap_invalidate_city(heatmap, city);
+
+        city->dirty = FALSE;
+        city->dirty_radius = 0;
+    }
+
+    heatmap->has_dirty_cities = FALSE;
+}
+
+static void heatmap_invalidate_circle(Heatmap *heatmap, Heatmap_city *city, gdouble radius) {
+    cairo_rectangle_int_t rectangle;
+
+    rectangle.x = (gint) floor(city->x - radius);
+    rectangle.y = (gint) floor(city->y - radius);
+    rectangle.width = (gint) ceil(city->x + radius) - rectangle.x;
+    rectangle.height = (gint) ceil(city->y + radius) - rectangle.y;
+
+    cairo_region_union_rectangle(heatmap->dirty_region, &rectangle);
+}
+
+static void heatmap_grid_add(Heatmap *heatmap, Heatmap_city *city) {
+    GList *cell;
+    gpointer key;
+
+    key = HEATMAP_CELL_KEY(
+        CLAMP((gint) city->x, 0, heatmap->width - 1) / HEATMAP_CELL_SIZE,
+        CLAMP((gint) city->y, 0, heatmap->height - 1) / HEATMAP_CELL_SIZE
+    );
+
+    // The list is replaced in the table, the old head is not freed.
+    cell = g_hash_table_lookup(heatmap->grid, key);
+    g_hash_table_steal(heatmap->grid, key);
+    g_hash_table_insert(heatmap->grid, key, g_list_prepend(cell, city));
+}
+
+static void heatmap_grid_remove(Heatmap *heatmap, Heatmap_city *city) {
+    GList *cell;
+    gpointer key;
+
+    if (!city->has_location) {
+        return;
+    }
+
+    key = HEATMAP_CELL_KEY(
+        CLAMP((gint) city->x, 0, heatmap->width - 1) / HEATMAP_CELL_SIZE,
+        CLAMP((gint) city->y, 0, heatmap->height - 1) / HEATMAP_CELL_SIZE
+    );
+
+    cell = g_hash_table_lookup(heatmap->grid, key);
+    g_hash_table_steal(heatmap->grid, key);
+
+    cell = g_list_remove(cell, city);
+    if (cell != NULL) {
+        g_hash_table_insert(heatmap->grid, key, cell);
+    }
+}
+
+static void heatmap_render(Heatmap *heatmap) {
+    gint i, count;
+    cairo_t *cr;
+    cairo_rectangle_int_t rectangle;
+
+    cr = cairo_create(heatmap->surface);
+
+    count = cairo_region_num_rectangles(heatmap->dirty_region);
+    for (i = 0; i < count; i++) {
+        cairo_region_get_rectangle(heatmap->dirty_region, i, &rectangle);
+        heatmap_render_rectangle(heatmap, cr, &rectangle);
+    }
+
+    cairo_destroy(cr);
+
+    cairo_region_destroy(heatmap->dirty_region);
+    heatmap->dirty_region = cairo_region_create();
+}
+
+static void heatmap_render_rectangle(Heatmap *heatmap, cairo_t *cr,
+                                     const cairo_rectangle_int_t *rectangle
+) {
+    gint column, row;
+    gint first_column, last_column, first_row, last_row;
+    GList *i;
+
+    cairo_save(cr);
+    cairo_rectangle(cr, rectangle->x, rectangle->y, rectangle->width, rectangle->height);
+    cairo_clip(cr);
+
+    cairo_set_operator(cr, CAIRO_OPERATOR_CLEAR);
+    cairo_paint(cr);
+    cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
+
+    // The cities in the neighbouring cells may reach into the rectangle.
+    first_column = MAX(rectangle->x / HEATMAP_CELL_SIZE - 1, 0);
+    first_row = MAX(rectangle->y / HEATMAP_CELL_SIZE - 1, 0);
+    last_column = (rectangle->x + rectangle->width) / HEATMAP_CELL_SIZE + 1;
+    last_row = (rectangle->y + rectangle->height) / HEATMAP_CELL_SIZE + 1;
+
+    for (row = first_row; row <= last_row; row++) {
+        for (column = first_column; column <= last_column; column++) {
+            i = g_hash_table_lookup(heatmap->grid, HEATMAP_CELL_KEY(column, row));
+
+            for (; i != NULL; i = i->next) {
+                heatmap_draw_city(cr, (Heatmap_city *) i->data);
+            }
+        }
+    }
+
+    cairo_restore(cr);
+}
+
+static void heatmap_draw_city(cairo_t *cr, Heatmap_city *city) {
+    gdouble radius;
+    gdouble accuracy;
+    gdouble red, green;
+    cairo_pattern_t *pattern;
+
+    if (city->answer_count == 0) {
+        return;
+    }
+
+    radius = heatmap_city_radius(city);
+    accuracy = (gdouble) city->correct_count / city->answer_count;
+
+    // Red for the cities nobody knows, through yellow, to green.
+    red = CLAMP(2.0 * (1.0 - accuracy), 0.0, 1.0);
+    green = CLAMP(2.0 * accuracy, 0.0, 1.0);
+
+    pattern = cairo_pattern_create_radial(city->x, city->y, 0, city->x, city->y, radius);
+    cairo_pattern_add_color_stop_rgba(pattern, 0, red, green, 0.1, HEATMAP_ALPHA);
+    cairo_pattern_add_color_stop_rgba(pattern, 1, red, green, 0.1, 0);
+
+    cairo_set_source(cr, pattern);
+    cairo_arc(cr, city->x, city->y, radius, 0, 2 * G_PI);
+    cairo_fill(cr);
+
+    cairo_pattern_destroy(pattern);
+}
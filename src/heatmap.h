@@ -0,0 +1,20 @@
+#ifndef HEATMAP_H
+#define HEATMAP_H
+
+#include <gtk/gtk.h>
+
+typedef struct heatmap_t Heatmap;
+
+Heatmap *heatmap_create(gint width, gint height);
+void heatmap_destroy(Heatmap *heatmap);
+gboolean heatmap_load(Heatmap *heatmap, const gchar *path, GError **error);
+gboolean heatmap_save(Heatmap *heatmap, const gchar *path, GError **error);
+void heatmap_set_location(Heatmap *heatmap, const gchar *name, gdouble x, gdouble y);
+void heatmap_clear_location(Heatmap *heatmap, const gchar *name);
+void heatmap_record_answer(Heatmap *heatmap, const gchar *name, gboolean correct,
+                           guint response_time
+);
+cairo_surface_t *heatmap_get_surface(Heatmap *heatmap, gint scale_factor);
+gsize heatmap_get_memory_size(Heatmap *heatmap);
+
+#endif
@@ -0,0 +1,389 @@
+#include <string.h>
+#include <glib.h>
+#include "city.h"
+#include "index_cache.h"
+
+// The keys of the cities (see city_compute_keys) of a dataset, stored in
+// a file that is mapped and used in place, so a dataset that has not
+// changed since the last launch is loaded without transliterating the
+// names. The layout, little endian:
+//
+//   header   "GSIX", version, dataset hash (u64), dataset size (u64),
+//            dataset modification time (i64), city count, pool size
+//   entries  for every city in the order of the dataset, the offsets of
+//            its name, Latin, ASCII and Cyrillic key in the pool
+//   pool     NUL terminated strings
+//
+// A dataset with the size and the modification time of the cache is
+// used without hashing it, the hash is only compared when they differ.
+// The file is rebuilt when the hash of the dataset or the version does
+// not match, a change of the keys has to bump the version. The strings
+// are validated once, when the file is opened. Only the keys are cached:
+// the k-d tree and the distractors of the choices depend on the
+// positions of the map points, not on the dataset.
+#define INDEX_CACHE_MAGIC "GSIX"
+#define INDEX_CACHE_VERSION 2
+#define INDEX_CACHE_HEADER_SIZE 40
+#define INDEX_CACHE_ENTRY_SIZE (4 * sizeof(guint32))
+#define INDEX_CACHE_DIRECTORY "gradovi-srbije"
+#define INDEX_CACHE_FNV_OFFSET G_GUINT64_CONSTANT(14695981039346656037)
+#define INDEX_CACHE_FNV_PRIME G_GUINT64_CONSTANT(1099511628211)
+
+struct index_cache_t {
+    gint ref_count;
+    GMappedFile *file;
+    const guint8 *entries;
+    guint count;
+    const gchar *pool;
+    guint32 pool_size;
+};
+
+typedef struct index_cache_build_t {
+    gchar *path;
+    GBytes *dataset;
+    gint64 dataset_mtime;
+    GPtrArray *names;
+} Index_cache_build;
+
+// The paths of the caches that are being rebuilt, one build per path.
+static GHashTable *building_paths = NULL;
+static GMutex building_paths_mutex;
+
+static gboolean index_cache_validate(const guint8 *entries, guint count, const gchar *pool,
+                                     guint32 pool_size
+);
+static gpointer index_cache_build_thread(gpointer user_data);
+static void index_cache_write_u32(guint8 *buffer, guint32 value);
+static void index_cache_write_u64(guint8 *buffer, guint64 value);
+static guint32 index_cache_read_u32(const guint8 *buffer);
+static guint64 index_cache_read_u64(const guint8 *buffer);
+
+guint64 index_cache_hash(const guint8 *data, gsize size) {
+    g_return_val_if_fail(data != NULL || size == 0, 0);
+
+    gsize i;
+    guint64 hash = INDEX_CACHE_FNV_OFFSET;
+
+    // FNV-1a.
+    for (i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * INDEX_CACHE_FNV_PRIME;
+    }
+
+    return hash;
+}
+
+gchar *index_cache_get_path(const gchar *dataset_path) {
+    gchar *name, *path, *absolute_path, *current_directory;
+
+    // A single cache for the built-in cities and for every dataset file,
+    // it is replaced when the file changes.
+    if (dataset_path == NULL) {
+        name = g_strdup("cities.index");
+    } else {
+        if (g_path_is_absolute(dataset_path)) {
+            absolute_path = g_strdup(dataset_path);
+        } else {
+            current_directory = g_get_current_dir();
+            absolute_path = g_build_filename(current_directory, dataset_path, NULL);
+            g_free(current_directory);
+        }
+
+        name = g_strdup_printf(
+            "%016" G_GINT64_MODIFIER "x.index",
+            index_cache_hash((const guint8 *) absolute_path, strlen(absolute_path))
+        );
+        g_free(absolute_path);
+    }
+
+    path = g_build_filename(g_get_user_cache_dir(), INDEX_CACHE_DIRECTORY, name, NULL);
+    g_free(name);
+
+    return path;
+}
+
+Index_cache *index_cache_open(const gchar *path, GBytes *dataset, gint64 dataset_mtime,
+                              gboolean *stale
+) {
+    g_return_val_if_fail(path != NULL, NULL);
+    g_return_val_if_fail(dataset != NULL, NULL);
+    g_return_val_if_fail(stale != NULL, NULL);
+
+    gsize size, dataset_size;
+    guint32 count, pool_size;
+    const guint8 *data, *dataset_data;
+    GMappedFile *file;
+    Index_cache *cache;
+
+    file = g_mapped_file_new(path, FALSE, NULL);
+    if (file == NULL) {
+        return NULL;
+    }
+
+    data = (const guint8 *) g_mapped_file_get_contents(file);
+    size = g_mapped_file_get_length(file);
+
+    // An other version or a truncated file.
+    if (size < INDEX_CACHE_HEADER_SIZE ||
+        memcmp(data, INDEX_CACHE_MAGIC, 4) != 0 ||
+        index_cache_read_u32(data + 4) != INDEX_CACHE_VERSION) {
+        g_mapped_file_unref(file);
+        return NULL;
+    }
+
+    // An other dataset, hashed only when the file could have changed. A
+    // dataset that was saved again without changes keeps the cache, it is
+    // stale until it is rebuilt with the new modification time.
+    dataset_data = (const guint8 *) g_bytes_get_data(dataset, &dataset_size);
+    *stale = index_cache_read_u64(data + 16) != dataset_size ||
+             (gint64) index_cache_read_u64(data + 24) != dataset_mtime;
+
+    if (*stale && index_cache_read_u64(data + 8) != index_cache_hash(dataset_data, dataset_size)) {
+        g_mapped_file_unref(file);
+        return NULL;
+    }
+
+    count = index_cache_read_u32(data + 32);
+    pool_size = index_cache_read_u32(data + 36);
+
+    if (count > (size - INDEX_CACHE_HEADER_SIZE) / INDEX_CACHE_ENTRY_SIZE ||
+        pool_size == 0 ||
+        size != INDEX_CACHE_HEADER_SIZE + count * INDEX_CACHE_ENTRY_SIZE + pool_size ||
+        !index_cache_validate(
+            data + INDEX_CACHE_HEADER_SIZE, count,
+            (const gchar *) (data + INDEX_CACHE_HEADER_SIZE + count * INDEX_CACHE_ENTRY_SIZE), pool_size
+        )) {
+        g_mapped_file_unref(file);
+        return NULL;
+    }
+
+    cache = g_slice_new(Index_cache);
+    cache->ref_count = 1;
+    cache->file = file;
+    cache->entries = data + INDEX_CACHE_HEADER_SIZE;
+    cache->count = count;
+    cache->pool = (const gchar *) (cache->entries + count * INDEX_CACHE_ENTRY_SIZE);
+    cache->pool_size = pool_size;
+
+    return cache;
+}
+
+Index_cache *index_cache_ref(Index_cache *cache) {
+    g_return_val_if_fail(cache != NULL, NULL);
+
+    cache->ref_count++;
+
+    return cache;
+}
+
+void index_cache_unref(Index_cache *cache) {
+    g_return_if_fail(cache != NULL);
+
+    if (--cache->ref_count > 0) {
+        return;
+    }
+
+    g_mapped_file_unref(cache->file);
+    g_slice_free(Index_cache, cache);
+}
+
+gboolean index_cache_get_keys(Index_cache *cache, guint index, const gchar *name,
+                              const gchar **latin_key, const gchar **ascii_key,
+                              const gchar **cyrillic_key
+) {
+    g_return_val_if_fail(cache != NULL, FALSE);
+    g_return_val_if_fail(name != NULL, FALSE);
+
+    guint i;
+    const gchar *strings[4];
+
+    if (index >= cache->count) {
+        return FALSE;
+    }
+
+    // The offsets were checked by index_cache_open.
+    for (i = 0; i < G_N_ELEMENTS(strings); i++) {
+        strings[i] = cache->pool + index_cache_read_u32(
+            cache->entries + index * INDEX_CACHE_ENTRY_SIZE + i * sizeof(guint32)
+        );
+    }
+
+    // A dataset that changed without changing its size and modification
+    // time, or a collision of the hashes, is caught by the names.
+    if (strcmp(strings[0], name) != 0) {
+        return FALSE;
+    }
+
+    *latin_key = strings[1];
+    *ascii_key = strings[2];
+    *cyrillic_key = strings[3];
+
+    return TRUE;
+}
+
+gsize index_cache_get_memory_size(Index_cache *cache) {
+    g_return_val_if_fail(cache != NULL, 0);
+
+    return g_mapped_file_get_length(cache->file);
+}
+
+void index_cache_build(const gchar *path, GBytes *dataset, gint64 dataset_mtime,
+                       GPtrArray *names
+) {
+    g_return_if_fail(path != NULL);
+    g_return_if_fail(dataset != NULL);
+    g_return_if_fail(names != NULL);
+
+    Index_cache_build *build;
+
+    // A build that is already running is not started again, the next
+    // load rebuilds the cache if the dataset changed in the meantime.
+    g_mutex_lock(&building_paths_mutex);
+
+    if (building_paths == NULL) {
+        building_paths = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    }
+
+    if (g_hash_table_contains(building_paths, path)) {
+        g_mutex_unlock(&building_paths_mutex);
+        g_ptr_array_unref(names);
+        return;
+    }
+
+    g_hash_table_add(building_paths, g_strdup(path));
+    g_mutex_unlock(&building_paths_mutex);
+
+    build = g_slice_new(Index_cache_build);
+    build->path = g_strdup(path);
+    build->dataset = g_bytes_ref(dataset);
+    build->dataset_mtime = dataset_mtime;
+    build->names = names;
+
+    // Not joined, the file is replaced atomically, so a build cut short
+    // by the exit leaves the previous file.
+    g_thread_unref(g_thread_new("index-cache", index_cache_build_thread, build));
+}
+
+static gpointer index_cache_build_thread(gpointer user_data) {
+    Index_cache_build *build = (Index_cache_build *) user_data;
+
+    guint i, j;
+    gsize dataset_size;
+    const guint8 *dataset_data;
+    gchar *directory;
+    gchar *strings[4];
+    guint8 *entry;
+    GByteArray *file;
+    GString *pool;
+    GError *error = NULL;
+
+    file = g_byte_array_sized_new(INDEX_CACHE_HEADER_SIZE + build->names->len * INDEX_CACHE_ENTRY_SIZE);
+    g_byte_array_set_size(file, INDEX_CACHE_HEADER_SIZE + build->names->len * INDEX_CACHE_ENTRY_SIZE);
+    pool = g_string_new(NULL);
+
+    for (i = 0; i < build->names->len; i++) {
+        entry = file->data + INDEX_CACHE_HEADER_SIZE + i * INDEX_CACHE_ENTRY_SIZE;
+
+        strings[0] = (gchar *) g_ptr_array_index(build->names, i);
+        city_compute_keys(strings[0], &strings[1], &strings[2], &strings[3]);
+
+        for (j = 0; j < G_N_ELEMENTS(strings); j++) {
+            index_cache_write_u32(entry + j * sizeof(guint32), (guint32) pool->len);
+            g_string_append_len(pool, strings[j], (gssize) strlen(strings[j]) + 1);
+        }
+
+        g_free(strings[1]);
+        g_free(strings[2]);
+        g_free(strings[3]);
+    }
+
+    // Hashed here rather than by the loader, a dataset that has not
+    // changed is never hashed on the main thread.
+    dataset_data = (const guint8 *) g_bytes_get_data(build->dataset, &dataset_size);
+
+    memcpy(file->data, INDEX_CACHE_MAGIC, 4);
+    index_cache_write_u32(file->data + 4, INDEX_CACHE_VERSION);
+    index_cache_write_u64(file->data + 8, index_cache_hash(dataset_data, dataset_size));
+    index_cache_write_u64(file->data + 16, dataset_size);
+    index_cache_write_u64(file->data + 24, (guint64) build->dataset_mtime);
+    index_cache_write_u32(file->data + 32, build->names->len);
+    index_cache_write_u32(file->data + 36, (guint32) pool->len);
+    g_byte_array_append(file, (const guint8 *) pool->str, (guint) pool->len);
+
+    directory = g_path_get_dirname(build->path);
+    g_mkdir_with_parents(directory, 0700);
+
+    if (!g_file_set_contents(build->path, (const gchar *) file->data, file->len, &error)) {
+        g_printerr("%s\n", error->message);
+        g_error_free(error);
+    }
+
+    g_mutex_lock(&building_paths_mutex);
+    g_hash_table_remove(building_paths, build->path);
+    g_mutex_unlock(&building_paths_mutex);
+
+    g_free(directory);
+    g_string_free(pool, TRUE);
+    g_byte_array_free(file, TRUE);
+    g_ptr_array_unref(build->names);
+    g_bytes_unref(build->dataset);
+    g_free(build->path);
+    g_slice_free(Index_cache_build, build);
+
+    return NULL;
+}
+
+static gboolean index_cache_validate(const guint8 *entries, guint count, const gchar *pool,
+                                     guint32 pool_size
+) {
+    guint i;
+    guint32 offset;
+    const gchar *string, *end;
+
+    // Every string of the pool is terminated and valid, the keys are
+    // walked character by character.
+    if (pool[pool_size - 1] != '\0') {
+        return FALSE;
+    }
+
+    for (string = pool, end = pool + pool_size; string < end; string += strlen(string) + 1) {
+        if (!g_utf8_validate(string, -1, NULL)) {
+            return FALSE;
+        }
+    }
+
+    // An offset in the middle of a character would start an invalid
+    // string.
+    for (i = 0; i < count * 4; i++) {
+        offset = index_cache_read_u32(entries + i * sizeof(guint32));
+
+        if (offset >= pool_size || ((guchar) pool[offset] & 0xC0) == 0x80) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static void index_cache_write_u32(guint8 *buffer, guint32 value) {
+    buffer[0] = (guint8) value;
+    buffer[1] = (guint8) (value >> 8);
+    buffer[2] = (guint8) (value >> 16);
+    buffer[3] = (guint8) (value >> 24);
+}
+
+static void index_cache_write_u64(guint8 *buffer, guint64 value) {
+    index_cache_write_u32(buffer, (guint32) value);
+    index_cache_write_u32(buffer + 4, (guint32) (value >> 32));
+}
+
+static guint32 index_cache_read_u32(const guint8 *buffer) {
+    return (guint32) buffer[0] |
+           (guint32) buffer[1] << 8 |
+           (guint32) buffer[2] << 16 |
+           (guint32) buffer[3] << 24;
+}
+
+static guint64 index_cache_read_u64(const guint8 *buffer) {
+    return (guint64) index_cache_read_u32(buffer) |
+           (guint64) index_cache_read_u32(buffer + 4) << 32;
+}
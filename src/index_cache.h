@@ -0,0 +1,24 @@
+#ifndef INDEX_CACHE_H
+#define INDEX_CACHE_H
+
+#include <glib.h>
+
+typedef struct index_cache_t Index_cache;
+
+guint64 index_cache_hash(const guint8 *data, gsize size);
+gchar *index_cache_get_path(const gchar *dataset_path);
+Index_cache *index_cache_open(const gchar *path, GBytes *dataset, gint64 dataset_mtime,
+                              gboolean *stale
+);
+Index_cache *index_cache_ref(Index_cache *cache);
+void index_cache_unref(Index_cache *cache);
+gboolean index_cache_get_keys(Index_cache *cache, guint index, const gchar *name,
+                              const gchar **latin_key, const gchar **ascii_key,
+                              const gchar **cyrillic_key
+);
+gsize index_cache_get_memory_size(Index_cache *cache);
+void index_cache_build(const gchar *path, GBytes *dataset, gint64 dataset_mtime,
+                       GPtrArray *names
+);
+
+#endif
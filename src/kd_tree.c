@@ -0,0 +1,183 @@
+#include <string.h>
+#include <glib.h>
+#include "kd_tree.h"
+
+// Two dimensional k-d tree over the indices of the points, stored
+// implicitly: the root of a range of the array is its median element, the
+// left subtree is the part before it and the right subtree the part after
+// it. The ranges alternate between splitting on x and on y.
+struct kd_tree_t {
+    // x0, y0, x1, y1, ...
+    gdouble *points;
+    guint *indices;
+    guint count;
+};
+
+typedef struct kd_tree_split_t {
+    const Kd_tree *tree;
+    guint axis;
+} Kd_tree_split;
+
+typedef struct kd_tree_search_t {
+    const Kd_tree *tree;
+    guint point;
+    gdouble x, y;
+    // Sorted by the distance, at most k of them.
+    guint *nearest;
+    gdouble *distances;
+    guint found;
+    guint k;
+} Kd_tree_search;
+
+static void kd_tree_build(Kd_tree *tree, guint start, guint end, guint axis);
+static gint kd_tree_compare(gconstpointer a, gconstpointer b, gpointer user_data);
+static void kd_tree_search(Kd_tree_search *search, guint start, guint end, guint axis);
+static void kd_tree_search_add(Kd_tree_search *search, guint point, gdouble distance);
+
+Kd_tree *kd_tree_create(const gdouble *points, guint count) {
+    g_return_val_if_fail(points != NULL || count == 0, NULL);
+
+    guint i;
+    Kd_tree *tree;
+
+    tree = g_slice_new(Kd_tree);
+    tree->points = g_new(gdouble, 2 * count);
+    memcpy(tree->points, points, 2 * count * sizeof(gdouble));
+    tree->indices = g_new(guint, count);
+    tree->count = count;
+
+    for (i = 0; i < count; i++) {
+        tree->indices[i] = i;
+    }
+
+    kd_tree_build(tree, 0, count, 0);
+
+    return tree;
+}
+
+void kd_tree_destroy(Kd_tree *tree) {
+    g_return_if_fail(tree != NULL);
+
+    g_free(tree->indices);
+    g_free(tree->points);
+    g_slice_free(Kd_tree, tree);
+}
+
+guint kd_tree_find_nearest(Kd_tree *tree, guint point, guint *nearest, guint k) {
+    g_return_val_if_fail(tree != NULL, 0);
+    g_return_val_if_fail(point < tree->count, 0);
+    g_return_val_if_fail(nearest != NULL || k == 0, 0);
+
+    Kd_tree_search search;
+
+    if (k == 0) {
+        return 0;
+    }
+
+    // The point itself is not one of its neighbours.
+    search.tree = tree;
+    search.point = point;
+    search.x = tree->points[2 * point];
+    search.y = tree->points[2 * point + 1];
+    search.nearest = nearest;
+    search.distances = g_new(gdouble, k);
+    search.found = 0;
+    search.k = k;
+
+    kd_tree_search(&search, 0, tree->count, 0);
+
+    g_free(search.distances);
+
+    return search.found;
+}
+
+static void kd_tree_build(Kd_tree *tree, guint start, guint end, guint axis) {
+    guint middle;
+    Kd_tree_split split;
+
+    if (end - start <= 1) {
+        return;
+    }
+
+    split.tree = tree;
+    split.axis = axis;
+    g_qsort_with_data(
+        tree->indices + start, (gint) (end - start), sizeof(guint),
+        kd_tree_compare, &split
+    );
+
+    middle = start + (end - start) / 2;
+    kd_tree_build(tree, start, middle, axis ^ 1);
+    kd_tree_build(tree, middle + 1, end, axis ^ 1);
+}
+
+static gint kd_tree_compare(gconstpointer a, gconstpointer b, gpointer user_data) {
+    Kd_tree_split *split = (Kd_tree_split *) user_data;
+
+    gdouble value_a, value_b;
+
+    value_a = split->tree->points[2 * *(const guint *) a + split->axis];
+    value_b = split->tree->points[2 * *(const guint *) b + split->axis];
+
+    return (value_a > value_b) - (value_a < value_b);
+}
+
+static void kd_tree_search(Kd_tree_search *search, guint start, guint end, guint axis) {
+    guint middle, point;
+    gdouble dx, dy, split_distance;
+
+    if (start >= end) {
+        return;
+    }
+
+    middle = start + (end - start) / 2;
+    point = search->tree->indices[middle];
+
+    dx = search->tree->points[2 * point] - search->x;
+    dy = search->tree->points[2 * point + 1] - search->y;
+
+    if (point != search->point) {
+        kd_tree_search_add(search, point, dx * dx + dy * dy);
+    }
+
+    // The side of the split with the point first, the other one only if
+    // it can still hold a point closer than the k-th nearest one.
+    split_distance = axis == 0 ? dx : dy;
+
+    if (split_distance > 0) {
+        kd_tree_search(search, start, middle, axis ^ 1);
+    } else {
+        kd_tree_search(search, middle + 1, end, axis ^ 1);
+    }
+
+    if (search->found < search->k ||
+        split_distance * split_distance < search->distances[search->found - 1]) {
+        if (split_distance > 0) {
+            kd_tree_search(search, middle + 1, end, axis ^ 1);
+        } else {
+            kd_tree_search(search, start, middle, axis ^ 1);
+        }
+    }
+}
+
+static void kd_tree_search_add(Kd_tree_search *search, guint point, gdouble distance) {
+    guint i;
+
+    if (search->found == search->k) {
+        if (distance >= search->distances[search->k - 1]) {
+            return;
+        }
+
+        search->found--;
+    }
+
+    // Insertion into the sorted list, k is small.
+    for (i = search->found; i > 0 && search->distances[i - 1] > distance; i--) {
+        search->distances[i] = search->distances[i - 1];
+        search->nearest[i] = search->nearest[i - 1];
+    }
+
+    search->distances[i] = distance;
+    search->nearest[i] = point;
+    search->found++;
+}
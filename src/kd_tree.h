@@ -0,0 +1,12 @@
+#ifndef KD_TREE_H
+#define KD_TREE_H
+
+#include <glib.h>
+
+typedef struct kd_tree_t Kd_tree;
+
+Kd_tree *kd_tree_create(const gdouble *points, guint count);
+void kd_tree_destroy(Kd_tree *tree);
+guint kd_tree_find_nearest(Kd_tree *tree, guint point, guint *nearest, guint k);
+
+#endif
@@ -0,0 +1,199 @@
+#include <gtk/gtk.h>
+#include "label_cache.h"
+
+#define MAX_LABEL_SCALE 3
+// The look of the map point labels in styles.css before they were
+// rendered here: bold 14px text with a 1px black outline, 2px of padding
+// and a translucent background with rounded corners.
+#define LABEL_FONT "Noto Sans, Ubuntu, Liberation Sans, Helvetica, Arial, sans-serif Bold"
+#define LABEL_FONT_SIZE 14
+#define LABEL_PADDING 2
+#define LABEL_CORNER_RADIUS 0.1
+// Keys up to this size are looked up without allocating.
+#define LABEL_KEY_SIZE 128
+
+typedef struct label_color_t {
+    gdouble red, green, blue, alpha;
+} Label_color;
+
+static const Label_color text_colors[] = {
+    [LABEL_DEFAULT] = {0xEB / 255.0, 0xEB / 255.0, 0xEB / 255.0, 1.0},
+    [LABEL_CORRECT] = {0x32 / 255.0, 0xBE / 255.0, 0xA6 / 255.0, 1.0},
+    [LABEL_INCORRECT] = {0xF4 / 255.0, 0x43 / 255.0, 0x36 / 255.0, 1.0}
+};
+static const Label_color background_color = {78 / 255.0, 76 / 255.0, 70 / 255.0, 0.4};
+static const Label_color outline_color = {0.0, 0.0, 0.0, 1.0};
+static const gint outline_offsets[][2] = {{1, 0}, {0, -1}, {0, 1}, {-1, 0}};
+
+// "<variant>@<scale>x:<text>" -> cairo_surface_t, every label is laid out
+// and rendered once for every scale factor and variant.
+static GHashTable *surfaces = NULL;
+// Pixel data of all of the surfaces, in bytes.
+static gsize surfaces_size = 0;
+
+static cairo_surface_t *label_cache_render_surface(const gchar *text, Label_variant variant,
+                                                   gint scale
+);
+static void label_cache_add_background_path(cairo_t *cr, gdouble width, gdouble height);
+static void label_cache_set_source_color(cairo_t *cr, const Label_color *color);
+static void label_cache_surface_free(gpointer user_data);
+
+cairo_surface_t *label_cache_get_surface(const gchar *text, Label_variant variant,
+                                         gint scale
+) {
+    g_return_val_if_fail(text != NULL, NULL);
+    g_return_val_if_fail(variant <= LABEL_INCORRECT, NULL);
+
+    gint length;
+    gchar *key;
+    gchar key_buffer[LABEL_KEY_SIZE];
+    cairo_surface_t *surface;
+
+    scale = CLAMP(scale, 1, MAX_LABEL_SCALE);
+
+    if (surfaces == NULL) {
+        surfaces = g_hash_table_new_full(
+            g_str_hash, g_str_equal,
+            g_free, label_cache_surface_free
+        );
+    }
+
+    // A copy of the key is only made for a new surface.
+    length = g_snprintf(key_buffer, sizeof(key_buffer), "%d@%dx:%s", variant, scale, text);
+    if (length < (gint) sizeof(key_buffer)) {
+        key = key_buffer;
+    } else {
+        key = g_strdup_printf("%d@%dx:%s", variant, scale, text);
+    }
+
+    surface = (cairo_surface_t *) g_hash_table_lookup(surfaces, key);
+
+    if (surface == NULL) {
+        surface = label_cache_render_surface(text, variant, scale);
+        g_hash_table_insert(surfaces, key == key_buffer ? g_strdup(key) : key, surface);
+        surfaces_size += (gsize) cairo_image_surface_get_stride(surface) *
+                         (gsize) cairo_image_surface_get_height(surface);
+    } else if (key != key_buffer) {
+        g_free(key);
+    }
+
+    return surface;
+}
+
+void label_cache_clear(void) {
+    if (surfaces != NULL) {
+        g_hash_table_destroy(surfaces);
+        surfaces = NULL;
+        surfaces_size = 0;
+    }
+}
+
+gsize label_cache_get_memory_size(void) {
+    return surfaces_size;
+}
+
+static cairo_surface_t *label_cache_render_surface(const gchar *text, Label_variant variant,
+                                                   gint scale
+) {
+    gsize i;
+    gint width, height;
+    cairo_t *cr;
+    PangoLayout *layout;
+    PangoRectangle extents;
+    cairo_surface_t *surface;
+    PangoFontDescription *font;
+
+    // Laid out on a scratch surface first, the size of the label is not
+    // known before.
+    surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1, 1);
+    cr = cairo_create(surface);
+
+    font = pango_font_description_from_string(LABEL_FONT);
+    pango_font_description_set_absolute_size(font, LABEL_FONT_SIZE * PANGO_SCALE);
+
+    layout = pango_cairo_create_layout(cr);
+    pango_layout_set_font_description(layout, font);
+    pango_layout_set_text(layout, text, -1);
+    pango_layout_get_pixel_extents(layout, NULL, &extents);
+
+    cairo_destroy(cr);
+    cairo_surface_destroy(surface);
+
+    width = extents.width + 2 * LABEL_PADDING;
+    height = extents.height + 2 * LABEL_PADDING;
+
+    // The device scale keeps the logical size of the surface the same
+    // for every scale factor, as in the asset cache.
+    surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width * scale, height * scale);
+    cairo_surface_set_device_scale(surface, scale, scale);
+    cr = cairo_create(surface);
+
+    label_cache_add_background_path(cr, width, height);
+    label_cache_set_source_color(cr, &background_color);
+    cairo_fill(cr);
+
+    pango_cairo_update_layout(cr, layout);
+
+    label_cache_set_source_color(cr, &outline_color);
+    for (i = 0; i < G_N_ELEMENTS(outline_offsets); i++) {
+        cairo_move_to(
+            cr,
+            LABEL_PADDING - extents.x + outline_offsets[i][0],
+            LABEL_PADDING - extents.y + outline_offsets[i][1]
+        );
+        pango_cairo_show_layout(cr, layout);
+    }
+
+    label_cache_set_source_color(cr, &text_colors[variant]);
+    cairo_move_to(cr, LABEL_PADDING - extents.x, LABEL_PADDING - extents.y);
+    pango_cairo_show_layout(cr, layout);
+
+    cairo_destroy(cr);
+    g_object_unref(G_OBJECT(layout));
+    pango_font_description_free(font);
+
+    return surface;
+}
+
+static void label_cache_add_background_path(cairo_t *cr, gdouble width, gdouble height) {
+    // A border radius of 10% rounds the corners by 10% of the width and
+    // 10% of the height, so the corners are quarters of an ellipse.
+    cairo_save(cr);
+    cairo_scale(cr, width, height);
+
+    cairo_new_sub_path(cr);
+    cairo_save(cr);
+    cairo_translate(cr, 1 - LABEL_CORNER_RADIUS, LABEL_CORNER_RADIUS);
+    cairo_scale(cr, LABEL_CORNER_RADIUS, LABEL_CORNER_RADIUS);
+    cairo_arc(cr, 0, 0, 1, -G_PI / 2, 0);
+    cairo_restore(cr);
+
+    cairo_save(cr);
+    cairo_translate(cr, 1 - LABEL_CORNER_RADIUS, 1 - LABEL_CORNER_RADIUS);
+    cairo_scale(cr, LABEL_CORNER_RADIUS, LABEL_CORNER_RADIUS);
+    cairo_arc(cr, 0, 0, 1, 0, G_PI / 2);
+    cairo_restore(cr);
+
+    cairo_save(cr);
+    cairo_translate(cr, LABEL_CORNER_RADIUS, 1 - LABEL_CORNER_RADIUS);
+    cairo_scale(cr, LABEL_CORNER_RADIUS, LABEL_CORNER_RADIUS);
+    cairo_arc(cr, 0, 0, 1, G_PI / 2, G_PI);
+    cairo_restore(cr);
+
+    cairo_save(cr);
+    cairo_translate(cr, LABEL_CORNER_RADIUS, LABEL_CORNER_RADIUS);
+    cairo_scale(cr, LABEL_CORNER_RADIUS, LABEL_CORNER_RADIUS);
+    cairo_arc(cr, 0, 0, 1, G_PI, 3 * G_PI / 2);
+    cairo_restore(cr);
+
+    cairo_close_path(cr);
+    cairo_restore(cr);
+}
+
+static void label_cache_set_source_color(cairo_t *cr, const Label_color *color) {
+    cairo_set_source_rgba(cr, color->red, color->green, color->blue, color->alpha);
+}
+
+static void label_cache_surface_free(gpointer user_data) {
+    cairo_surface_destroy((cairo_surface_t *) user_data);
+}
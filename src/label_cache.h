@@ -0,0 +1,18 @@
+#ifndef LABEL_CACHE_H
+#define LABEL_CACHE_H
+
+#include <gtk/gtk.h>
+
+typedef enum label_variant_t {
+    LABEL_DEFAULT,
+    LABEL_CORRECT,
+    LABEL_INCORRECT
+} Label_variant;
+
+cairo_surface_t *label_cache_get_surface(const gchar *text, Label_variant variant,
+                                         gint scale
+);
+void label_cache_clear(void);
+gsize label_cache_get_memory_size(void);
+
+#endif
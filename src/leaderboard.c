@@ -0,0 +1,781 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#ifdef G_OS_UNIX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "leaderboard.h"
+
+// File format, all of the numbers are little endian:
+//
+//   header   "GSLB", version (u32), sorted record count (u64)
+//   records  time (i64), sequence (u32), elapsed (u32),
+//            correct count (u16), incorrect count (u16),
+//            mode (u8), difficulty (u8), reserved (u16)
+//
+// leaderboard_save writes the boards of every mode and difficulty one
+// after another in rank order, so loading them only appends to the skip
+// lists. leaderboard_save_entry appends single unsorted records after the
+// sorted ones, they are inserted one by one when the file is loaded.
+//
+// Several instances of the game may share the file. Appending and
+// compacting (leaderboard_compact) hold a lock on "<path>.lock", and the
+// compaction folds the records that are in the file at that moment, not
+// the ones that were loaded, so no instance drops the results of another.
+// The lock is only taken on Unix.
+#define LEADERBOARD_MAGIC "GSLB"
+#define LEADERBOARD_VERSION 1
+#define LEADERBOARD_HEADER_SIZE 16
+#define LEADERBOARD_RECORD_SIZE 24
+#define LEADERBOARD_LOCK_SUFFIX ".lock"
+
+#define SKIP_LIST_MAX_LEVEL 32
+// A node has a link on the next level with this probability.
+#define SKIP_LIST_P 0.25
+
+#define BOARD_KEY(mode, difficulty) GUINT_TO_POINTER((guint) (mode) << 8 | (difficulty))
+
+// Indexed skip list: every link also stores how many nodes it skips (its
+// span), so the rank of an entry is the sum of the spans on the search
+// path. The span of a link to nothing is the number of nodes after its
+// node. Searching, inserting and ranking take O(log n) expected time.
+typedef struct skip_list_node_t Skip_list_node;
+
+typedef struct skip_list_link_t {
+    Skip_list_node *next;
+    guint span;
+} Skip_list_link;
+
+struct skip_list_node_t {
+    Leaderboard_entry entry;
+    guint level;
+    Skip_list_link links[];
+};
+
+typedef struct skip_list_t {
+    Skip_list_node *head;
+    guint level;
+    guint length;
+
+    // The last node on every level, only valid while appendable.
+    gboolean appendable;
+    Skip_list_node *tail[SKIP_LIST_MAX_LEVEL];
+    guint tail_rank[SKIP_LIST_MAX_LEVEL];
+} Skip_list;
+
+struct leaderboard_t {
+    GHashTable *boards;
+    guint32 next_sequence;
+    GRand *random_generator;
+    // Records that were appended after the sorted ones in the loaded file.
+    guint64 unsorted_count;
+};
+
+static Skip_list *skip_list_create(void);
+static void skip_list_destroy(gpointer data);
+static Skip_list_node *skip_list_node_create(guint level, const Leaderboard_entry *entry);
+static guint skip_list_random_level(GRand *random_generator);
+static guint skip_list_insert(Skip_list *list, const Leaderboard_entry *entry,
+                              GRand *random_generator
+);
+static void skip_list_append(Skip_list *list, const Leaderboard_entry *entry,
+                             GRand *random_generator
+);
+static guint skip_list_get_rank(Skip_list *list, const Leaderboard_entry *entry);
+static Skip_list *leaderboard_get_board(Leaderboard *leaderboard, guint8 mode,
+                                        guint8 difficulty, gboolean create
+);
+static void leaderboard_merge_boards(Leaderboard *leaderboard, guint8 mode);
+static gint leaderboard_compare_entries(const Leaderboard_entry *a, const Leaderboard_entry *b);
+static void leaderboard_write_record(guint8 *record, const Leaderboard_entry *entry);
+static void leaderboard_read_record(const guint8 *record, Leaderboard_entry *entry);
+static void leaderboard_write_header(guint8 *header, guint64 sorted_count);
+static gboolean leaderboard_lock(const gchar *path, gint *fd, GError **error);
+static void leaderboard_unlock(gint fd);
+
+Leaderboard *leaderboard_create(void) {
+    Leaderboard *leaderboard;
+
+    leaderboard = g_slice_new(Leaderboard);
+    leaderboard->boards = g_hash_table_new_full(
+        g_direct_hash, g_direct_equal,
+        NULL, skip_list_destroy
+    );
+    leaderboard->next_sequence = 0;
+    leaderboard->random_generator = g_rand_new();
+    leaderboard->unsorted_count = 0;
+
+    return leaderboard;
+}
+
+Leaderboard *leaderboard_load(const gchar *path, GError **error) {
+    g_return_val_if_fail(path != NULL, NULL);
+
+    gsize i;
+    gsize length;
+    guint64 sorted_count, record_count;
+    guint32 version;
+    guint8 mode;
+    gchar *contents;
+    gboolean *modes;
+    Skip_list *board;
+    Leaderboard *leaderboard;
+    Leaderboard_entry entry;
+
+    if (!g_file_get_contents(path, &contents, &length, error)) {
+        return NULL;
+    }
+
+    version = 0;
+    sorted_count = 0;
+    record_count = 0;
+
+    if (length >= LEADERBOARD_HEADER_SIZE) {
+        memcpy(&version, contents + 4, sizeof(version));
+        memcpy(&sorted_count, contents + 8, sizeof(sorted_count));
+        version = GUINT32_FROM_LE(version);
+        sorted_count = GUINT64_FROM_LE(sorted_count);
+
+        // A partially written record at the end is ignored.
+        record_count = (length - LEADERBOARD_HEADER_SIZE) / LEADERBOARD_RECORD_SIZE;
+    }
+
+    if (length < LEADERBOARD_HEADER_SIZE ||
+        memcmp(contents, LEADERBOARD_MAGIC, 4) != 0 ||
+        version != LEADERBOARD_VERSION ||
+        sorted_count > record_count) {
+        g_set_error(
+            error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+            "%s is not a valid leaderboard!", path
+        );
+
+        g_free(contents);
+        return NULL;
+    }
+
+    leaderboard = leaderboard_create();
+    modes = g_new0(gboolean, 256);
+
+    for (i = 0; i < sorted_count; i++) {
+        leaderboard_read_record(
+            (guint8 *) contents + LEADERBOARD_HEADER_SIZE + i * LEADERBOARD_RECORD_SIZE,
+            &entry
+        );
+
+        if (entry.difficulty == LEADERBOARD_ALL_DIFFICULTIES) {
+            continue;
+        }
+
+        board = leaderboard_get_board(leaderboard, entry.mode, entry.difficulty, TRUE);
+        if (board->appendable &&
+            (board->length == 0 ||
+             leaderboard_compare_entries(&board->tail[0]->entry, &entry) < 0)) {
+            skip_list_append(board, &entry, leaderboard->random_generator);
+        } else {
+            skip_list_insert(board, &entry, leaderboard->random_generator);
+        }
+
+        modes[entry.mode] = TRUE;
+        leaderboard->next_sequence = MAX(leaderboard->next_sequence, entry.sequence + 1);
+    }
+
+    for (i = 0; i < 256; i++) {
+        if (modes[i]) {
+            leaderboard_merge_boards(leaderboard, (guint8) i);
+        }
+    }
+
+    for (i = sorted_count; i < record_count; i++) {
+        leaderboard_read_record(
+            (guint8 *) contents + LEADERBOARD_HEADER_SIZE + i * LEADERBOARD_RECORD_SIZE,
+            &entry
+        );
+
+        if (entry.difficulty == LEADERBOARD_ALL_DIFFICULTIES) {
+            continue;
+        }
+
+        mode = entry.mode;
+        skip_list_insert(
+            leaderboard_get_board(leaderboard, mode, entry.difficulty, TRUE),
+            &entry, leaderboard->random_generator
+        );
+        skip_list_insert(
+            leaderboard_get_board(leaderboard, mode, LEADERBOARD_ALL_DIFFICULTIES, TRUE),
+            &entry, leaderboard->random_generator
+        );
+
+        leaderboard->next_sequence = MAX(leaderboard->next_sequence, entry.sequence + 1);
+    }
+
+    leaderboard->unsorted_count = record_count - sorted_count;
+
+    g_free(modes);
+    g_free(contents);
+
+    return leaderboard;
+}
+
+gboolean leaderboard_save(Leaderboard *leaderboard, const gchar *path, GError **error) {
+    g_return_val_if_fail(leaderboard != NULL, FALSE);
+    g_return_val_if_fail(path != NULL, FALSE);
+
+    guint8 *record;
+    guint64 count;
+    gchar *directory;
+    gboolean saved;
+    gpointer key, value;
+    GByteArray *contents;
+    GHashTableIter iter;
+    Skip_list_node *node;
+
+    contents = g_byte_array_new();
+    g_byte_array_set_size(contents, LEADERBOARD_HEADER_SIZE);
+
+    count = 0;
+    g_hash_table_iter_init(&iter, leaderboard->boards);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        // Every entry is also on the board of all difficulties.
+        if ((GPOINTER_TO_UINT(key) & 0xff) == LEADERBOARD_ALL_DIFFICULTIES) {
+            continue;
+        }
+
+        for (node = ((Skip_list *) value)->head->links[0].next; node != NULL;
+             node = node->links[0].next) {
+            g_byte_array_set_size(contents, contents->len + LEADERBOARD_RECORD_SIZE);
+            record = contents->data + contents->len - LEADERBOARD_RECORD_SIZE;
+
+            leaderboard_write_record(record, &node->entry);
+            count++;
+        }
+    }
+
+    leaderboard_write_header(contents->data, count);
+
+    directory = g_path_get_dirname(path);
+    g_mkdir_with_parents(directory, 0755);
+    g_free(directory);
+
+    // Written to a temporary file and renamed, so a crash never leaves
+    // a truncated board behind.
+    saved = g_file_set_contents(path, (gchar *) contents->data, contents->len, error);
+
+    g_byte_array_unref(contents);
+
+    return saved;
+}
+
+gboolean leaderboard_compact(const gchar *path, GError **error) {
+    g_return_val_if_fail(path != NULL, FALSE);
+
+    gint lock;
+    gboolean compacted;
+    GError *load_error = NULL;
+    Leaderboard *leaderboard;
+
+    if (!g_file_test(path, G_FILE_TEST_EXISTS)) {
+        return TRUE;
+    }
+
+    if (!leaderboard_lock(path, &lock, error)) {
+        return FALSE;
+    }
+
+    // Loaded again under the lock, with the records of every instance.
+    // A file that can not be read is never replaced.
+    leaderboard = leaderboard_load(path, &load_error);
+
+    if (leaderboard == NULL) {
+        compacted = g_error_matches(load_error, G_FILE_ERROR, G_FILE_ERROR_NOENT);
+
+        if (compacted) {
+            g_error_free(load_error);
+        } else {
+            g_propagate_error(error, load_error);
+        }
+    } else if (leaderboard->unsorted_count == 0) {
+        compacted = TRUE;
+    } else {
+        compacted = leaderboard_save(leaderboard, path, error);
+    }
+
+    if (leaderboard != NULL) {
+        leaderboard_destroy(leaderboard);
+    }
+
+    leaderboard_unlock(lock);
+
+    return compacted;
+}
+
+gboolean leaderboard_save_entry(const gchar *path, const Leaderboard_entry *entry,
+                                GError **error
+) {
+    g_return_val_if_fail(path != NULL, FALSE);
+    g_return_val_if_fail(entry != NULL, FALSE);
+
+    gint lock;
+    FILE *file;
+    gchar *directory;
+    gboolean saved;
+    guint8 header[LEADERBOARD_HEADER_SIZE];
+    guint8 record[LEADERBOARD_RECORD_SIZE];
+
+    directory = g_path_get_dirname(path);
+    g_mkdir_with_parents(directory, 0755);
+    g_free(directory);
+
+    // Not in the middle of a compaction of an other instance.
+    if (!leaderboard_lock(path, &lock, error)) {
+        return FALSE;
+    }
+
+    file = g_fopen(path, "ab");
+    if (file == NULL) {
+        g_set_error(
+            error, G_FILE_ERROR, g_file_error_from_errno(errno),
+            "Could not open %s: %s", path, g_strerror(errno)
+        );
+        leaderboard_unlock(lock);
+        return FALSE;
+    }
+
+    saved = TRUE;
+
+    // A new file, nothing is sorted yet.
+    fseek(file, 0, SEEK_END);
+    if (ftell(file) == 0) {
+        leaderboard_write_header(header, 0);
+        saved = fwrite(header, sizeof(header), 1, file) == 1;
+    }
+
+    leaderboard_write_record(record, entry);
+    saved = saved && fwrite(record, sizeof(record), 1, file) == 1;
+    saved = fclose(file) == 0 && saved;
+
+    if (!saved) {
+        g_set_error(
+            error, G_FILE_ERROR, g_file_error_from_errno(errno),
+            "Could not write %s: %s", path, g_strerror(errno)
+        );
+    }
+
+    leaderboard_unlock(lock);
+
+    return saved;
+}
+
+void leaderboard_destroy(Leaderboard *leaderboard) {
+    g_return_if_fail(leaderboard != NULL);
+
+    g_hash_table_destroy(leaderboard->boards);
+    g_rand_free(leaderboard->random_generator);
+    g_slice_free(Leaderboard, leaderboard);
+}
+
+guint leaderboard_add(Leaderboard *leaderboard, Leaderboard_entry *entry) {
+    g_return_val_if_fail(leaderboard != NULL, 0);
+    g_return_val_if_fail(entry != NULL, 0);
+    g_return_val_if_fail(entry->difficulty != LEADERBOARD_ALL_DIFFICULTIES, 0);
+
+    guint rank;
+
+    entry->sequence = leaderboard->next_sequence++;
+
+    skip_list_insert(
+        leaderboard_get_board(leaderboard, entry->mode, LEADERBOARD_ALL_DIFFICULTIES, TRUE),
+        entry, leaderboard->random_generator
+    );
+    rank = skip_list_insert(
+        leaderboard_get_board(leaderboard, entry->mode, entry->difficulty, TRUE),
+        entry, leaderboard->random_generator
+    );
+
+    return rank;
+}
+
+guint leaderboard_get_rank(Leaderboard *leaderboard, const Leaderboard_entry *entry,
+                           guint8 difficulty
+) {
+    g_return_val_if_fail(leaderboard != NULL, 0);
+    g_return_val_if_fail(entry != NULL, 0);
+
+    Skip_list *board;
+
+    board = leaderboard_get_board(leaderboard, entry->mode, difficulty, FALSE);
+    if (board == NULL) {
+        return 0;
+    }
+
+    return skip_list_get_rank(board, entry);
+}
+
+guint leaderboard_get_count(Leaderboard *leaderboard, guint8 mode, guint8 difficulty) {
+    g_return_val_if_fail(leaderboard != NULL, 0);
+
+    Skip_list *board;
+
+    board = leaderboard_get_board(leaderboard, mode, difficulty, FALSE);
+
+    return board != NULL ? board->length : 0;
+}
+
+guint leaderboard_get_top(Leaderboard *leaderboard, guint8 mode, guint8 difficulty,
+                          const Leaderboard_entry **entries, guint count
+) {
+    g_return_val_if_fail(leaderboard != NULL, 0);
+    g_return_val_if_fail(entries != NULL || count == 0, 0);
+
+    guint i;
+    Skip_list *board;
+    Skip_list_node *node;
+
+    board = leaderboard_get_board(leaderboard, mode, difficulty, FALSE);
+    if (board == NULL) {
+        return 0;
+    }
+
+    node = board->head->links[0].next;
+    for (i = 0; i < count && node != NULL; i++, node = node->links[0].next) {
+        entries[i] = &node->entry;
+    }
+
+    return i;
+}
+
+static Skip_list *skip_list_create(void) {
+    guint i;
+    Skip_list *list;
+
+    list = g_slice_new0(Skip_list);
+    list->head = skip_list_node_create(SKIP_LIST_MAX_LEVEL, NULL);
+    list->appendable = TRUE;
+
+    for (i = 0; i < SKIP_LIST_MAX_LEVEL; i++) {
+        list->tail[i] = list->head;
+    }
+
+    return list;
+}
+
+static void skip_list_destroy(gpointer data) {
+    Skip_list *list = (Skip_list *) data;
+    Skip_list_node *node, *next;
+
+    for (node = list->head; node != NULL; node = next) {
+        next = node->links[0].next;
+        g_free(node);
+    }
+
+    g_slice_free(Skip_list, list);
+}
+
+static Skip_list_node *skip_list_node_create(guint level, const Leaderboard_entry *entry) {
+    Skip_list_node *node;
+
+    node = g_malloc0(sizeof(Skip_list_node) + level * sizeof(Skip_list_link));
+    node->level = level;
+
+    if (entry != NULL) {
+        node->entry = *entry;
+    }
+
+    return node;
+}
+
+static guint skip_list_random_level(GRand *random_generator) {
+    guint level = 1;
+
+    while (level < SKIP_LIST_MAX_LEVEL && g_rand_double(random_generator) < SKIP_LIST_P) {
+        level++;
+    }
+
+    return level;
+}
+
+static guint skip_list_insert(Skip_list *list, const Leaderboard_entry *entry,
+                              GRand *random_generator
+) {
+    guint i, level;
+    guint rank[SKIP_LIST_MAX_LEVEL];
+    Skip_list_node *update[SKIP_LIST_MAX_LEVEL];
+    Skip_list_node *node;
+
+    // The last node before the entry and its rank on every level.
+    node = list->head;
+    for (i = list->level; i-- > 0;) {
+        rank[i] = i == list->level - 1 ? 0 : rank[i + 1];
+
+        while (node->links[i].next != NULL &&
+               leaderboard_compare_entries(&node->links[i].next->entry, entry) < 0) {
+            rank[i] += node->links[i].span;
+            node = node->links[i].next;
+        }
+
+        update[i] = node;
+    }
+
+    level = skip_list_random_level(random_generator);
+    if (level > list->level) {
+        for (i = list->level; i < level; i++) {
+            rank[i] = 0;
+            update[i] = list->head;
+            update[i]->links[i].span = list->length;
+        }
+
+        list->level = level;
+    }
+
+    node = skip_list_node_create(level, entry);
+    for (i = 0; i < level; i++) {
+        node->links[i].next = update[i]->links[i].next;
+        node->links[i].span = update[i]->links[i].span - (rank[0] - rank[i]);
+
+        update[i]->links[i].next = node;
+        update[i]->links[i].span = rank[0] - rank[i] + 1;
+    }
+
+    // The higher links now skip one more node.
+    for (i = level; i < list->level; i++) {
+        update[i]->links[i].span++;
+    }
+
+    list->length++;
+    list->appendable = FALSE;
+
+    return rank[0] + 1;
+}
+
+static void skip_list_append(Skip_list *list, const Leaderboard_entry *entry,
+                             GRand *random_generator
+) {
+    guint i, level, rank;
+    Skip_list_node *node;
+
+    level = skip_list_random_level(random_generator);
+    if (level > list->level) {
+        for (i = list->level; i < level; i++) {
+            list->head->links[i].span = list->length;
+        }
+
+        list->level = level;
+    }
+
+    rank = list->length + 1;
+
+    node = skip_list_node_create(level, entry);
+    for (i = 0; i < level; i++) {
+        list->tail[i]->links[i].next = node;
+        list->tail[i]->links[i].span = rank - list->tail_rank[i];
+
+        list->tail[i] = node;
+        list->tail_rank[i] = rank;
+    }
+
+    for (i = level; i < list->level; i++) {
+        list->tail[i]->links[i].span++;
+    }
+
+    list->length++;
+}
+
+static guint skip_list_get_rank(Skip_list *list, const Leaderboard_entry *entry) {
+    guint i, rank;
+    Skip_list_node *node;
+
+    rank = 0;
+    node = list->head;
+    for (i = list->level; i-- > 0;) {
+        while (node->links[i].next != NULL &&
+               leaderboard_compare_entries(&node->links[i].next->entry, entry) <= 0) {
+            rank += node->links[i].span;
+            node = node->links[i].next;
+        }
+    }
+
+    if (node == list->head || leaderboard_compare_entries(&node->entry, entry) != 0) {
+        return 0;
+    }
+
+    return rank;
+}
+
+static Skip_list *leaderboard_get_board(Leaderboard *leaderboard, guint8 mode,
+                                        guint8 difficulty, gboolean create
+) {
+    Skip_list *board;
+
+    board = g_hash_table_lookup(leaderboard->boards, BOARD_KEY(mode, difficulty));
+    if (board == NULL && create) {
+        board = skip_list_create();
+        g_hash_table_insert(leaderboard->boards, BOARD_KEY(mode, difficulty), board);
+    }
+
+    return board;
+}
+
+static void leaderboard_merge_boards(Leaderboard *leaderboard, guint8 mode) {
+    guint i, best;
+    guint board_count;
+    Skip_list *all_board;
+    Skip_list_node *nodes[256];
+
+    // The boards of the difficulties are sorted, so the board of all of
+    // the difficulties is built by merging them.
+    board_count = 0;
+    for (i = 1; i < 256; i++) {
+        Skip_list *board = leaderboard_get_board(leaderboard, mode, (guint8) i, FALSE);
+
+        if (board != NULL && board->length > 0) {
+            nodes[board_count++] = board->head->links[0].next;
+        }
+    }
+
+    all_board = leaderboard_get_board(leaderboard, mode, LEADERBOARD_ALL_DIFFICULTIES, TRUE);
+
+    while (board_count > 0) {
+        best = 0;
+        for (i = 1; i < board_count; i++) {
+            if (leaderboard_compare_entries(&nodes[i]->entry, &nodes[best]->entry) < 0) {
+                best = i;
+            }
+        }
+
+        skip_list_append(all_board, &nodes[best]->entry, leaderboard->random_generator);
+
+        nodes[best] = nodes[best]->links[0].next;
+        if (nodes[best] == NULL) {
+            nodes[best] = nodes[--board_count];
+        }
+    }
+}
+
+static gint leaderboard_compare_entries(const Leaderboard_entry *a, const Leaderboard_entry *b) {
+    // More correct answers, less time, harder difficulty, earlier game.
+    if (a->correct_count != b->correct_count) {
+        return a->correct_count > b->correct_count ? -1 : 1;
+    }
+
+    if (a->elapsed != b->elapsed) {
+        return a->elapsed < b->elapsed ? -1 : 1;
+    }
+
+    if (a->difficulty != b->difficulty) {
+        return a->difficulty > b->difficulty ? -1 : 1;
+    }
+
+    if (a->sequence != b->sequence) {
+        return a->sequence < b->sequence ? -1 : 1;
+    }
+
+    return 0;
+}
+
+static void leaderboard_write_record(guint8 *record, const Leaderboard_entry *entry) {
+    guint64 time;
+    guint32 sequence, elapsed;
+    guint16 correct_count, incorrect_count;
+
+    time = GUINT64_TO_LE((guint64) entry->time);
+    sequence = GUINT32_TO_LE(entry->sequence);
+    elapsed = GUINT32_TO_LE(entry->elapsed);
+    correct_count = GUINT16_TO_LE(entry->correct_count);
+    incorrect_count = GUINT16_TO_LE(entry->incorrect_count);
+
+    memcpy(record, &time, 8);
+    memcpy(record + 8, &sequence, 4);
+    memcpy(record + 12, &elapsed, 4);
+    memcpy(record + 16, &correct_count, 2);
+    memcpy(record + 18, &incorrect_count, 2);
+    record[20] = entry->mode;
+    record[21] = entry->difficulty;
+    record[22] = 0;
+    record[23] = 0;
+}
+
+static void leaderboard_read_record(const guint8 *record, Leaderboard_entry *entry) {
+    guint64 time;
+    guint32 sequence, elapsed;
+    guint16 correct_count, incorrect_count;
+
+    memcpy(&time, record, 8);
+    memcpy(&sequence, record + 8, 4);
+    memcpy(&elapsed, record + 12, 4);
+    memcpy(&correct_count, record + 16, 2);
+    memcpy(&incorrect_count, record + 18, 2);
+
+    entry->time = (gint64) GUINT64_FROM_LE(time);
+    entry->sequence = GUINT32_FROM_LE(sequence);
+    entry->elapsed = GUINT32_FROM_LE(elapsed);
+    entry->correct_count = GUINT16_FROM_LE(correct_count);
+    entry->incorrect_count = GUINT16_FROM_LE(incorrect_count);
+    entry->mode = record[20];
+    entry->difficulty = record[21];
+}
+
+static void leaderboard_write_header(guint8 *header, guint64 sorted_count) {
+    guint32 version;
+
+    version = GUINT32_TO_LE(LEADERBOARD_VERSION);
+    sorted_count = GUINT64_TO_LE(sorted_count);
+
+    memcpy(header, LEADERBOARD_MAGIC, 4);
+    memcpy(header + 4, &version, 4);
+    memcpy(header + 8, &sorted_count, 8);
+}
+
+static gboolean leaderboard_lock(const gchar *path, gint *fd, GError **error) {
+#ifdef G_OS_UNIX
+    gchar *lock_path;
+    struct flock lock = {0};
+
+    lock_path = g_strconcat(path, LEADERBOARD_LOCK_SUFFIX, NULL);
+    *fd = g_open(lock_path, O_RDWR | O_CREAT, 0644);
+
+    if (*fd < 0) {
+        g_set_error(
+            error, G_FILE_ERROR, g_file_error_from_errno(errno),
+            "Could not open %s: %s", lock_path, g_strerror(errno)
+        );
+        g_free(lock_path);
+        return FALSE;
+    }
+
+    lock.l_type = F_WRLCK;
+    lock.l_whence = SEEK_SET;
+
+    // Released when the file is closed, also by a crash.
+    while (fcntl(*fd, F_SETLKW, &lock) != 0) {
+        if (errno != EINTR) {
+            g_set_error(
+                error, G_FILE_ERROR, g_file_error_from_errno(errno),
+                "Could not lock %s: %s", lock_path, g_strerror(errno)
+            );
+            close(*fd);
+            g_free(lock_path);
+            return FALSE;
+        }
+    }
+
+    g_free(lock_path);
+#else
+    (void) path;
+    (void) error;
+    *fd = -1;
+#endif
+
+    return TRUE;
+}
+
+static void leaderboard_unlock(gint fd) {
+#ifdef G_OS_UNIX
+    if (fd >= 0) {
+        close(fd);
+    }
+#else
+    (void) fd;
+#endif
+}
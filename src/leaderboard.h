@@ -0,0 +1,41 @@
+#ifndef LEADERBOARD_H
+#define LEADERBOARD_H
+
+#include <glib.h>
+
+// The board with the games of every difficulty of a mode.
+#define LEADERBOARD_ALL_DIFFICULTIES 0
+
+typedef struct leaderboard_t Leaderboard;
+
+typedef struct leaderboard_entry_t {
+    // The end of the game, in seconds since the epoch.
+    gint64 time;
+    // Orders the equal results, assigned by leaderboard_add.
+    guint32 sequence;
+    // The duration of the game, in milliseconds.
+    guint32 elapsed;
+    guint16 correct_count;
+    guint16 incorrect_count;
+    guint8 mode;
+    guint8 difficulty;
+} Leaderboard_entry;
+
+Leaderboard *leaderboard_create(void);
+Leaderboard *leaderboard_load(const gchar *path, GError **error);
+gboolean leaderboard_save(Leaderboard *leaderboard, const gchar *path, GError **error);
+gboolean leaderboard_compact(const gchar *path, GError **error);
+gboolean leaderboard_save_entry(const gchar *path, const Leaderboard_entry *entry,
+                                GError **error
+);
+void leaderboard_destroy(Leaderboard *leaderboard);
+guint leaderboard_add(Leaderboard *leaderboard, Leaderboard_entry *entry);
+guint leaderboard_get_rank(Leaderboard *leaderboard, const Leaderboard_entry *entry,
+                           guint8 difficulty
+);
+guint leaderboard_get_count(Leaderboard *leaderboard, guint8 mode, guint8 difficulty);
+guint leaderboard_get_top(Leaderboard *leaderboard, guint8 mode, guint8 difficulty,
+                          const Leaderboard_entry **entries, guint count
+);
+
+#endif
@@ -1,18 +1,55 @@
+#include <errno.h>
 #include <stdlib.h>
+#include <string.h>
+#include <signal.h>
 #include <gtk/gtk.h>
+#include <glib/gstdio.h>
+#ifdef G_OS_UNIX
+#include <glib-unix.h>
+#endif
 #include "city.h"
+#include "asset_cache.h"
+#include "label_cache.h"
 #include "map_point.h"
+#include "map_view.h"
+#include "reveal_scheduler.h"
+#include "frame_timer.h"
+#include "telemetry.h"
+#include "watchdog.h"
+#include "alloc_check.h"
+#include "ui_benchmark.h"
+#include "leaderboard.h"
+#include "memstats.h"
+#include "heatmap.h"
+#include "recording.h"
+#include "snapshot_writer.h"
+#include "tui.h"
+#include "control_socket.h"
 #include "game_data.h"
 #include "game_logic.h"
 
 #define RESOURCE_PATH(name) g_strdup_printf("/ns/dragi/gradovi-srbije/%s", name)
 #define TIMER_FORMAT "%02d:%02d:%02d"
+// Large enough for TIMER_FORMAT and for any guint.
+#define LABEL_STR_SIZE 16
+#define LEADERBOARD_FILE_NAME "leaderboard.bin"
+#define HEATMAP_FILE_NAME "heatmap.ini"
+// How long the names take to sweep across the map when all of them are
+// shown or hidden at once.
+#define REVEAL_STAGGER (300 * G_TIME_SPAN_MILLISECOND)
+// All of the resources of the application are below this path.
+#define RESOURCE_ROOT "/ns/dragi/gradovi-srbije"
+// Editors write a file in several steps, the reload waits until it is quiet.
+#define DATA_RELOAD_DELAY 250
 
 typedef struct {
     GtkWidget *main_window;
     GSList *mode_rb;
     GSList *difficulty_rb;
     GtkButton *mw_start_button, *mw_stop_button;
+    GtkToggleButton *mw_heatmap_button;
+    GtkWidget *mw_map_overlay;
+    GtkDrawingArea *mw_map_drawing_area;
     GtkFixed *mw_map_points_fixed;
 
     GtkRevealer *mw_game_info_revealer;
@@ -25,10 +62,14 @@ typedef struct {
 
     GtkRevealer *mw_instruction_revealer;
 
+    // Built on the first use, NULL until then.
     GtkPopover *question_popover;
     GtkEntry *qp_city_entry;
     GtkEntryCompletion *qp_city_entry_completion;
 
+    GtkPopover *choice_popover;
+    GtkButton *cp_choice_buttons[GAME_CHOICE_COUNT];
+
     GtkPopover *description_popover;
     GtkLabel *dp_city_description_label;
 
@@ -38,55 +79,258 @@ typedef struct {
     GtkDialog *game_end_dialog;
 } App_widgets;
 
+// The game flow is driven only by events (button clicks, timers and
+// dialog responses), every event is ignored unless the application
+// is in the state that expects it.
+typedef enum app_state_t {
+    APP_IDLE,
+    APP_WAITING_FOR_ANSWER,
+    APP_SHOWING_CORRECT_LOCATION,
+    APP_SHOWING_END_GAME_DIALOG
+} App_state;
+
 typedef struct app_context_t {
     App_widgets *widgets;
     Game_data *data;
+    // The newest data from --watch-data, while some of its changes wait
+    // for the running game to end.
+    Game_data *pending_data;
+    GFileMonitor *data_monitor;
+    guint data_reload_id;
+    // Map points of the glade file without a city, reused when a city
+    // with the same name is added.
+    GHashTable *unused_map_points;
     Game *game;
+    Map_view *map_view;
+    Reveal_scheduler *reveal_scheduler;
+    App_state state;
+    Telemetry *telemetry;
+    Recorder *recorder;
+    Snapshot_writer *snapshot_writer;
+    Control_socket *control_socket;
+    Leaderboard *leaderboard;
+    gchar *leaderboard_path;
+    Heatmap *heatmap;
+    gchar *heatmap_path;
+    // When the current question was shown, for the response times.
+    gint64 question_start_time;
     GList *cities;
     GtkListStore *city_list_store;
-    guint popover_timeout_id;
+    // Heap growth from the rows of the store, 0 where it is unknown.
+    gsize city_list_store_size;
+    GtkCssProvider *style_provider;
+    guint memstats_source_id;
+    Frame_timer *popover_timer;
     GTimer *timer;
-    guint timer_timeout_id;
+    // Game time from before the relaunch of a restored game, in seconds.
+    gdouble timer_offset;
+    Frame_timer *timer_update;
+    // Text of the game information labels, formatted in the answer cycle
+    // and shown after it.
+    gchar correct_count_str[LABEL_STR_SIZE];
+    gchar incorrect_count_str[LABEL_STR_SIZE];
+    gchar remaining_count_str[LABEL_STR_SIZE];
+    gboolean window_mapped;
+    gboolean window_iconified;
+    guint memstats_report_id;
 } App_context;
 
+static gchar *telemetry_sink = NULL;
+static gint watchdog_budget = 0;
+static gchar *watchdog_log = NULL;
+static gint benchmark_iterations = 0;
+static gchar *control_socket_path = NULL;
+static gchar *watch_data_path = NULL;
+static gchar *record_path = NULL;
+static gchar *snapshot_path = NULL;
+static gboolean tui_mode = FALSE;
+static gboolean memstats = FALSE;
+
+static GOptionEntry option_entries[] = {
+    {
+        "telemetry", 't', 0, G_OPTION_ARG_FILENAME, &telemetry_sink,
+        "Write the game events as JSON lines to FILE (- for stdout)", "FILE"
+    },
+    {
+        "watchdog", 'w', 0, G_OPTION_ARG_INT, &watchdog_budget,
+        "Log the main loop iterations that take longer than MS milliseconds", "MS"
+    },
+    {
+        "watchdog-log", 0, 0, G_OPTION_ARG_FILENAME, &watchdog_log,
+        "Write the main loop stalls to FILE instead of stderr", "FILE"
+    },
+    {
+        "benchmark-ui", 0, 0, G_OPTION_ARG_INT, &benchmark_iterations,
+        "Time every user interface operation N times in an offscreen window and exit (needs a display)", "N"
+    },
+    {
+        "control-socket", 0, 0, G_OPTION_ARG_FILENAME, &control_socket_path,
+        "Accept JSON lines commands on the local socket PATH (automated tests)", "PATH"
+    },
+    {
+        "watch-data", 0, 0, G_OPTION_ARG_FILENAME, &watch_data_path,
+        "Load the cities from FILE and reload them whenever FILE changes", "FILE"
+    },
+    {
+        "record", 0, 0, G_OPTION_ARG_FILENAME, &record_path,
+        "Record the games to FILE, for the replayer", "FILE"
+    },
+    {
+        "snapshot", 0, 0, G_OPTION_ARG_FILENAME, &snapshot_path,
+        "Save the running game to FILE after every answer and resume it from FILE at startup", "FILE"
+    },
+    {
+        "memstats", 0, 0, G_OPTION_ARG_NONE, &memstats,
+        "Print the memory used by every subsystem once the main window is shown (also on SIGUSR1)", NULL
+    },
+    {
+        "tui", 0, 0, G_OPTION_ARG_NONE, &tui_mode,
+        "Play the typing mode in the terminal, without the graphical interface", NULL
+    },
+    {NULL, 0, 0, G_OPTION_ARG_NONE, NULL, NULL, NULL}
+};
+
 // Auxiliary functions
-static void load_style(void);
+static gboolean has_option(int argc, char *argv[], const gchar *option);
+static gint run_tui(void);
+static GtkCssProvider *load_style(void);
 static void load_widgets(App_context *context, App_widgets *widgets);
+static GtkBuilder *load_fragment(App_context *context, const gchar *name);
+static GtkPopover *get_question_popover(App_context *context);
+static GtkPopover *get_choice_popover(App_context *context);
+static GtkPopover *get_description_popover(App_context *context);
+static GtkPopover *get_correct_location_popover(App_context *context);
+static GtkDialog *get_game_end_dialog(App_context *context);
+static void report_memory(App_context *context);
+static gboolean on_memstats_report(gpointer user_data);
+static gsize get_city_list_store_size(App_context *context);
+static gboolean on_memstats_signal(gpointer user_data);
+static void load_leaderboard(App_context *context);
+static guint add_leaderboard_entry(App_context *context, gdouble elapsed);
+static void load_heatmap(App_context *context);
+static void locate_heatmap_cities(App_context *context);
+static cairo_surface_t *get_heatmap_surface(gint scale_factor, gpointer user_data);
 static GtkListStore *create_city_list_store(App_context *context);
+static Game_data *load_data(void);
+static void collect_cities(App_context *context);
+static void map_point_free(gpointer user_data);
 gboolean entry_completion_match(G_GNUC_UNUSED GtkEntryCompletion *completion,
                                 const gchar *key, GtkTreeIter *iter,
                                 gpointer user_data
 );
 static void assign_map_point_to_city(GtkWidget *widget, gpointer user_data);
 static void toggle_map_points_state(App_context *context, gboolean toggle);
+static void toggle_map_point_state(App_context *context, Map_point *map_point, gboolean toggle);
 static guint toggle_mode_radio_buttons_state(App_widgets *widgets, gboolean toggle);
 static guint toggle_difficulty_radio_buttons_state(App_widgets *widgets, gboolean toggle);
+static void select_radio_button(GSList *radio_buttons, guint value);
 static void user_start_game(App_context *context);
+static void show_running_game(App_context *context);
+static void restore_snapshot(App_context *context);
+static void show_answered_map_points(App_context *context);
+static void reserve_snapshot(App_context *context);
+static void save_snapshot(App_context *context);
+static void delete_snapshot(App_context *context);
 static void user_stop_game(App_context *context);
 static void user_restart_game(App_context *context);
 static void user_check_answer(GtkButton *button, App_context *context);
+static gboolean answer_question(App_context *context, City *city, const gchar *user_answer);
 static void user_next_question(App_context *context);
+static gboolean advance_question(App_context *context);
+static void show_next_question(App_context *context, gboolean has_next);
+static void record_event(App_context *context, Telemetry_event_type type,
+                         City *city, gboolean correct
+);
+static void record_input(App_context *context, Recording_event_type type,
+                         const gchar *answer, gboolean correct
+);
 static void timer_start(App_context *context);
 static void timer_stop(App_context *context);
-static gboolean update_timer_label(gpointer user_data);
-static gchar *generate_timer_str(gint seconds);
+static gdouble timer_get_elapsed(App_context *context);
+static void timer_schedule_update(App_context *context);
+static void timer_update(gpointer user_data);
+static void update_timers_visibility(App_context *context);
+static void update_timer_label(gpointer user_data);
+static void generate_timer_str(gchar *timer_str, gsize size, gint seconds);
+static void set_label_text(GtkLabel *label, const gchar *text);
 static void update_game_information(App_context *context);
+static void format_game_information(App_context *context);
+static void show_game_information(App_context *context);
 static void show_map_point_description(GtkButton *button, App_context *context);
+static void show_question(App_context *context);
+static void hide_question(App_context *context);
 static void show_question_popover(App_context *context);
-static gchar *hide_question_popover(App_context *context);
+static void hide_question_popover(App_context *context);
+static void show_choice_popover(App_context *context);
+static void hide_choice_popover(App_context *context);
 static void notify_about_correct_map_point(
     const gchar *name,
     GtkButton *button,
     App_context *context
 );
-static gboolean hide_correct_location_popover(gpointer user_data);
-static gint show_end_game_dialog(App_context *context);
+static void hide_correct_location_popover(gpointer user_data);
+static void show_end_game_dialog(App_context *context);
+
+// Hot reload of the cities (--watch-data)
+static void watch_data(App_context *context);
+static void on_data_file_changed(G_GNUC_UNUSED GFileMonitor *monitor,
+                                 G_GNUC_UNUSED GFile *file,
+                                 G_GNUC_UNUSED GFile *other_file,
+                                 GFileMonitorEvent event_type,
+                                 gpointer user_data
+);
+static gboolean reload_data(gpointer user_data);
+static void apply_pending_data(App_context *context);
+static void apply_city_change(City *city, Game_data_change change, gpointer user_data);
+static void remove_city_row(App_context *context, City *city);
+
+// User interface benchmark (--benchmark-ui)
+static void benchmark_ui(App_context *context, guint iterations);
+static void benchmark_show_map_points(gpointer user_data, G_GNUC_UNUSED guint iteration);
+static void benchmark_hide_map_points(gpointer user_data, G_GNUC_UNUSED guint iteration);
+static void benchmark_prepare_description(gpointer user_data, G_GNUC_UNUSED guint iteration);
+static void benchmark_show_description(gpointer user_data, guint iteration);
+static void benchmark_prepare_restart(gpointer user_data, G_GNUC_UNUSED guint iteration);
+static void benchmark_restart(gpointer user_data, G_GNUC_UNUSED guint iteration);
+static void benchmark_prepare_typing_round(gpointer user_data, G_GNUC_UNUSED guint iteration);
+static void benchmark_typing_round(gpointer user_data, G_GNUC_UNUSED guint iteration);
+
+// Automation (--control-socket)
+static void start_control_socket(App_context *context);
+static void control_add_state(App_context *context, JsonBuilder *builder);
+static gboolean control_start(JsonObject *command, JsonBuilder *builder,
+                              gpointer user_data, GError **error
+);
+static gboolean control_click(JsonObject *command, JsonBuilder *builder,
+                              gpointer user_data, GError **error
+);
+static gboolean control_type(JsonObject *command, JsonBuilder *builder,
+                             gpointer user_data, GError **error
+);
+static gboolean control_choose(JsonObject *command, JsonBuilder *builder,
+                               gpointer user_data, GError **error
+);
+static gboolean control_restart(G_GNUC_UNUSED JsonObject *command, JsonBuilder *builder,
+                                gpointer user_data, GError **error
+);
+static gboolean control_stop(G_GNUC_UNUSED JsonObject *command, JsonBuilder *builder,
+                             gpointer user_data, GError **error
+);
+static gboolean control_state(G_GNUC_UNUSED JsonObject *command, JsonBuilder *builder,
+                              gpointer user_data, G_GNUC_UNUSED GError **error
+);
+static gboolean control_quit(G_GNUC_UNUSED JsonObject *command, JsonBuilder *builder,
+                             gpointer user_data, G_GNUC_UNUSED GError **error
+);
 
 // Callback functions
 void on_start_game_button_clicked(G_GNUC_UNUSED GtkButton *button, App_context *context);
 void on_stop_game_button_clicked(G_GNUC_UNUSED GtkButton *button, App_context *context);
 void on_map_point_button_clicked(GtkButton *button, App_context *context);
 void on_qp_city_entry_activate(G_GNUC_UNUSED GtkEntry *entry, App_context *context);
+void on_cp_choice_button_clicked(GtkButton *button, App_context *context);
+void on_mw_heatmap_button_toggled(GtkToggleButton *button, App_context *context);
+void on_game_end_dialog_response(GtkDialog *dialog, gint response_id, App_context *context);
 gboolean on_correct_location_popover_button_press_event(G_GNUC_UNUSED GtkWidget *widget,
                                                         G_GNUC_UNUSED GdkEvent *event,
                                                         G_GNUC_UNUSED App_context *context
@@ -110,56 +354,293 @@ gboolean on_question_popover_button_release_event(G_GNUC_UNUSED GtkWidget *widge
 gboolean on_question_popover_key_press_event(G_GNUC_UNUSED GtkWidget *widget,
                                              GdkEventKey *key,
                                              G_GNUC_UNUSED App_context *context);
+void on_main_window_scale_factor_notify(G_GNUC_UNUSED GObject *object,
+                                        G_GNUC_UNUSED GParamSpec *pspec,
+                                        App_context *context
+);
+gboolean on_main_window_map_event(G_GNUC_UNUSED GtkWidget *widget,
+                                  G_GNUC_UNUSED GdkEvent *event,
+                                  App_context *context
+);
+gboolean on_main_window_unmap_event(G_GNUC_UNUSED GtkWidget *widget,
+                                    G_GNUC_UNUSED GdkEvent *event,
+                                    App_context *context
+);
+gboolean on_main_window_window_state_event(G_GNUC_UNUSED GtkWidget *widget,
+                                           GdkEventWindowState *event,
+                                           App_context *context
+);
 void on_main_window_destroy(void);
 
 int main(int argc, char *argv[]) {
     App_context *context;
+    gboolean benchmark;
+    GError *error = NULL;
+    GOptionContext *option_context;
+
+    option_context = g_option_context_new(NULL);
+    g_option_context_add_main_entries(option_context, option_entries, NULL);
+
+    // The terminal mode never initializes GTK, the GTK options would open
+    // the display. The benchmark opens it itself, see below.
+    benchmark = has_option(argc, argv, "--benchmark-ui");
+    if (!has_option(argc, argv, "--tui")) {
+        g_option_context_add_group(option_context, gtk_get_option_group(!benchmark));
+    }
+
+    if (!g_option_context_parse(option_context, &argc, &argv, &error)) {
+        g_printerr("%s\n", error->message);
+
+        g_error_free(error);
+        g_option_context_free(option_context);
+        exit(EXIT_FAILURE);
+    }
+
+    g_option_context_free(option_context);
 
-    gtk_init(&argc, &argv);
+    if (tui_mode) {
+        exit(run_tui());
+    }
 
-    load_style();
+    // The offscreen window still needs a display. The benchmark is run
+    // from scripts, on a machine without one it is skipped instead of
+    // failing, xvfb-run or GDK_BACKEND=broadway provide one (see the
+    // benchmark-ui target of the Makefile).
+    if (benchmark && gdk_display_open_default() == NULL) {
+        g_printerr("--benchmark-ui: no display, skipped (run it under xvfb-run)\n");
+        exit(EXIT_SUCCESS);
+    }
 
     context = g_slice_new(App_context);
     context->widgets = g_slice_new(App_widgets);
-    context->data = game_data_create();
+    context->style_provider = load_style();
+    context->memstats_source_id = 0;
+    context->data = load_data();
+    context->pending_data = NULL;
+    context->data_monitor = NULL;
+    context->data_reload_id = 0;
+    context->unused_map_points = g_hash_table_new_full(
+        g_str_hash, g_str_equal,
+        g_free, map_point_free
+    );
     context->cities = game_data_get_cities(context->data);
     context->game = game_create(context->cities);
-    context->city_list_store = create_city_list_store(context);
-    context->popover_timeout_id = 0;
+    context->state = APP_IDLE;
+    context->question_start_time = 0;
+    context->telemetry = NULL;
+    context->recorder = NULL;
+    context->snapshot_writer = NULL;
+    context->control_socket = NULL;
     context->timer = g_timer_new();
+    context->timer_offset = 0;
     g_timer_stop(context->timer);
-    context->timer_timeout_id = 0;
+    context->window_mapped = FALSE;
+    context->window_iconified = FALSE;
+    context->memstats_report_id = 0;
 
     load_widgets(context, context->widgets);
+    collect_cities(context);
+    context->city_list_store = create_city_list_store(context);
+    load_leaderboard(context);
+    load_heatmap(context);
 
-    gtk_entry_completion_set_model(
-        context->widgets->qp_city_entry_completion,
-        GTK_TREE_MODEL(context->city_list_store)
+    // Both of the timers stay suspended until the window is mapped.
+    context->timer_update = frame_timer_create(
+        context->widgets->main_window,
+        timer_update,
+        context
     );
-    gtk_entry_completion_set_match_func(
-        context->widgets->qp_city_entry_completion,
-        entry_completion_match,
-        context,
-        NULL
+    context->popover_timer = frame_timer_create(
+        context->widgets->main_window,
+        hide_correct_location_popover,
+        context
     );
+    frame_timer_suspend(context->timer_update);
+    frame_timer_suspend(context->popover_timer);
 
     toggle_map_points_state(context, TRUE);
 
-    gtk_widget_show(context->widgets->main_window);
-    gtk_main();
+    if (telemetry_sink != NULL) {
+        context->telemetry = telemetry_create(telemetry_sink, &error);
+
+        if (error != NULL) {
+            g_printerr("%s\n", error->message);
+
+            g_error_free(error);
+            error = NULL;
+        }
+    }
+
+    if (record_path != NULL) {
+        context->recorder = recorder_create(record_path, context->cities, &error);
+
+        if (error != NULL) {
+            g_printerr("%s\n", error->message);
+
+            g_error_free(error);
+            error = NULL;
+        }
+    }
+
+    if (snapshot_path != NULL) {
+        context->snapshot_writer = snapshot_writer_create(snapshot_path);
+    }
+
+    if (watchdog_budget > 0 &&
+        !watchdog_start((guint) watchdog_budget, watchdog_log, &error)) {
+        g_printerr("%s\n", error->message);
+
+        g_error_free(error);
+        error = NULL;
+    }
+
+    if (control_socket_path != NULL) {
+        start_control_socket(context);
+    }
+
+    if (watch_data_path != NULL) {
+        watch_data(context);
+    }
+
+#ifdef G_OS_UNIX
+    context->memstats_source_id = g_unix_signal_add(SIGUSR1, on_memstats_signal, context);
+#endif
+
+    if (benchmark_iterations > 0) {
+        benchmark_ui(context, (guint) benchmark_iterations);
+    } else {
+        // Restored before the window is shown, so the map points are
+        // drawn in their game state in the first frame.
+        if (snapshot_path != NULL) {
+            restore_snapshot(context);
+        }
+
+        gtk_widget_show(context->widgets->main_window);
+        gtk_main();
+    }
+
+    if (context->control_socket != NULL) {
+        control_socket_destroy(context->control_socket);
+    }
+    g_free(control_socket_path);
+
+    if (context->data_reload_id != 0) {
+        g_source_remove(context->data_reload_id);
+    }
+    if (context->data_monitor != NULL) {
+        g_object_unref(G_OBJECT(context->data_monitor));
+    }
+    if (context->pending_data != NULL) {
+        game_data_destroy(context->pending_data);
+    }
+    g_free(watch_data_path);
+
+    watchdog_stop();
+    g_free(watchdog_log);
+
+    ALLOC_CHECK_REPORT();
+
+    if (context->telemetry != NULL) {
+        telemetry_destroy(context->telemetry);
+    }
+    g_free(telemetry_sink);
+
+    if (context->recorder != NULL) {
+        recorder_destroy(context->recorder);
+    }
+    g_free(record_path);
+
+    // Writes the snapshot of a game that is still running.
+    if (context->snapshot_writer != NULL) {
+        snapshot_writer_destroy(context->snapshot_writer);
+    }
+    g_free(snapshot_path);
+
+    // Folds the entries appended by this and by every other instance into
+    // the sorted part, the file is read again for it.
+    if (context->leaderboard_path != NULL &&
+        !leaderboard_compact(context->leaderboard_path, &error)) {
+        g_printerr("%s\n", error->message);
+
+        g_error_free(error);
+        error = NULL;
+    }
+    leaderboard_destroy(context->leaderboard);
+    g_free(context->leaderboard_path);
+
+    if (context->heatmap != NULL) {
+        if (!heatmap_save(context->heatmap, context->heatmap_path, &error)) {
+            g_printerr("%s\n", error->message);
 
+            g_error_free(error);
+            error = NULL;
+        }
+        heatmap_destroy(context->heatmap);
+    }
+    g_free(context->heatmap_path);
+
+    if (context->memstats_report_id != 0) {
+        g_source_remove(context->memstats_report_id);
+    }
+
+    if (context->memstats_source_id != 0) {
+        g_source_remove(context->memstats_source_id);
+    }
+
+    frame_timer_destroy(context->popover_timer);
+    frame_timer_destroy(context->timer_update);
     g_timer_destroy(context->timer);
+    reveal_scheduler_destroy(context->reveal_scheduler);
+    map_view_destroy(context->map_view);
+    asset_cache_clear();
+    label_cache_clear();
     g_object_unref(G_OBJECT(context->city_list_store));
+    g_object_unref(G_OBJECT(context->style_provider));
     game_destroy(context->game);
     g_list_free(context->cities);
     game_data_destroy(context->data);
+    g_hash_table_destroy(context->unused_map_points);
     g_slice_free(App_widgets, context->widgets);
     g_slice_free(App_context, context);
 
     exit(EXIT_SUCCESS);
 }
 
-static void load_style() {
+static gboolean has_option(int argc, char *argv[], const gchar *option) {
+    gint i;
+
+    for (i = 1; i < argc; i++) {
+        // The arguments after -- are not options.
+        if (g_strcmp0(argv[i], "--") == 0) {
+            break;
+        }
+
+        // --option or --option=value
+        if (g_str_has_prefix(argv[i], option) &&
+            (argv[i][strlen(option)] == '\0' || argv[i][strlen(option)] == '=')) {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+static gint run_tui(void) {
+    gint status;
+    Game_data *data;
+
+    game_data_set_index_cache_rebuild(FALSE);
+
+    data = load_data();
+    status = tui_run(data);
+
+    game_data_destroy(data);
+    g_free(watch_data_path);
+
+    return status;
+}
+
+static GtkCssProvider *load_style() {
     gchar *path;
     GtkCssProvider *provider;
 
@@ -173,11 +654,14 @@ static void load_style() {
         GTK_STYLE_PROVIDER_PRIORITY_USER
     );
 
-    g_object_unref(G_OBJECT(provider));
     g_free(path);
+
+    // Kept for the memory report.
+    return provider;
 }
 
 static void load_widgets(App_context *context, App_widgets *widgets) {
+    gint map_width;
     gchar *path;
     GtkBuilder *builder;
 
@@ -197,6 +681,15 @@ static void load_widgets(App_context *context, App_widgets *widgets) {
     widgets->mw_stop_button = GTK_BUTTON(
         gtk_builder_get_object(builder, "mw_stop_button")
     );
+    widgets->mw_heatmap_button = GTK_TOGGLE_BUTTON(
+        gtk_builder_get_object(builder, "mw_heatmap_button")
+    );
+    widgets->mw_map_overlay = GTK_WIDGET(
+        gtk_builder_get_object(builder, "mw_map_overlay")
+    );
+    widgets->mw_map_drawing_area = GTK_DRAWING_AREA(
+        gtk_builder_get_object(builder, "mw_map_drawing_area")
+    );
     widgets->mw_map_points_fixed = GTK_FIXED(
         gtk_builder_get_object(builder, "mw_map_points_fixed")
     );
@@ -227,6 +720,66 @@ static void load_widgets(App_context *context, App_widgets *widgets) {
         gtk_builder_get_object(builder, "mw_instruction_revealer")
     );
 
+    // The popovers and the dialog are in separate glade files, built
+    // by their get_ functions.
+    widgets->question_popover = NULL;
+    widgets->qp_city_entry = NULL;
+    widgets->qp_city_entry_completion = NULL;
+    widgets->choice_popover = NULL;
+    widgets->description_popover = NULL;
+    widgets->dp_city_description_label = NULL;
+    widgets->correct_location_popover = NULL;
+    widgets->clp_city_name_label = NULL;
+    widgets->game_end_dialog = NULL;
+
+    context->map_view = map_view_create(
+        widgets->mw_map_overlay,
+        widgets->mw_map_drawing_area,
+        widgets->mw_map_points_fixed
+    );
+
+    // On a widget of the window content, so the names are also faded in
+    // the offscreen window of --benchmark-ui.
+    context->reveal_scheduler = reveal_scheduler_create(
+        GTK_WIDGET(widgets->mw_map_points_fixed)
+    );
+    map_view_get_map_size(context->map_view, &map_width, NULL);
+    reveal_scheduler_set_stagger(context->reveal_scheduler, REVEAL_STAGGER, map_width);
+
+    gtk_container_foreach(
+        GTK_CONTAINER(context->widgets->mw_map_points_fixed),
+        assign_map_point_to_city,
+        context
+    );
+
+    gtk_builder_connect_signals(builder, context);
+
+    g_object_unref(G_OBJECT(builder));
+    g_free(path);
+}
+
+static GtkBuilder *load_fragment(App_context *context, const gchar *name) {
+    gchar *path;
+    GtkBuilder *builder;
+
+    path = RESOURCE_PATH(name);
+    builder = gtk_builder_new_from_resource(path);
+    gtk_builder_connect_signals(builder, context);
+    g_free(path);
+
+    return builder;
+}
+
+static GtkPopover *get_question_popover(App_context *context) {
+    GtkBuilder *builder;
+    App_widgets *widgets = context->widgets;
+
+    if (widgets->question_popover != NULL) {
+        return widgets->question_popover;
+    }
+
+    builder = load_fragment(context, "question_popover.glade");
+
     widgets->question_popover = GTK_POPOVER(
         gtk_builder_get_object(builder, "question_popover")
     );
@@ -237,12 +790,87 @@ static void load_widgets(App_context *context, App_widgets *widgets) {
         gtk_builder_get_object(builder, "qp_city_entry_completion")
     );
 
+    // The window holds the popovers relative to its widgets, so they
+    // outlive the builder.
+    gtk_popover_set_relative_to(widgets->question_popover, GTK_WIDGET(widgets->mw_map_points_fixed));
+
+    gtk_entry_completion_set_model(
+        widgets->qp_city_entry_completion,
+        GTK_TREE_MODEL(context->city_list_store)
+    );
+    gtk_entry_completion_set_match_func(
+        widgets->qp_city_entry_completion,
+        entry_completion_match,
+        context,
+        NULL
+    );
+
+    g_object_unref(G_OBJECT(builder));
+
+    return widgets->question_popover;
+}
+
+static GtkPopover *get_choice_popover(App_context *context) {
+    guint i;
+    gchar *id;
+    GtkBuilder *builder;
+    App_widgets *widgets = context->widgets;
+
+    if (widgets->choice_popover != NULL) {
+        return widgets->choice_popover;
+    }
+
+    builder = load_fragment(context, "choice_popover.glade");
+
+    widgets->choice_popover = GTK_POPOVER(
+        gtk_builder_get_object(builder, "choice_popover")
+    );
+
+    for (i = 0; i < GAME_CHOICE_COUNT; i++) {
+        id = g_strdup_printf("cp_choice_button_%u", i);
+        widgets->cp_choice_buttons[i] = GTK_BUTTON(gtk_builder_get_object(builder, id));
+        g_free(id);
+    }
+
+    gtk_popover_set_relative_to(widgets->choice_popover, GTK_WIDGET(widgets->mw_map_points_fixed));
+
+    g_object_unref(G_OBJECT(builder));
+
+    return widgets->choice_popover;
+}
+
+static GtkPopover *get_description_popover(App_context *context) {
+    GtkBuilder *builder;
+    App_widgets *widgets = context->widgets;
+
+    if (widgets->description_popover != NULL) {
+        return widgets->description_popover;
+    }
+
+    builder = load_fragment(context, "description_popover.glade");
+
     widgets->description_popover = GTK_POPOVER(
         gtk_builder_get_object(builder, "description_popover")
     );
     widgets->dp_city_description_label = GTK_LABEL(
         gtk_builder_get_object(builder, "dp_city_description_label")
     );
+    gtk_popover_set_relative_to(widgets->description_popover, GTK_WIDGET(widgets->mw_map_points_fixed));
+
+    g_object_unref(G_OBJECT(builder));
+
+    return widgets->description_popover;
+}
+
+static GtkPopover *get_correct_location_popover(App_context *context) {
+    GtkBuilder *builder;
+    App_widgets *widgets = context->widgets;
+
+    if (widgets->correct_location_popover != NULL) {
+        return widgets->correct_location_popover;
+    }
+
+    builder = load_fragment(context, "correct_location_popover.glade");
 
     widgets->correct_location_popover = GTK_POPOVER(
         gtk_builder_get_object(builder, "correct_location_popover")
@@ -250,37 +878,150 @@ static void load_widgets(App_context *context, App_widgets *widgets) {
     widgets->clp_city_name_label = GTK_LABEL(
         gtk_builder_get_object(builder, "clp_city_name_label")
     );
+    gtk_popover_set_relative_to(widgets->correct_location_popover, GTK_WIDGET(widgets->mw_map_points_fixed));
+
+    g_object_unref(G_OBJECT(builder));
+
+    return widgets->correct_location_popover;
+}
+
+static GtkDialog *get_game_end_dialog(App_context *context) {
+    GtkBuilder *builder;
+    App_widgets *widgets = context->widgets;
+
+    if (widgets->game_end_dialog != NULL) {
+        return widgets->game_end_dialog;
+    }
+
+    builder = load_fragment(context, "game_end_dialog.glade");
 
+    // A toplevel, kept alive by GTK until the main window is destroyed.
     widgets->game_end_dialog = GTK_DIALOG(
         gtk_builder_get_object(builder, "game_end_dialog")
     );
-
-    gtk_container_foreach(
-        GTK_CONTAINER(context->widgets->mw_map_points_fixed),
-        assign_map_point_to_city,
-        context
+    gtk_window_set_transient_for(
+        GTK_WINDOW(widgets->game_end_dialog),
+        GTK_WINDOW(widgets->main_window)
     );
 
-    gtk_builder_connect_signals(builder, context);
-
     g_object_unref(G_OBJECT(builder));
-    g_free(path);
+
+    return widgets->game_end_dialog;
+}
+
+static void report_memory(App_context *context) {
+    gsize size;
+    gchar *css;
+    Memstats *stats;
+
+    stats = memstats_create();
+
+    // Uncompressed, the bundle is mapped with the executable and the
+    // pages are resident once they are read.
+    memstats_add(stats, "gresource bundle", memstats_get_resource_size(RESOURCE_ROOT));
+    memstats_add(stats, "coat of arms surfaces", asset_cache_get_memory_size());
+    memstats_add(stats, "city name surfaces", label_cache_get_memory_size());
+    memstats_add(stats, "map tiles", map_view_get_tiles_size(context->map_view));
+    if (context->heatmap != NULL) {
+        memstats_add(stats, "heatmap surface", heatmap_get_memory_size(context->heatmap));
+    }
+
+    memstats_add(stats, "cities", city_get_allocated_size());
+
+    size = game_data_get_index_cache_size(context->data);
+    if (context->pending_data != NULL) {
+        size += game_data_get_index_cache_size(context->pending_data);
+    }
+    memstats_add(stats, "index caches", size);
+
+    size = game_data_get_table_size(context->data);
+    if (context->pending_data != NULL) {
+        size += game_data_get_table_size(context->pending_data);
+    }
+    memstats_add_estimate(stats, "city tables", size);
+
+    // Counted from the heap while the rows were added and removed, so an
+    // allocation of an other thread in between (the index cache build) is
+    // included. Without a heap counter only the copied names are known.
+    if (memstats_get_heap_size() > 0) {
+        memstats_add(stats, "completion model", context->city_list_store_size);
+    } else {
+        memstats_add_estimate(stats, "completion model", get_city_list_store_size(context));
+    }
+
+    // Only the instance structures, the private data is not visible.
+    size = memstats_get_widget_size(context->widgets->main_window);
+    if (context->widgets->game_end_dialog != NULL) {
+        size += memstats_get_widget_size(GTK_WIDGET(context->widgets->game_end_dialog));
+    }
+    memstats_add_estimate(stats, "widgets", size);
+
+    // The parsed style sheet, serialized.
+    css = gtk_css_provider_to_string(context->style_provider);
+    memstats_add_estimate(stats, "CSS", strlen(css));
+    g_free(css);
+
+    memstats_print(stats);
+    memstats_destroy(stats);
+}
+
+static gsize get_city_list_store_size(App_context *context) {
+    City *city;
+    gsize size;
+    gboolean valid;
+    GtkTreeIter iter;
+    GtkTreeModel *model;
+
+    model = GTK_TREE_MODEL(context->city_list_store);
+    size = 0;
+
+    // The store keeps its own copy of every name, the rows are not known.
+    valid = gtk_tree_model_get_iter_first(model, &iter);
+    while (valid) {
+        gtk_tree_model_get(model, &iter, 1, &city, -1);
+        size += strlen(city_get_name(city)) + 1;
+
+        valid = gtk_tree_model_iter_next(model, &iter);
+    }
+
+    return size;
+}
+
+static gboolean on_memstats_report(gpointer user_data) {
+    App_context *context = (App_context *) user_data;
+
+    context->memstats_report_id = 0;
+    report_memory(context);
+
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean on_memstats_signal(gpointer user_data) {
+    report_memory((App_context *) user_data);
+
+    return G_SOURCE_CONTINUE;
 }
 
 static GtkListStore *create_city_list_store(App_context *context) {
     City *city;
     GList *i;
+    gsize heap_size;
     GtkTreeIter tree_iter;
     GtkListStore *list_store;
 
-    list_store = gtk_list_store_new(1, G_TYPE_STRING);
+    heap_size = memstats_get_heap_size();
+
+    // The name is shown by the completion, the city is used for matching.
+    list_store = gtk_list_store_new(2, G_TYPE_STRING, G_TYPE_POINTER);
     for (i = context->cities; i != NULL; i = i->next) {
         city = (City *) i->data;
 
         gtk_list_store_append(list_store, &tree_iter);
-        gtk_list_store_set(list_store, &tree_iter, 0, city_get_name(city), -1);
+        gtk_list_store_set(list_store, &tree_iter, 0, city_get_name(city), 1, city, -1);
     }
 
+    context->city_list_store_size = memstats_get_heap_size() - heap_size;
+
     return list_store;
 }
 
@@ -288,24 +1029,20 @@ gboolean entry_completion_match(G_GNUC_UNUSED GtkEntryCompletion *completion,
                                 const gchar *key, GtkTreeIter *iter,
                                 gpointer user_data
 ) {
-    gboolean possible_match;
-    GValue city_name = G_VALUE_INIT;
+    City *city;
 
-    gtk_tree_model_get_value(
+    gtk_tree_model_get(
         gtk_entry_completion_get_model(((App_context *) user_data)->widgets->qp_city_entry_completion),
         iter,
-        0,
-        &city_name
+        1, &city,
+        -1
     );
 
-    possible_match = g_str_match_string(key, g_value_get_string(&city_name), FALSE);
-
-    g_value_unset(&city_name);
-
-    return possible_match;
+    return city_matches_search(city, key);
 }
 
 static void assign_map_point_to_city(GtkWidget *widget, gpointer user_data) {
+    gint x, y;
     City *city;
     Map_point *map_point;
     GList *children, *i;
@@ -315,10 +1052,6 @@ static void assign_map_point_to_city(GtkWidget *widget, gpointer user_data) {
         gtk_widget_get_name(widget)
     );
 
-    if (city == NULL) {
-        return;
-    }
-
     map_point = map_point_create(
         GTK_CONTAINER(widget),
         NULL,
@@ -343,32 +1076,97 @@ static void assign_map_point_to_city(GtkWidget *widget, gpointer user_data) {
     }
     g_list_free(children);
 
+    gtk_container_child_get(
+        GTK_CONTAINER(((App_context *) user_data)->widgets->mw_map_points_fixed),
+        widget,
+        "x", &x,
+        "y", &y,
+        NULL
+    );
+    map_point_set_position(map_point, x, y);
+    map_view_add_map_point(((App_context *) user_data)->map_view, map_point);
+
+    if (city == NULL) {
+        gtk_widget_hide(widget);
+        g_hash_table_insert(
+            ((App_context *) user_data)->unused_map_points,
+            g_strdup(gtk_widget_get_name(widget)),
+            map_point
+        );
+        return;
+    }
+
     city_set_map_point(
         city,
         map_point
     );
 }
 
-static void toggle_map_points_state(App_context *context, gboolean toggle) {
-    GList *i;
-    Map_point *map_point;
+static Game_data *load_data(void) {
+    Game_data *data;
+    GError *error = NULL;
 
-    for (i = context->cities; i != NULL; i = i->next) {
-        map_point = city_get_map_point((City *) i->data);
+    if (watch_data_path == NULL) {
+        return game_data_create();
+    }
 
-        if (toggle) {
-            map_point_toggle_class_names(map_point, FALSE, 3, "mistery", "correct", "incorrect");
-            map_point_toggle_coat_of_arms(map_point, TRUE);
-            map_point_toggle_name(map_point, TRUE);
-            map_point_toggle_state(map_point, TRUE);
+    data = game_data_create_from_file(watch_data_path, &error);
+    if (data == NULL) {
+        g_printerr("%s\n", error->message);
+
+        g_error_free(error);
+        exit(EXIT_FAILURE);
+    }
+
+    return data;
+}
+
+static void collect_cities(App_context *context) {
+    GList *i;
+    City *city;
+
+    // Only the cities that can be shown on the map are played.
+    g_list_free(context->cities);
+    context->cities = NULL;
+
+    for (i = game_data_get_cities(context->data); i != NULL; i = g_list_delete_link(i, i)) {
+        city = (City *) i->data;
+
+        if (city_get_map_point(city) != NULL) {
+            context->cities = g_list_prepend(context->cities, city);
         } else {
-            map_point_toggle_coat_of_arms(map_point, FALSE);
-            map_point_toggle_name(map_point, FALSE);
-            map_point_toggle_class_names(map_point, TRUE, 1, "mistery");
+            g_printerr("%s has no map point, it is left out of the game\n", city_get_name(city));
+        }
+    }
 
-            if (game_get_mode(context->game) != SELECTION) {
-                map_point_toggle_state(map_point, FALSE);
-            }
+    game_set_cities(context->game, context->cities);
+}
+
+static void map_point_free(gpointer user_data) {
+    map_point_destroy((Map_point *) user_data);
+}
+
+static void toggle_map_points_state(App_context *context, gboolean toggle) {
+    GList *i;
+
+    for (i = context->cities; i != NULL; i = i->next) {
+        toggle_map_point_state(context, city_get_map_point((City *) i->data), toggle);
+    }
+}
+
+static void toggle_map_point_state(App_context *context, Map_point *map_point, gboolean toggle) {
+    if (toggle) {
+        map_point_toggle_class_names(map_point, FALSE, 3, "mistery", "correct", "incorrect");
+        map_point_toggle_coat_of_arms(map_point, TRUE);
+        reveal_scheduler_toggle(context->reveal_scheduler, map_point, TRUE, TRUE);
+        map_point_toggle_state(map_point, TRUE);
+    } else {
+        map_point_toggle_coat_of_arms(map_point, FALSE);
+        reveal_scheduler_toggle(context->reveal_scheduler, map_point, FALSE, TRUE);
+        map_point_toggle_class_names(map_point, TRUE, 1, "mistery");
+
+        if (game_get_mode(context->game) != SELECTION) {
+            map_point_toggle_state(map_point, FALSE);
         }
     }
 }
@@ -409,16 +1207,47 @@ static guint toggle_difficulty_radio_buttons_state(App_widgets *widgets, gboolea
     return difficulty;
 }
 
+static void select_radio_button(GSList *radio_buttons, guint value) {
+    GSList *i;
+
+    for (i = radio_buttons; i != NULL; i = i->next) {
+        if ((guint) atoi(gtk_widget_get_name(GTK_WIDGET(i->data))) == value) {
+            gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(i->data), TRUE);
+        }
+    }
+}
+
 static void user_start_game(App_context *context) {
     guint mode;
     guint difficulty;
 
+    if (context->state != APP_IDLE) {
+        return;
+    }
+
     mode = toggle_mode_radio_buttons_state(context->widgets, FALSE);
     difficulty = toggle_difficulty_radio_buttons_state(context->widgets, FALSE);
 
     game_set_mode(context->game, mode);
     game_set_difficulty(context->game, difficulty);
 
+    game_start(context->game);
+    timer_start(context);
+    record_event(context, TELEMETRY_GAME_START, NULL, FALSE);
+    record_input(context, RECORDING_START, NULL, FALSE);
+    reserve_snapshot(context);
+    save_snapshot(context);
+
+    show_running_game(context);
+
+    show_question(context);
+}
+
+static void show_running_game(App_context *context) {
+    guint mode;
+
+    mode = game_get_mode(context->game);
+
     gtk_widget_hide(GTK_WIDGET(context->widgets->mw_start_button));
     gtk_widget_show(GTK_WIDGET(context->widgets->mw_stop_button));
 
@@ -437,8 +1266,8 @@ static void user_start_game(App_context *context) {
 
     toggle_map_points_state(context, FALSE);
 
-    game_start(context->game);
-    timer_start(context);
+    context->state = APP_WAITING_FOR_ANSWER;
+    context->question_start_time = g_get_monotonic_time();
 
     update_game_information(context);
 
@@ -446,15 +1275,130 @@ static void user_start_game(App_context *context) {
         context->widgets->mw_game_info_revealer,
         TRUE
     );
+}
 
-    if (mode != SELECTION) {
-        show_question_popover(context);
+static void restore_snapshot(App_context *context) {
+    guint64 elapsed;
+    GBytes *snapshot;
+    GError *error = NULL;
+    GMappedFile *file;
+
+    file = g_mapped_file_new(snapshot_path, FALSE, &error);
+    if (file == NULL) {
+        if (!g_error_matches(error, G_FILE_ERROR, G_FILE_ERROR_NOENT)) {
+            g_printerr("%s\n", error->message);
+        }
+
+        g_error_free(error);
+        return;
+    }
+
+    snapshot = g_mapped_file_get_bytes(file);
+    g_mapped_file_unref(file);
+
+    if (!game_restore_snapshot(context->game, snapshot, &elapsed, &error)) {
+        g_printerr("%s: %s\n", snapshot_path, error->message);
+
+        g_error_free(error);
+        g_bytes_unref(snapshot);
+        delete_snapshot(context);
+        return;
+    }
+
+    g_bytes_unref(snapshot);
+    reserve_snapshot(context);
+
+    select_radio_button(context->widgets->mode_rb, game_get_mode(context->game));
+    select_radio_button(context->widgets->difficulty_rb, game_get_difficulty(context->game));
+    toggle_mode_radio_buttons_state(context->widgets, FALSE);
+    toggle_difficulty_radio_buttons_state(context->widgets, FALSE);
+
+    timer_start(context);
+    context->timer_offset = elapsed / 1000.0;
+    timer_schedule_update(context);
+
+    show_running_game(context);
+    show_answered_map_points(context);
+
+    // The snapshot is written right after the answer, before the game
+    // moves to the next question.
+    if (game_get_answer(context->game, game_get_question_index(context->game)) != GAME_NOT_ANSWERED) {
+        user_next_question(context);
+    } else {
+        show_question(context);
+    }
+}
+
+static void show_answered_map_points(App_context *context) {
+    guint i;
+    Game_answer answer;
+    Map_point *map_point;
+
+    // A single pass over the questions of the game, the rest of the map
+    // points are already in their game state.
+    for (i = 0; i < game_get_question_count(context->game); i++) {
+        answer = game_get_answer(context->game, i);
+        if (answer == GAME_NOT_ANSWERED) {
+            continue;
+        }
+
+        map_point = city_get_map_point(game_get_question_city(context->game, i));
+        reveal_scheduler_toggle(context->reveal_scheduler, map_point, TRUE, FALSE);
+        map_point_toggle_class_names(
+            map_point, TRUE, 1,
+            answer == GAME_CORRECT_ANSWER ? "correct" : "incorrect"
+        );
+
+        if (game_get_mode(context->game) == SELECTION) {
+            map_point_toggle_state(map_point, FALSE);
+        }
+    }
+}
+
+static void reserve_snapshot(App_context *context) {
+    if (context->snapshot_writer != NULL) {
+        snapshot_writer_reserve(
+            context->snapshot_writer,
+            game_get_snapshot_size(context->game)
+        );
+    }
+}
+
+static void save_snapshot(App_context *context) {
+    // Taken into the buffer reserved at the start of the game, the file
+    // is written by the snapshot thread.
+    if (context->snapshot_writer != NULL) {
+        snapshot_writer_save(
+            context->snapshot_writer,
+            context->game,
+            (guint64) (timer_get_elapsed(context) * 1000)
+        );
+    }
+}
+
+static void delete_snapshot(App_context *context) {
+    if (context->snapshot_writer != NULL) {
+        snapshot_writer_delete(context->snapshot_writer);
     }
 }
 
 static void user_stop_game(App_context *context) {
-    hide_question_popover(context);
+    if (context->state == APP_IDLE) {
+        return;
+    }
+
+    frame_timer_stop(context->popover_timer);
+    if (context->widgets->correct_location_popover != NULL) {
+        gtk_widget_hide(GTK_WIDGET(context->widgets->correct_location_popover));
+    }
+    if (context->widgets->game_end_dialog != NULL) {
+        gtk_widget_hide(GTK_WIDGET(context->widgets->game_end_dialog));
+    }
+    hide_question(context);
 
+    record_event(context, TELEMETRY_GAME_STOP, NULL, FALSE);
+    record_input(context, RECORDING_STOP, NULL, FALSE);
+    delete_snapshot(context);
     game_stop(context->game);
     timer_stop(context);
 
@@ -468,6 +1412,12 @@ static void user_stop_game(App_context *context) {
 
     toggle_mode_radio_buttons_state(context->widgets, TRUE);
     toggle_difficulty_radio_buttons_state(context->widgets, TRUE);
+
+    context->state = APP_IDLE;
+
+    if (context->pending_data != NULL) {
+        apply_pending_data(context);
+    }
 }
 
 static void user_restart_game(App_context *context) {
@@ -481,7 +1431,7 @@ static void user_restart_game(App_context *context) {
         map_point = city_get_map_point((City *) i->data);
         map_point_toggle_class_names(map_point, FALSE, 2, "correct", "incorrect");
         map_point_toggle_class_names(map_point, TRUE, 1, "mistery");
-        map_point_toggle_name(map_point, FALSE);
+        reveal_scheduler_toggle(context->reveal_scheduler, map_point, FALSE, TRUE);
         if (game_get_mode(context->game) == SELECTION) {
             map_point_toggle_state(map_point, TRUE);
         }
@@ -489,41 +1439,75 @@ static void user_restart_game(App_context *context) {
 
     game_start(context->game);
     timer_start(context);
+    context->state = APP_WAITING_FOR_ANSWER;
+    context->question_start_time = g_get_monotonic_time();
+    record_event(context, TELEMETRY_GAME_RESTART, NULL, FALSE);
+    record_input(context, RECORDING_RESTART, NULL, FALSE);
+    reserve_snapshot(context);
+    save_snapshot(context);
 
     update_game_information(context);
 
-    if (game_get_mode(context->game) != SELECTION) {
-        show_question_popover(context);
-    }
+    show_question(context);
 }
 
 static void user_check_answer(GtkButton *button, App_context *context) {
     City *city;
+    gboolean correct, has_next = TRUE;
     Map_point *map_point;
     const gchar *user_answer;
 
-    if (!game_is_running(context->game)) {
+    if (context->state == APP_IDLE) {
         show_map_point_description(button, context);
         return;
     }
 
+    // The map points and the entry are ignored while the correct
+    // location or the end game dialog is shown.
+    if (context->state != APP_WAITING_FOR_ANSWER) {
+        return;
+    }
+
     city = game_get_current_city(context->game);
     map_point = city_get_map_point(city);
-    map_point_toggle_class_names(map_point, TRUE, 1, "mistery");
-    map_point_toggle_name(map_point, TRUE);
 
-    if (game_get_mode(context->game) != SELECTION) {
-        user_answer = hide_question_popover(context);
+    if (game_get_mode(context->game) == TYPING) {
+        // Owned by the entry, so it is only valid until the popover is hidden.
+        user_answer = gtk_entry_get_text(context->widgets->qp_city_entry);
+    } else if (game_get_mode(context->game) == CHOICE) {
+        user_answer = gtk_button_get_label(button);
     } else {
         user_answer = gtk_widget_get_name(GTK_WIDGET(button));
+    }
+
+    // From the answer to the game information of the next question
+    // nothing allocates. The widgets are updated after it, GTK allocates
+    // in every change of a label, a style class or a popover.
+    ALLOC_CHECK_BEGIN("answer cycle");
+    correct = answer_question(context, city, user_answer);
+    if (correct) {
+        has_next = advance_question(context);
+    }
+    ALLOC_CHECK_END();
+
+    map_point_toggle_class_names(map_point, TRUE, 1, "mistery");
+    reveal_scheduler_toggle(context->reveal_scheduler, map_point, TRUE, FALSE);
+    if (game_get_mode(context->game) == SELECTION) {
         map_point_toggle_state(map_point, FALSE);
     }
 
-    if (game_check_user_answer(context->game, user_answer)) {
+    if (context->heatmap != NULL) {
+        map_view_queue_overlay_draw(context->map_view);
+    }
+
+    hide_question(context);
+
+    if (correct) {
         map_point_toggle_class_names(map_point, TRUE, 1, "correct");
     } else {
         map_point_toggle_class_names(map_point, TRUE, 1, "incorrect");
 
+        context->state = APP_SHOWING_CORRECT_LOCATION;
         notify_about_correct_map_point(
             city_get_name(city),
             map_point_get_button(map_point),
@@ -532,149 +1516,243 @@ static void user_check_answer(GtkButton *button, App_context *context) {
         return;
     }
 
-    if (game_get_mode(context->game) != SELECTION) {
-        // In this case the variable user_answer is a dynamically allocated string
-        g_free((gchar *) user_answer);
+    show_next_question(context, has_next);
+}
+
+static gboolean answer_question(App_context *context, City *city, const gchar *user_answer) {
+    gboolean correct;
+
+    correct = game_check_user_answer(context->game, user_answer);
+    record_event(context, TELEMETRY_ANSWER, city, correct);
+    record_input(context, RECORDING_ANSWER, user_answer, correct);
+    save_snapshot(context);
+
+    if (context->heatmap != NULL) {
+        heatmap_record_answer(
+            context->heatmap, city_get_name(city), correct,
+            (guint) ((g_get_monotonic_time() - context->question_start_time) / 1000)
+        );
     }
 
-    user_next_question(context);
+    return correct;
 }
 
 static void user_next_question(App_context *context) {
-    gint response_id;
+    gboolean has_next;
+
+    // After the correct location of a wrong answer, or of a restored game.
+    ALLOC_CHECK_BEGIN("next question cycle");
+    has_next = advance_question(context);
+    ALLOC_CHECK_END();
+
+    show_next_question(context, has_next);
+}
+
+static gboolean advance_question(App_context *context) {
     gboolean has_next;
 
     has_next = game_next_question(context->game);
-    update_game_information(context);
+    record_event(
+        context, TELEMETRY_NEXT_QUESTION,
+        game_get_current_city(context->game), FALSE
+    );
+    record_input(context, RECORDING_NEXT_QUESTION, NULL, FALSE);
+
+    format_game_information(context);
+
+    return has_next;
+}
+
+static void show_next_question(App_context *context, gboolean has_next) {
+    show_game_information(context);
 
     if (!has_next) {
         timer_stop(context);
-        response_id = show_end_game_dialog(context);
+        delete_snapshot(context);
 
-        switch (response_id) {
-            case GTK_RESPONSE_YES:
-                user_restart_game(context);
-                break;
-            default:
-                user_stop_game(context);
-                break;
-        }
+        // The response is handled in on_game_end_dialog_response.
+        context->state = APP_SHOWING_END_GAME_DIALOG;
+        show_end_game_dialog(context);
+        return;
+    }
+
+    context->state = APP_WAITING_FOR_ANSWER;
+    context->question_start_time = g_get_monotonic_time();
+
+    show_question(context);
+}
+
+static void record_event(App_context *context, Telemetry_event_type type,
+                         City *city, gboolean correct
+) {
+    Telemetry_event event;
 
+    if (context->telemetry == NULL) {
         return;
     }
 
-    if (game_get_mode(context->game) != SELECTION) {
-        show_question_popover(context);
+    event.time = g_get_real_time();
+    event.type = type;
+    event.mode = game_get_mode(context->game);
+    event.difficulty = game_get_difficulty(context->game);
+    event.correct = correct;
+    event.correct_count = game_get_correct_answer_count(context->game);
+    event.incorrect_count = game_get_incorrect_answer_count(context->game);
+    event.remaining_count = game_get_remaining_questions_count(context->game);
+    telemetry_event_set_city_name(&event, city != NULL ? city_get_name(city) : "");
+
+    // Never blocks, the event is dropped if the telemetry thread falls behind.
+    telemetry_push(context->telemetry, &event);
+}
+
+static void record_input(App_context *context, Recording_event_type type,
+                         const gchar *answer, gboolean correct
+) {
+    Recording_event event = {0};
+
+    if (context->recorder == NULL) {
+        return;
     }
+
+    // The cities of a game are recorded only by its seed.
+    event.type = type;
+    event.seed = game_get_seed(context->game);
+    event.mode = (guint8) game_get_mode(context->game);
+    event.difficulty = (guint8) game_get_difficulty(context->game);
+    event.correct = correct;
+    event.answer = answer;
+
+    recorder_write(context->recorder, &event);
 }
 
 static void timer_start(App_context *context) {
     g_timer_start(context->timer);
+    context->timer_offset = 0;
 
-    context->timer_timeout_id = g_timeout_add_seconds(
-        1,
-        update_timer_label,
-        context
-    );
+    timer_schedule_update(context);
 }
 
 static void timer_stop(App_context *context) {
-    if (context->timer_timeout_id > 0) {
+    if (frame_timer_is_active(context->timer_update)) {
         g_timer_stop(context->timer);
-        g_source_remove(context->timer_timeout_id);
-        context->timer_timeout_id = 0;
+        frame_timer_stop(context->timer_update);
+    }
+}
+
+static gdouble timer_get_elapsed(App_context *context) {
+    return context->timer_offset + g_timer_elapsed(context->timer, NULL);
+}
+
+static void timer_schedule_update(App_context *context) {
+    gdouble elapsed;
+
+    // Wake up only when the displayed second changes.
+    elapsed = timer_get_elapsed(context);
+
+    frame_timer_start(
+        context->timer_update,
+        (gint64) ((1.0 - (elapsed - (gint64) elapsed)) * G_USEC_PER_SEC)
+    );
+}
+
+static void timer_update(gpointer user_data) {
+    watchdog_enter(G_STRFUNC);
+
+    update_timer_label(user_data);
+    timer_schedule_update((App_context *) user_data);
+
+    watchdog_leave();
+}
+
+static void update_timers_visibility(App_context *context) {
+    // The game time is always taken from the GTimer, so the timer label
+    // is correct again in the first frame after the window is shown.
+    if (context->window_mapped && !context->window_iconified) {
+        frame_timer_resume(context->timer_update);
+        frame_timer_resume(context->popover_timer);
+    } else {
+        frame_timer_suspend(context->timer_update);
+        frame_timer_suspend(context->popover_timer);
     }
 }
 
-static gboolean update_timer_label(gpointer user_data) {
+static void update_timer_label(gpointer user_data) {
     gint seconds;
-    gchar *timer_str;
+    gchar timer_str[LABEL_STR_SIZE];
 
-    seconds = g_timer_elapsed(((App_context *) user_data)->timer, NULL);
-    timer_str = generate_timer_str(seconds);
+    ALLOC_CHECK_BEGIN("update_timer_label");
+    seconds = timer_get_elapsed((App_context *) user_data);
+    generate_timer_str(timer_str, sizeof(timer_str), seconds);
+    ALLOC_CHECK_END();
 
-    gtk_label_set_text(
+    set_label_text(
         ((App_context *) user_data)->widgets->mw_gi_timer_label,
         timer_str
     );
-
-    g_free(timer_str);
-
-    return G_SOURCE_CONTINUE;
 }
 
-static gchar *generate_timer_str(gint seconds) {
-    gchar *timer_str;
+static void generate_timer_str(gchar *timer_str, gsize size, gint seconds) {
     gint hours, minutes;
 
     minutes = seconds / 60;
     hours = (minutes / 60) % 24;
     minutes %= 60;
 
-    timer_str = g_strdup_printf(TIMER_FORMAT, hours, minutes, seconds % 60);
+    g_snprintf(timer_str, size, TIMER_FORMAT, hours, minutes, seconds % 60);
+}
 
-    return timer_str;
+static void set_label_text(GtkLabel *label, const gchar *text) {
+    // gtk_label_set_text copies the text and relayouts the label even
+    // when the text is the same.
+    if (g_strcmp0(gtk_label_get_text(label), text) != 0) {
+        gtk_label_set_text(label, text);
+    }
 }
 
 static void update_game_information(App_context *context) {
-    City *city;
-    const gchar *city_name_str;
-    gchar *correct_count_str;
-    gchar *incorrect_count_str;
-    gchar *remaining_count_str;
+    format_game_information(context);
+    show_game_information(context);
+}
 
-    correct_count_str = g_strdup_printf(
-        "%u",
+static void format_game_information(App_context *context) {
+    g_snprintf(
+        context->correct_count_str, sizeof(context->correct_count_str), "%u",
         game_get_correct_answer_count(context->game)
     );
 
-    incorrect_count_str = g_strdup_printf(
-        "%u",
+    g_snprintf(
+        context->incorrect_count_str, sizeof(context->incorrect_count_str), "%u",
         game_get_incorrect_answer_count(context->game)
     );
 
-    remaining_count_str = g_strdup_printf(
-        "%u",
+    g_snprintf(
+        context->remaining_count_str, sizeof(context->remaining_count_str), "%u",
         game_get_remaining_questions_count(context->game)
     );
+}
+
+static void show_game_information(App_context *context) {
+    City *city;
 
     if (game_get_mode(context->game) == SELECTION) {
         city = game_get_current_city(context->game);
-        if (city == NULL) {
-            city_name_str = "-";
-        } else {
-            city_name_str = city_get_name(city);
-        }
 
-        gtk_label_set_text(
+        set_label_text(
             context->widgets->mw_gi_city_name_label,
-            city_name_str
+            city != NULL ? city_get_name(city) : "-"
         );
     }
 
     update_timer_label(context);
 
-    gtk_label_set_text(
-        context->widgets->mw_gi_correct_count_label,
-        correct_count_str
-    );
-    gtk_label_set_text(
-        context->widgets->mw_gi_incorrect_count_label,
-        incorrect_count_str
-    );
-    gtk_label_set_text(
-        context->widgets->mw_gi_remaining_count_label,
-        remaining_count_str
-    );
-
-    // gtk_label_set_text uses g_strdup internally
-    g_free(correct_count_str);
-    g_free(incorrect_count_str);
-    g_free(remaining_count_str);
+    set_label_text(context->widgets->mw_gi_correct_count_label, context->correct_count_str);
+    set_label_text(context->widgets->mw_gi_incorrect_count_label, context->incorrect_count_str);
+    set_label_text(context->widgets->mw_gi_remaining_count_label, context->remaining_count_str);
 }
 
 static void show_map_point_description(GtkButton *button, App_context *context) {
     City *city;
+    GtkPopover *popover;
 
     city = game_data_get_city(
         context->data,
@@ -685,22 +1763,40 @@ static void show_map_point_description(GtkButton *button, App_context *context)
         return;
     }
 
+    popover = get_description_popover(context);
+
     gtk_label_set_markup(
         context->widgets->dp_city_description_label,
         city_get_description(city)
     );
 
-    gtk_popover_set_relative_to(
-        context->widgets->description_popover,
-        GTK_WIDGET(button)
-    );
+    gtk_popover_set_relative_to(popover, GTK_WIDGET(button));
+
+    gtk_popover_popup(popover);
+}
 
-    gtk_popover_popup(context->widgets->description_popover);
+static void show_question(App_context *context) {
+    switch (game_get_mode(context->game)) {
+        case TYPING:
+            show_question_popover(context);
+            break;
+        case CHOICE:
+            show_choice_popover(context);
+            break;
+        default:
+            break;
+    }
+}
+
+static void hide_question(App_context *context) {
+    hide_question_popover(context);
+    hide_choice_popover(context);
 }
 
 static void show_question_popover(App_context *context) {
     City *city;
     Map_point *map_point;
+    GtkPopover *popover;
 
     city = game_get_current_city(context->game);
     if (city == NULL) {
@@ -708,120 +1804,907 @@ static void show_question_popover(App_context *context) {
     }
 
     map_point = city_get_map_point(city);
+    popover = get_question_popover(context);
 
     gtk_popover_set_relative_to(
-        context->widgets->question_popover,
+        popover,
         GTK_WIDGET(map_point_get_button(map_point))
     );
 
-    gtk_widget_set_sensitive(
-        GTK_WIDGET(context->widgets->question_popover),
-        TRUE
-    );
+    gtk_widget_set_sensitive(GTK_WIDGET(popover), TRUE);
 
-    gtk_popover_popup(
-        context->widgets->question_popover
-    );
+    gtk_popover_popup(popover);
 
     gtk_widget_grab_focus(
         GTK_WIDGET(context->widgets->qp_city_entry)
     );
 }
 
-static gchar *hide_question_popover(App_context *context) {
-    gchar *user_answer;
-
-    if (!game_is_running(context->game)) {
-        user_answer = NULL;
-    } else {
-        user_answer = g_strdup(gtk_entry_get_text(context->widgets->qp_city_entry));
+static void hide_question_popover(App_context *context) {
+    if (context->widgets->question_popover == NULL) {
+        return;
     }
 
     gtk_entry_set_text(context->widgets->qp_city_entry, "");
 
     gtk_widget_hide(GTK_WIDGET(context->widgets->question_popover));
+}
+
+static void show_choice_popover(App_context *context) {
+    guint i, count;
+    City *city;
+    City *choices[GAME_CHOICE_COUNT];
+    GtkPopover *popover;
+
+    city = game_get_current_city(context->game);
+    if (city == NULL) {
+        return;
+    }
+
+    popover = get_choice_popover(context);
+    count = game_get_current_choices(context->game, choices);
+
+    // Fewer choices only with fewer cities than buttons.
+    for (i = 0; i < GAME_CHOICE_COUNT; i++) {
+        if (i < count) {
+            gtk_button_set_label(context->widgets->cp_choice_buttons[i], city_get_name(choices[i]));
+            gtk_widget_show(GTK_WIDGET(context->widgets->cp_choice_buttons[i]));
+        } else {
+            gtk_widget_hide(GTK_WIDGET(context->widgets->cp_choice_buttons[i]));
+        }
+    }
+
+    gtk_popover_set_relative_to(
+        popover,
+        GTK_WIDGET(map_point_get_button(city_get_map_point(city)))
+    );
+
+    gtk_popover_popup(popover);
+
+    gtk_widget_grab_focus(
+        GTK_WIDGET(context->widgets->cp_choice_buttons[0])
+    );
+}
+
+static void hide_choice_popover(App_context *context) {
+    if (context->widgets->choice_popover == NULL) {
+        return;
+    }
 
-    return user_answer;
+    gtk_widget_hide(GTK_WIDGET(context->widgets->choice_popover));
 }
 
 static void notify_about_correct_map_point(const gchar *name, GtkButton *button,
                                            App_context *context
 ) {
+    GtkPopover *popover;
+
+    popover = get_correct_location_popover(context);
+
     gtk_label_set_text(context->widgets->clp_city_name_label, name);
 
-    gtk_popover_set_relative_to(
-        context->widgets->correct_location_popover,
-        GTK_WIDGET(button)
-    );
+    gtk_popover_set_relative_to(popover, GTK_WIDGET(button));
 
-    gtk_widget_set_sensitive(
-        GTK_WIDGET(context->widgets->correct_location_popover),
-        TRUE
-    );
+    gtk_widget_set_sensitive(GTK_WIDGET(popover), TRUE);
 
-    gtk_popover_popup(context->widgets->correct_location_popover);
+    gtk_popover_popup(popover);
 
-    context->popover_timeout_id = g_timeout_add_seconds(
-        1,
-        hide_correct_location_popover,
-        context
-    );
+    frame_timer_start(context->popover_timer, G_USEC_PER_SEC);
 }
 
-static gboolean hide_correct_location_popover(gpointer user_data) {
-    if (((App_context *) user_data)->popover_timeout_id > 0) {
-        gtk_widget_hide(
-            GTK_WIDGET(((App_context *) user_data)->widgets->correct_location_popover)
-        );
+static void hide_correct_location_popover(gpointer user_data) {
+    if (((App_context *) user_data)->state != APP_SHOWING_CORRECT_LOCATION) {
+        return;
+    }
 
-        user_next_question((App_context *) user_data);
+    watchdog_enter(G_STRFUNC);
 
-        ((App_context *) user_data)->popover_timeout_id = 0;
-    }
+    gtk_widget_hide(
+        GTK_WIDGET(((App_context *) user_data)->widgets->correct_location_popover)
+    );
 
-    return G_SOURCE_REMOVE;
+    user_next_question((App_context *) user_data);
+
+    watchdog_leave();
 }
 
-static gint show_end_game_dialog(App_context *context) {
-    gint response_id;
-    gchar *timer_str;
+static void show_end_game_dialog(App_context *context) {
+    guint rank;
+    gdouble elapsed;
+    gchar timer_str[LABEL_STR_SIZE];
 
-    timer_str = generate_timer_str(g_timer_elapsed(context->timer, NULL));
+    elapsed = timer_get_elapsed(context);
+    generate_timer_str(timer_str, sizeof(timer_str), elapsed);
+
+    rank = add_leaderboard_entry(context, elapsed);
 
     gtk_message_dialog_format_secondary_text(
-        GTK_MESSAGE_DIALOG(context->widgets->game_end_dialog),
-        "Vreme: %s\nTačnih odgovora: %u\nNetačnih odgovora: %u",
+        GTK_MESSAGE_DIALOG(get_game_end_dialog(context)),
+        "Vreme: %s\nTačnih odgovora: %u\nNetačnih odgovora: %u\nMesto na tabeli: %u od %u",
         timer_str,
         game_get_correct_answer_count(context->game),
-        game_get_incorrect_answer_count(context->game)
+        game_get_incorrect_answer_count(context->game),
+        rank,
+        leaderboard_get_count(
+            context->leaderboard,
+            game_get_mode(context->game),
+            game_get_difficulty(context->game)
+        )
     );
 
-    g_free(timer_str);
+    gtk_window_present(GTK_WINDOW(context->widgets->game_end_dialog));
+}
 
-    response_id = gtk_dialog_run(context->widgets->game_end_dialog);
-    gtk_widget_hide(GTK_WIDGET(context->widgets->game_end_dialog));
+static void load_leaderboard(App_context *context) {
+    gchar *invalid_path;
+    GError *error = NULL;
 
-    return response_id;
-}
+    context->leaderboard_path = g_build_filename(
+        g_get_user_data_dir(), "gradovi-srbije", LEADERBOARD_FILE_NAME, NULL
+    );
+    context->leaderboard = leaderboard_load(context->leaderboard_path, &error);
+
+    if (error != NULL) {
+        // Nothing has been played yet.
+        if (!g_error_matches(error, G_FILE_ERROR, G_FILE_ERROR_NOENT)) {
+            g_printerr("%s\n", error->message);
+
+            // Kept for the user to recover, the new results go to a new
+            // file. If it can not be moved, it is not written at all.
+            invalid_path = g_strconcat(context->leaderboard_path, ".invalid", NULL);
+            if (g_rename(context->leaderboard_path, invalid_path) == 0) {
+                g_printerr("Moved to %s\n", invalid_path);
+            } else {
+                g_printerr(
+                    "Could not move %s: %s\n",
+                    context->leaderboard_path, g_strerror(errno)
+                );
+                g_free(context->leaderboard_path);
+                context->leaderboard_path = NULL;
+            }
+            g_free(invalid_path);
+        }
 
-void on_start_game_button_clicked(G_GNUC_UNUSED GtkButton *button, App_context *context) {
-    user_start_game(context);
-}
+        g_error_free(error);
+    }
 
-void on_stop_game_button_clicked(G_GNUC_UNUSED GtkButton *button, App_context *context) {
-    user_stop_game(context);
+    if (context->leaderboard == NULL) {
+        context->leaderboard = leaderboard_create();
+    }
 }
 
-void on_map_point_button_clicked(GtkButton *button, App_context *context) {
-    user_check_answer(button, context);
-}
+static guint add_leaderboard_entry(App_context *context, gdouble elapsed) {
+    guint rank;
+    Leaderboard_entry entry;
+    GError *error = NULL;
+
+    entry.time = g_get_real_time() / G_USEC_PER_SEC;
+    entry.elapsed = (guint32) (elapsed * 1000);
+    entry.correct_count = (guint16) game_get_correct_answer_count(context->game);
+    entry.incorrect_count = (guint16) game_get_incorrect_answer_count(context->game);
+    entry.mode = (guint8) game_get_mode(context->game);
+    entry.difficulty = (guint8) game_get_difficulty(context->game);
+
+    rank = leaderboard_add(context->leaderboard, &entry);
+
+    // Appended right away, so no result is lost if the game crashes.
+    if (context->leaderboard_path != NULL &&
+        !leaderboard_save_entry(context->leaderboard_path, &entry, &error)) {
+        g_printerr("%s\n", error->message);
+        g_error_free(error);
+    }
 
-void on_qp_city_entry_activate(G_GNUC_UNUSED GtkEntry *entry, App_context *context) {
-    user_check_answer(NULL, context);
+    return rank;
 }
 
-gboolean on_correct_location_popover_button_press_event(G_GNUC_UNUSED GtkWidget *widget,
-                                                        G_GNUC_UNUSED GdkEvent *event,
+static void load_heatmap(App_context *context) {
+    gint width, height;
+    GError *error = NULL;
+
+    context->heatmap = NULL;
+    context->heatmap_path = g_build_filename(
+        g_get_user_data_dir(), "gradovi-srbije", HEATMAP_FILE_NAME, NULL
+    );
+
+    // Without the map tiles there is nothing to draw over.
+    map_view_get_map_size(context->map_view, &width, &height);
+    if (width <= 0 || height <= 0) {
+        gtk_widget_hide(GTK_WIDGET(context->widgets->mw_heatmap_button));
+        return;
+    }
+
+    context->heatmap = heatmap_create(width, height);
+
+    if (!heatmap_load(context->heatmap, context->heatmap_path, &error)) {
+        if (!g_error_matches(error, G_FILE_ERROR, G_FILE_ERROR_NOENT)) {
+            g_printerr("%s\n", error->message);
+        }
+
+        g_error_free(error);
+    }
+
+    locate_heatmap_cities(context);
+}
+
+static void locate_heatmap_cities(App_context *context) {
+    GList *i;
+    gdouble x, y;
+    City *city;
+
+    if (context->heatmap == NULL) {
+        return;
+    }
+
+    for (i = context->cities; i != NULL; i = i->next) {
+        city = (City *) i->data;
+
+        map_view_get_map_point_location(context->map_view, city_get_map_point(city), &x, &y);
+        heatmap_set_location(context->heatmap, city_get_name(city), x, y);
+    }
+}
+
+static cairo_surface_t *get_heatmap_surface(gint scale_factor, gpointer user_data) {
+    return heatmap_get_surface(((App_context *) user_data)->heatmap, scale_factor);
+}
+
+static void watch_data(App_context *context) {
+    GFile *file;
+    GError *error = NULL;
+
+    file = g_file_new_for_path(watch_data_path);
+    context->data_monitor = g_file_monitor_file(file, G_FILE_MONITOR_NONE, NULL, &error);
+    g_object_unref(G_OBJECT(file));
+
+    if (context->data_monitor == NULL) {
+        g_printerr("%s\n", error->message);
+        g_error_free(error);
+        return;
+    }
+
+    g_signal_connect(
+        context->data_monitor, "changed",
+        G_CALLBACK(on_data_file_changed), context
+    );
+}
+
+static void on_data_file_changed(G_GNUC_UNUSED GFileMonitor *monitor,
+                                 G_GNUC_UNUSED GFile *file,
+                                 G_GNUC_UNUSED GFile *other_file,
+                                 GFileMonitorEvent event_type,
+                                 gpointer user_data
+) {
+    App_context *context = (App_context *) user_data;
+
+    if (event_type != G_FILE_MONITOR_EVENT_CHANGED &&
+        event_type != G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT &&
+        event_type != G_FILE_MONITOR_EVENT_CREATED) {
+        return;
+    }
+
+    // Restarted by every event, the file is read once the writes stop.
+    if (context->data_reload_id != 0) {
+        g_source_remove(context->data_reload_id);
+    }
+    context->data_reload_id = g_timeout_add(DATA_RELOAD_DELAY, reload_data, context);
+}
+
+static gboolean reload_data(gpointer user_data) {
+    App_context *context = (App_context *) user_data;
+
+    Game_data *data;
+    GError *error = NULL;
+
+    context->data_reload_id = 0;
+
+    data = game_data_create_from_file(watch_data_path, &error);
+    if (data == NULL) {
+        // Most likely saved halfway, the next change reloads it again.
+        g_printerr("%s, the cities were not reloaded\n", error->message);
+        g_error_free(error);
+        return G_SOURCE_REMOVE;
+    }
+
+    if (context->pending_data != NULL) {
+        game_data_destroy(context->pending_data);
+    }
+    context->pending_data = data;
+
+    if (context->state == APP_IDLE) {
+        apply_pending_data(context);
+    } else if (game_data_merge(context->data, data, FALSE, apply_city_change, context) > 0) {
+        g_printerr("The added and removed cities are applied when the game ends\n");
+    }
+
+    return G_SOURCE_REMOVE;
+}
+
+static void apply_pending_data(App_context *context) {
+    GList *cities;
+    guint city_count;
+
+    // The description may belong to a removed city.
+    if (context->widgets->description_popover != NULL) {
+        gtk_popover_popdown(context->widgets->description_popover);
+    }
+
+    // Only the added and removed cities are touched, the list of the
+    // played cities is updated by apply_city_change. An added city is
+    // prepended, a removed one shortens the list.
+    cities = context->cities;
+    city_count = g_list_length(context->cities);
+
+    game_data_merge(context->data, context->pending_data, TRUE, apply_city_change, context);
+
+    if (context->cities != cities || g_list_length(context->cities) != city_count) {
+        game_set_cities(context->game, context->cities);
+
+        if (context->recorder != NULL) {
+            g_printerr("The cities changed, the games recorded from now on cannot be replayed\n");
+        }
+    }
+    game_data_destroy(context->pending_data);
+    context->pending_data = NULL;
+}
+
+static void apply_city_change(City *city, Game_data_change change, gpointer user_data) {
+    App_context *context = (App_context *) user_data;
+
+    gdouble x, y;
+    gsize heap_size;
+    Map_point *map_point;
+    GtkTreeIter tree_iter;
+
+    switch (change) {
+        case GAME_DATA_CITY_CHANGED:
+            map_point = city_get_map_point(city);
+
+            if (map_point != NULL && context->widgets->description_popover != NULL &&
+                gtk_widget_get_visible(GTK_WIDGET(context->widgets->description_popover)) &&
+                gtk_popover_get_relative_to(context->widgets->description_popover) ==
+                GTK_WIDGET(map_point_get_button(map_point))) {
+                gtk_label_set_markup(
+                    context->widgets->dp_city_description_label,
+                    city_get_description(city)
+                );
+            }
+            break;
+        case GAME_DATA_CITY_ADDED:
+            map_point = g_hash_table_lookup(context->unused_map_points, city_get_name(city));
+
+            if (map_point == NULL) {
+                g_printerr("%s has no map point, it is left out of the game\n", city_get_name(city));
+                break;
+            }
+
+            g_hash_table_steal(context->unused_map_points, city_get_name(city));
+            city_set_map_point(city, map_point);
+            gtk_widget_show(GTK_WIDGET(map_point_get_container(map_point)));
+            toggle_map_point_state(context, map_point, TRUE);
+            context->cities = g_list_prepend(context->cities, city);
+
+            if (context->heatmap != NULL) {
+                map_view_get_map_point_location(context->map_view, map_point, &x, &y);
+                heatmap_set_location(context->heatmap, city_get_name(city), x, y);
+            }
+
+            heap_size = memstats_get_heap_size();
+            gtk_list_store_append(context->city_list_store, &tree_iter);
+            gtk_list_store_set(
+                context->city_list_store, &tree_iter,
+                0, city_get_name(city), 1, city, -1
+            );
+            context->city_list_store_size += memstats_get_heap_size() - heap_size;
+            break;
+        case GAME_DATA_CITY_REMOVED:
+            map_point = city_steal_map_point(city);
+            remove_city_row(context, city);
+            context->cities = g_list_remove(context->cities, city);
+
+            if (context->heatmap != NULL) {
+                heatmap_clear_location(context->heatmap, city_get_name(city));
+                map_view_queue_overlay_draw(context->map_view);
+            }
+
+            if (map_point == NULL) {
+                break;
+            }
+
+            gtk_widget_hide(GTK_WIDGET(map_point_get_container(map_point)));
+            g_hash_table_insert(
+                context->unused_map_points,
+                g_strdup(gtk_widget_get_name(GTK_WIDGET(map_point_get_container(map_point)))),
+                map_point
+            );
+            break;
+    }
+}
+
+static void remove_city_row(App_context *context, City *city) {
+    City *row_city;
+    gsize heap_size;
+    gboolean valid;
+    GtkTreeIter tree_iter;
+    GtkTreeModel *model;
+
+    model = GTK_TREE_MODEL(context->city_list_store);
+
+    valid = gtk_tree_model_get_iter_first(model, &tree_iter);
+    while (valid) {
+        gtk_tree_model_get(model, &tree_iter, 1, &row_city, -1);
+
+        // The difference wraps around, it shrinks the counter.
+        if (row_city == city) {
+            heap_size = memstats_get_heap_size();
+            gtk_list_store_remove(context->city_list_store, &tree_iter);
+            context->city_list_store_size += memstats_get_heap_size() - heap_size;
+            return;
+        }
+
+        valid = gtk_tree_model_iter_next(model, &tree_iter);
+    }
+}
+
+static void benchmark_ui(App_context *context, guint iterations) {
+    GtkWidget *content;
+    GtkWidget *offscreen_window;
+    Ui_benchmark *benchmark;
+
+    // The content of the main window is moved to an offscreen window, so it
+    // is laid out and drawn as usual, but never shown on the screen.
+    offscreen_window = gtk_offscreen_window_new();
+    content = gtk_bin_get_child(GTK_BIN(context->widgets->main_window));
+
+    g_object_ref(content);
+    gtk_container_remove(GTK_CONTAINER(context->widgets->main_window), content);
+    gtk_container_add(GTK_CONTAINER(offscreen_window), content);
+    g_object_unref(content);
+
+    benchmark = ui_benchmark_create(offscreen_window);
+    ui_benchmark_add(
+        benchmark, "toggle_map_points_state(FALSE)",
+        benchmark_show_map_points, benchmark_hide_map_points, context
+    );
+    ui_benchmark_add(
+        benchmark, "toggle_map_points_state(TRUE)",
+        benchmark_hide_map_points, benchmark_show_map_points, context
+    );
+    ui_benchmark_add(
+        benchmark, "show_map_point_description",
+        benchmark_prepare_description, benchmark_show_description, context
+    );
+    ui_benchmark_add(
+        benchmark, "user_restart_game",
+        benchmark_prepare_restart, benchmark_restart, context
+    );
+    ui_benchmark_add(
+        benchmark, "typing round",
+        benchmark_prepare_typing_round, benchmark_typing_round, context
+    );
+
+    ui_benchmark_run(benchmark, iterations);
+
+    user_stop_game(context);
+    ui_benchmark_destroy(benchmark);
+    gtk_widget_destroy(offscreen_window);
+}
+
+static void benchmark_show_map_points(gpointer user_data, G_GNUC_UNUSED guint iteration) {
+    toggle_map_points_state((App_context *) user_data, TRUE);
+}
+
+static void benchmark_hide_map_points(gpointer user_data, G_GNUC_UNUSED guint iteration) {
+    toggle_map_points_state((App_context *) user_data, FALSE);
+}
+
+static void benchmark_prepare_description(gpointer user_data, G_GNUC_UNUSED guint iteration) {
+    gtk_popover_popdown(get_description_popover((App_context *) user_data));
+}
+
+static void benchmark_show_description(gpointer user_data, guint iteration) {
+    City *city;
+    App_context *context = (App_context *) user_data;
+
+    city = g_list_nth_data(context->cities, iteration % g_list_length(context->cities));
+
+    show_map_point_description(
+        map_point_get_button(city_get_map_point(city)),
+        context
+    );
+}
+
+static void benchmark_prepare_restart(gpointer user_data, G_GNUC_UNUSED guint iteration) {
+    App_context *context = (App_context *) user_data;
+
+    gtk_popover_popdown(get_description_popover(context));
+
+    if (context->state == APP_IDLE) {
+        select_radio_button(context->widgets->mode_rb, SELECTION);
+        user_start_game(context);
+    }
+}
+
+static void benchmark_restart(gpointer user_data, G_GNUC_UNUSED guint iteration) {
+    user_restart_game((App_context *) user_data);
+}
+
+static void benchmark_prepare_typing_round(gpointer user_data, G_GNUC_UNUSED guint iteration) {
+    App_context *context = (App_context *) user_data;
+
+    if (context->state == APP_IDLE || game_get_mode(context->game) != TYPING) {
+        user_stop_game(context);
+        select_radio_button(context->widgets->mode_rb, TYPING);
+        user_start_game(context);
+    } else if (game_get_remaining_questions_count(context->game) <= 1) {
+        // The end game dialog would be shown on the screen.
+        user_restart_game(context);
+    }
+}
+
+static void benchmark_typing_round(gpointer user_data, G_GNUC_UNUSED guint iteration) {
+    App_context *context = (App_context *) user_data;
+
+    // Answers correctly, so the next question is shown right away.
+    gtk_entry_set_text(
+        context->widgets->qp_city_entry,
+        city_get_name(game_get_current_city(context->game))
+    );
+    user_check_answer(NULL, context);
+}
+
+static void start_control_socket(App_context *context) {
+    GError *error = NULL;
+
+    context->control_socket = control_socket_create(
+        control_socket_path,
+        context->widgets->main_window,
+        &error
+    );
+
+    if (context->control_socket == NULL) {
+        g_printerr("%s\n", error->message);
+        g_error_free(error);
+        return;
+    }
+
+    control_socket_add(context->control_socket, "start", control_start, context);
+    control_socket_add(context->control_socket, "click", control_click, context);
+    control_socket_add(context->control_socket, "type", control_type, context);
+    control_socket_add(context->control_socket, "choose", control_choose, context);
+    control_socket_add(context->control_socket, "restart", control_restart, context);
+    control_socket_add(context->control_socket, "stop", control_stop, context);
+    control_socket_add(context->control_socket, "state", control_state, context);
+    control_socket_add(context->control_socket, "quit", control_quit, context);
+}
+
+static void control_add_state(App_context *context, JsonBuilder *builder) {
+    guint i, count;
+    City *city, *choices[GAME_CHOICE_COUNT];
+    static const gchar *state_names[] = {
+        [APP_IDLE] = "idle",
+        [APP_WAITING_FOR_ANSWER] = "waiting_for_answer",
+        [APP_SHOWING_CORRECT_LOCATION] = "showing_correct_location",
+        [APP_SHOWING_END_GAME_DIALOG] = "showing_end_game_dialog"
+    };
+
+    json_builder_set_member_name(builder, "state");
+    json_builder_add_string_value(builder, state_names[context->state]);
+
+    if (context->state == APP_IDLE) {
+        return;
+    }
+
+    // The city of the current question, so that a script can answer it.
+    city = game_get_current_city(context->game);
+    if (city != NULL && context->state == APP_WAITING_FOR_ANSWER) {
+        json_builder_set_member_name(builder, "city");
+        json_builder_add_string_value(builder, city_get_name(city));
+
+        // The labels of the choice buttons, for the choose command.
+        if (game_get_mode(context->game) == CHOICE) {
+            count = game_get_current_choices(context->game, choices);
+
+            json_builder_set_member_name(builder, "choices");
+            json_builder_begin_array(builder);
+            for (i = 0; i < count; i++) {
+                json_builder_add_string_value(builder, city_get_name(choices[i]));
+            }
+            json_builder_end_array(builder);
+        }
+    }
+
+    json_builder_set_member_name(builder, "correct_count");
+    json_builder_add_int_value(builder, game_get_correct_answer_count(context->game));
+    json_builder_set_member_name(builder, "incorrect_count");
+    json_builder_add_int_value(builder, game_get_incorrect_answer_count(context->game));
+    json_builder_set_member_name(builder, "remaining_count");
+    json_builder_add_int_value(builder, game_get_remaining_questions_count(context->game));
+}
+
+static gboolean control_start(JsonObject *command, JsonBuilder *builder,
+                              gpointer user_data, GError **error
+) {
+    App_context *context = (App_context *) user_data;
+
+    const gchar *mode, *difficulty;
+
+    if (context->state != APP_IDLE) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_BUSY, "The game is already running");
+        return FALSE;
+    }
+
+    mode = control_socket_get_string_member(command, "mode");
+    difficulty = control_socket_get_string_member(command, "difficulty");
+
+    if (g_strcmp0(mode, "selection") == 0) {
+        select_radio_button(context->widgets->mode_rb, SELECTION);
+    } else if (g_strcmp0(mode, "typing") == 0) {
+        select_radio_button(context->widgets->mode_rb, TYPING);
+    } else if (g_strcmp0(mode, "choice") == 0) {
+        select_radio_button(context->widgets->mode_rb, CHOICE);
+    } else if (mode != NULL) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT, "Unknown mode %s", mode);
+        return FALSE;
+    }
+
+    if (g_strcmp0(difficulty, "easy") == 0) {
+        select_radio_button(context->widgets->difficulty_rb, EASY);
+    } else if (g_strcmp0(difficulty, "medium") == 0) {
+        select_radio_button(context->widgets->difficulty_rb, MEDIUM);
+    } else if (g_strcmp0(difficulty, "hard") == 0) {
+        select_radio_button(context->widgets->difficulty_rb, HARD);
+    } else if (difficulty != NULL) {
+        g_set_error(
+            error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+            "Unknown difficulty %s", difficulty
+        );
+        return FALSE;
+    }
+
+    watchdog_enter(G_STRFUNC);
+    user_start_game(context);
+    watchdog_leave();
+
+    control_add_state(context, builder);
+
+    return TRUE;
+}
+
+static gboolean control_click(JsonObject *command, JsonBuilder *builder,
+                              gpointer user_data, GError **error
+) {
+    App_context *context = (App_context *) user_data;
+
+    City *city;
+    const gchar *name;
+    GtkButton *button;
+    Map_point *map_point;
+
+    name = control_socket_get_string_member(command, "city");
+    city = name != NULL ? game_data_get_city(context->data, name) : NULL;
+
+    if (city == NULL) {
+        g_set_error(
+            error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND,
+            "Unknown city %s", name != NULL ? name : "(null)"
+        );
+        return FALSE;
+    }
+
+    // Cities outside of the map have no map point to click.
+    map_point = city_get_map_point(city);
+    if (map_point == NULL) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND, "%s has no map point", name);
+        return FALSE;
+    }
+
+    // A click on an insensitive map point never reaches the handler.
+    button = map_point_get_button(map_point);
+    if (!gtk_widget_is_sensitive(GTK_WIDGET(button))) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED, "The map point of %s is disabled", name);
+        return FALSE;
+    }
+
+    watchdog_enter(G_STRFUNC);
+    user_check_answer(button, context);
+    watchdog_leave();
+
+    control_add_state(context, builder);
+
+    return TRUE;
+}
+
+static gboolean control_type(JsonObject *command, JsonBuilder *builder,
+                             gpointer user_data, GError **error
+) {
+    App_context *context = (App_context *) user_data;
+
+    const gchar *text;
+
+    text = control_socket_get_string_member(command, "text");
+    if (text == NULL) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT, "Missing text");
+        return FALSE;
+    }
+
+    if (context->state != APP_WAITING_FOR_ANSWER || game_get_mode(context->game) != TYPING) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED, "No typed answer is expected");
+        return FALSE;
+    }
+
+    watchdog_enter(G_STRFUNC);
+    gtk_entry_set_text(context->widgets->qp_city_entry, text);
+    user_check_answer(NULL, context);
+    watchdog_leave();
+
+    control_add_state(context, builder);
+
+    return TRUE;
+}
+
+static gboolean control_choose(JsonObject *command, JsonBuilder *builder,
+                               gpointer user_data, GError **error
+) {
+    App_context *context = (App_context *) user_data;
+
+    guint i;
+    const gchar *name;
+    GtkButton *button = NULL;
+
+    name = control_socket_get_string_member(command, "city");
+    if (name == NULL) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT, "Missing city");
+        return FALSE;
+    }
+
+    if (context->state != APP_WAITING_FOR_ANSWER || game_get_mode(context->game) != CHOICE) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED, "No choice is expected");
+        return FALSE;
+    }
+
+    // Only the buttons of the current question are visible.
+    for (i = 0; i < GAME_CHOICE_COUNT && button == NULL; i++) {
+        if (gtk_widget_get_visible(GTK_WIDGET(context->widgets->cp_choice_buttons[i])) &&
+            g_strcmp0(gtk_button_get_label(context->widgets->cp_choice_buttons[i]), name) == 0) {
+            button = context->widgets->cp_choice_buttons[i];
+        }
+    }
+
+    if (button == NULL) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND, "%s is not one of the choices", name);
+        return FALSE;
+    }
+
+    watchdog_enter(G_STRFUNC);
+    user_check_answer(button, context);
+    watchdog_leave();
+
+    control_add_state(context, builder);
+
+    return TRUE;
+}
+
+static gboolean control_restart(G_GNUC_UNUSED JsonObject *command, JsonBuilder *builder,
+                                gpointer user_data, GError **error
+) {
+    App_context *context = (App_context *) user_data;
+
+    if (context->state != APP_SHOWING_END_GAME_DIALOG) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED, "The game has not ended");
+        return FALSE;
+    }
+
+    // Same as answering the end game dialog with yes.
+    gtk_dialog_response(context->widgets->game_end_dialog, GTK_RESPONSE_YES);
+
+    control_add_state(context, builder);
+
+    return TRUE;
+}
+
+static gboolean control_stop(G_GNUC_UNUSED JsonObject *command, JsonBuilder *builder,
+                             gpointer user_data, GError **error
+) {
+    App_context *context = (App_context *) user_data;
+
+    if (context->state == APP_IDLE) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED, "The game is not running");
+        return FALSE;
+    }
+
+    watchdog_enter(G_STRFUNC);
+    user_stop_game(context);
+    watchdog_leave();
+
+    control_add_state(context, builder);
+
+    return TRUE;
+}
+
+static gboolean control_state(G_GNUC_UNUSED JsonObject *command, JsonBuilder *builder,
+                              gpointer user_data, G_GNUC_UNUSED GError **error
+) {
+    control_add_state((App_context *) user_data, builder);
+
+    return TRUE;
+}
+
+static gboolean control_quit(G_GNUC_UNUSED JsonObject *command, JsonBuilder *builder,
+                             gpointer user_data, G_GNUC_UNUSED GError **error
+) {
+    control_add_state((App_context *) user_data, builder);
+
+    // Shut down like closing the window, the reply may not be written
+    // before the socket is closed.
+    gtk_main_quit();
+
+    return TRUE;
+}
+
+void on_start_game_button_clicked(G_GNUC_UNUSED GtkButton *button, App_context *context) {
+    watchdog_enter(G_STRFUNC);
+    user_start_game(context);
+    watchdog_leave();
+}
+
+void on_stop_game_button_clicked(G_GNUC_UNUSED GtkButton *button, App_context *context) {
+    watchdog_enter(G_STRFUNC);
+    user_stop_game(context);
+    watchdog_leave();
+}
+
+void on_map_point_button_clicked(GtkButton *button, App_context *context) {
+    watchdog_enter(G_STRFUNC);
+    user_check_answer(button, context);
+    watchdog_leave();
+}
+
+void on_qp_city_entry_activate(G_GNUC_UNUSED GtkEntry *entry, App_context *context) {
+    watchdog_enter(G_STRFUNC);
+    user_check_answer(NULL, context);
+    watchdog_leave();
+}
+
+void on_cp_choice_button_clicked(GtkButton *button, App_context *context) {
+    watchdog_enter(G_STRFUNC);
+    user_check_answer(button, context);
+    watchdog_leave();
+}
+
+void on_mw_heatmap_button_toggled(GtkToggleButton *button, App_context *context) {
+    if (context->heatmap == NULL) {
+        return;
+    }
+
+    if (gtk_toggle_button_get_active(button)) {
+        map_view_set_overlay(context->map_view, get_heatmap_surface, context);
+    } else {
+        map_view_set_overlay(context->map_view, NULL, NULL);
+    }
+}
+
+void on_game_end_dialog_response(GtkDialog *dialog, gint response_id, App_context *context) {
+    gtk_widget_hide(GTK_WIDGET(dialog));
+
+    if (context->state != APP_SHOWING_END_GAME_DIALOG) {
+        return;
+    }
+
+    watchdog_enter(G_STRFUNC);
+
+    switch (response_id) {
+        case GTK_RESPONSE_YES:
+            user_restart_game(context);
+            break;
+        default:
+            user_stop_game(context);
+            break;
+    }
+
+    watchdog_leave();
+}
+
+gboolean on_correct_location_popover_button_press_event(G_GNUC_UNUSED GtkWidget *widget,
+                                                        G_GNUC_UNUSED GdkEvent *event,
                                                         G_GNUC_UNUSED App_context *context
 ) {
     return TRUE;
@@ -870,6 +2753,68 @@ gboolean on_question_popover_key_press_event(G_GNUC_UNUSED GtkWidget *widget,
     return FALSE;
 }
 
+void on_main_window_scale_factor_notify(G_GNUC_UNUSED GObject *object,
+                                        G_GNUC_UNUSED GParamSpec *pspec,
+                                        App_context *context
+) {
+    GList *i;
+    Map_point *map_point;
+
+    // Pick the coat of arms and the name variants for the new scale factor.
+    for (i = context->cities; i != NULL; i = i->next) {
+        map_point = city_get_map_point((City *) i->data);
+
+        if (map_point_has_coat_of_arms(map_point)) {
+            map_point_toggle_coat_of_arms(map_point, TRUE);
+        }
+
+        if (map_point_has_name(map_point)) {
+            map_point_toggle_name(map_point, TRUE);
+        }
+    }
+}
+
+gboolean on_main_window_map_event(G_GNUC_UNUSED GtkWidget *widget,
+                                  G_GNUC_UNUSED GdkEvent *event,
+                                  App_context *context
+) {
+    context->window_mapped = TRUE;
+    update_timers_visibility(context);
+
+    // Once, after the first frames. The popovers and the end game dialog
+    // are only counted after they were used, SIGUSR1 reports them later.
+    if (memstats) {
+        memstats = FALSE;
+        context->memstats_report_id = g_idle_add_full(
+            G_PRIORITY_LOW, on_memstats_report, context, NULL
+        );
+    }
+
+    return FALSE;
+}
+
+gboolean on_main_window_unmap_event(G_GNUC_UNUSED GtkWidget *widget,
+                                    G_GNUC_UNUSED GdkEvent *event,
+                                    App_context *context
+) {
+    context->window_mapped = FALSE;
+    update_timers_visibility(context);
+
+    return FALSE;
+}
+
+gboolean on_main_window_window_state_event(G_GNUC_UNUSED GtkWidget *widget,
+                                           GdkEventWindowState *event,
+                                           App_context *context
+) {
+    context->window_iconified = (
+        event->new_window_state & GDK_WINDOW_STATE_ICONIFIED
+    ) != 0;
+    update_timers_visibility(context);
+
+    return FALSE;
+}
+
 void on_main_window_destroy() {
     gtk_main_quit();
 }
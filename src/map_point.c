@@ -1,28 +1,44 @@
 #include <stdarg.h>
 #include <gtk/gtk.h>
+#include "asset_cache.h"
+#include "label_cache.h"
 #include "map_point.h"
 
-#define RESOURCE_PATH(name) g_strdup_printf("/ns/dragi/gradovi-srbije/%s", name)
-
 struct map_point_t {
     GtkContainer *container;
     GtkButton *button;
     GtkRevealer *revealer;
+    // Replaces the label of the revealer, the name is drawn from the
+    // label cache instead of through the CSS text shadow.
+    GtkImage *name_image;
+    gchar *name;
+    cairo_surface_t *name_surface;
+    gint x, y;
+    gboolean coat_of_arms;
 };
 
+static void map_point_replace_name_label(Map_point *map_point);
+static void map_point_update_name_image(Map_point *map_point);
+
 Map_point *map_point_create(GtkContainer *container, GtkButton *button,
                             GtkRevealer *revealer
 ) {
-    Map_point *map_point = g_slice_new(Map_point);
+    Map_point *map_point = g_slice_new0(Map_point);
     map_point->container = container;
     map_point->button = button;
     map_point->revealer = revealer;
+
+    if (revealer != NULL) {
+        map_point_replace_name_label(map_point);
+    }
+
     return map_point;
 }
 
 void map_point_destroy(Map_point *map_point) {
     g_return_if_fail(map_point != NULL);
 
+    g_free(map_point->name);
     g_slice_free(Map_point, map_point);
 }
 
@@ -60,6 +76,26 @@ void map_point_set_revealer(Map_point *map_point, GtkRevealer *revealer) {
     g_return_if_fail(map_point != NULL);
 
     map_point->revealer = revealer;
+    map_point_replace_name_label(map_point);
+}
+
+void map_point_get_position(Map_point *map_point, gint *x, gint *y) {
+    g_return_if_fail(map_point != NULL);
+
+    if (x != NULL) {
+        *x = map_point->x;
+    }
+
+    if (y != NULL) {
+        *y = map_point->y;
+    }
+}
+
+void map_point_set_position(Map_point *map_point, gint x, gint y) {
+    g_return_if_fail(map_point != NULL);
+
+    map_point->x = x;
+    map_point->y = y;
 }
 
 void map_point_toggle_class_names(Map_point *map_point, gboolean toggle,
@@ -93,13 +129,18 @@ void map_point_toggle_class_names(Map_point *map_point, gboolean toggle,
     }
 
     va_end(class_names);
+
+    // The variant of the name follows the correct and incorrect classes.
+    if (map_point_has_name(map_point)) {
+        map_point_update_name_image(map_point);
+    }
 }
 
 void map_point_toggle_coat_of_arms(Map_point *map_point, gboolean toggle) {
     g_return_if_fail(map_point != NULL);
 
-    gchar *path;
     GtkWidget *button_image;
+    cairo_surface_t *surface;
 
     button_image = gtk_button_get_image(map_point->button);
 
@@ -112,26 +153,125 @@ void map_point_toggle_coat_of_arms(Map_point *map_point, gboolean toggle) {
     }
 
     if (toggle) {
-        path = RESOURCE_PATH(gtk_widget_get_name(
-            GTK_WIDGET(map_point->container)
-        ));
-
-        gtk_image_set_from_resource(GTK_IMAGE(button_image), path);
-
-        g_free(path);
+        // The variant that matches the scale factor of the screen
+        // is used, so GTK does not have to upscale the image.
+        surface = asset_cache_get_surface(
+            gtk_widget_get_name(GTK_WIDGET(map_point->container)),
+            gtk_widget_get_scale_factor(GTK_WIDGET(map_point->button))
+        );
+
+        gtk_image_set_from_surface(GTK_IMAGE(button_image), surface);
     } else {
         gtk_image_clear(GTK_IMAGE(button_image));
     }
+
+    map_point->coat_of_arms = toggle;
+}
+
+gboolean map_point_has_coat_of_arms(Map_point *map_point) {
+    g_return_val_if_fail(map_point != NULL, FALSE);
+
+    return map_point->coat_of_arms;
 }
 
 void map_point_toggle_name(Map_point *map_point, gboolean toggle) {
     g_return_if_fail(map_point != NULL);
 
+    if (toggle) {
+        map_point_update_name_image(map_point);
+    }
+
     gtk_revealer_set_reveal_child(map_point->revealer, toggle);
 }
 
+gboolean map_point_has_name(Map_point *map_point) {
+    g_return_val_if_fail(map_point != NULL, FALSE);
+
+    return map_point->revealer != NULL &&
+           gtk_revealer_get_reveal_child(map_point->revealer);
+}
+
+gdouble map_point_get_name_opacity(Map_point *map_point) {
+    g_return_val_if_fail(map_point != NULL, 0.0);
+
+    return gtk_widget_get_opacity(GTK_WIDGET(map_point->revealer));
+}
+
+void map_point_set_name_opacity(Map_point *map_point, gdouble opacity) {
+    g_return_if_fail(map_point != NULL);
+
+    // Only redraws the name, unlike a revealer transition that changes
+    // its allocation in every frame.
+    gtk_widget_set_opacity(GTK_WIDGET(map_point->revealer), opacity);
+}
+
 void map_point_toggle_state(Map_point *map_point, gboolean toggle) {
     g_return_if_fail(map_point != NULL);
 
     gtk_widget_set_sensitive(GTK_WIDGET(map_point->button), toggle);
 }
+
+static void map_point_replace_name_label(Map_point *map_point) {
+    GtkWidget *label;
+    GtkWidget *image;
+
+    if (map_point->revealer == NULL || map_point->name_image != NULL) {
+        return;
+    }
+
+    label = gtk_bin_get_child(GTK_BIN(map_point->revealer));
+    if (!GTK_IS_LABEL(label)) {
+        return;
+    }
+
+    map_point->name = g_strdup(gtk_label_get_text(GTK_LABEL(label)));
+
+    image = gtk_image_new();
+    gtk_widget_set_halign(image, gtk_widget_get_halign(label));
+    gtk_widget_set_valign(image, gtk_widget_get_valign(label));
+    gtk_widget_show(image);
+
+    // The names are faded by the reveal scheduler, the revealer only
+    // shows and hides them.
+    gtk_revealer_set_transition_type(map_point->revealer, GTK_REVEALER_TRANSITION_TYPE_NONE);
+
+    // The revealer holds the only reference of the label.
+    gtk_container_remove(GTK_CONTAINER(map_point->revealer), label);
+    gtk_container_add(GTK_CONTAINER(map_point->revealer), image);
+
+    map_point->name_image = GTK_IMAGE(image);
+}
+
+static void map_point_update_name_image(Map_point *map_point) {
+    Label_variant variant;
+    cairo_surface_t *surface;
+    GtkStyleContext *style_context;
+
+    if (map_point->name_image == NULL) {
+        return;
+    }
+
+    style_context = gtk_widget_get_style_context(
+        GTK_WIDGET(map_point->container)
+    );
+
+    if (gtk_style_context_has_class(style_context, "correct")) {
+        variant = LABEL_CORRECT;
+    } else if (gtk_style_context_has_class(style_context, "incorrect")) {
+        variant = LABEL_INCORRECT;
+    } else {
+        variant = LABEL_DEFAULT;
+    }
+
+    surface = label_cache_get_surface(
+        map_point->name,
+        variant,
+        gtk_widget_get_scale_factor(GTK_WIDGET(map_point->name_image))
+    );
+
+    // Setting the same surface again would still resize the image.
+    if (surface != map_point->name_surface) {
+        gtk_image_set_from_surface(map_point->name_image, surface);
+        map_point->name_surface = surface;
+    }
+}
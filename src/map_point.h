@@ -15,11 +15,17 @@ GtkButton *map_point_get_button(Map_point *map_point);
 void map_point_set_button(Map_point *map_point, GtkButton *button);
 GtkRevealer *map_point_get_revealer(Map_point *map_point);
 void map_point_set_revealer(Map_point *map_point, GtkRevealer *revealer);
+void map_point_get_position(Map_point *map_point, gint *x, gint *y);
+void map_point_set_position(Map_point *map_point, gint x, gint y);
 void map_point_toggle_class_names(Map_point *map_point, gboolean toggle,
                                   gint arg_count, ...
 );
 void map_point_toggle_coat_of_arms(Map_point *map_point, gboolean toggle);
+gboolean map_point_has_coat_of_arms(Map_point *map_point);
 void map_point_toggle_name(Map_point *map_point, gboolean toggle);
+gboolean map_point_has_name(Map_point *map_point);
+gdouble map_point_get_name_opacity(Map_point *map_point);
+void map_point_set_name_opacity(Map_point *map_point, gdouble opacity);
 void map_point_toggle_state(Map_point *map_point, gboolean toggle);
 
 #endif
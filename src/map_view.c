@@ -0,0 +1,800 @@
+#include <gtk/gtk.h>
+#include "map_point.h"
+#include "map_view.h"
+#include "watchdog.h"
+
+#define TILES_PATH "/ns/dragi/gradovi-srbije/tiles"
+#define TILE_KEY(level, column, row) \
+    (((guint) (level) << 24) | ((guint) (row) << 12) | (guint) (column))
+// Tiles kept around the visible ones, so panning does not load them again.
+#define TILE_CACHE_MARGIN 1
+#define MAP_POINT_ANCHOR 12
+#define ZOOM_STEP 1.25
+#define MIN_ZOOM 1.0
+#define MIN_MAX_ZOOM 4.0
+
+typedef struct map_tile_t {
+    guint key;
+    cairo_surface_t *surface;
+} Map_tile;
+
+typedef struct map_view_point_t {
+    Map_point *map_point;
+    gint anchor_x, anchor_y;
+    gint x, y;
+    gboolean visible;
+} Map_view_point;
+
+struct map_view_t {
+    GtkWidget *event_widget;
+    GtkDrawingArea *drawing_area;
+    GtkFixed *map_points_fixed;
+    GList *points;
+
+    gint width, height;
+    gint tile_size;
+    gint levels;
+
+    gdouble zoom;
+    gdouble offset_x, offset_y;
+
+    gboolean dragging;
+    gdouble drag_x, drag_y;
+
+    // Tile key -> link in tile_queue, the most recently used tile is at the head.
+    GHashTable *tiles;
+    GQueue *tile_queue;
+    // Pixel data of the cached tiles and the most it may grow to, in bytes.
+    // The budget holds the visible tiles of the current level and a margin
+    // around them, so drawing a frame never evicts its own tiles.
+    gsize tiles_size;
+    gsize tiles_budget;
+
+    Map_view_overlay_func overlay_func;
+    gpointer overlay_data;
+};
+
+static gboolean map_view_load_pyramid(Map_view *view);
+static gint map_view_pick_level(Map_view *view);
+static void map_view_update_tiles_budget(Map_view *view);
+static void map_view_evict_tiles(Map_view *view);
+static cairo_surface_t *map_view_get_tile(Map_view *view, gint level,
+                                          gint column, gint row
+);
+static cairo_surface_t *map_view_load_tile(gint level, gint column, gint row);
+static void map_view_tile_free(gpointer user_data);
+static gsize map_view_get_tile_size(Map_tile *tile);
+static void map_view_clamp_offset(Map_view *view);
+static void map_view_update(Map_view *view);
+static void map_view_update_map_points(Map_view *view);
+static void map_view_draw_overlay(Map_view *view, GtkWidget *widget, cairo_t *cr);
+static void map_view_event_position(Map_view *view, gdouble x_root, gdouble y_root,
+                                    gdouble *x, gdouble *y
+);
+static gboolean map_view_on_draw(GtkWidget *widget, cairo_t *cr, gpointer user_data);
+static void map_view_on_size_allocate(GtkWidget *widget,
+                                      G_GNUC_UNUSED GdkRectangle *allocation,
+                                      gpointer user_data
+);
+static void map_view_on_scale_factor_notify(G_GNUC_UNUSED GObject *object,
+                                            G_GNUC_UNUSED GParamSpec *pspec,
+                                            gpointer user_data
+);
+static gboolean map_view_on_scroll_event(G_GNUC_UNUSED GtkWidget *widget,
+                                         GdkEventScroll *event,
+                                         gpointer user_data
+);
+static gboolean map_view_on_button_press_event(G_GNUC_UNUSED GtkWidget *widget,
+                                               GdkEventButton *event,
+                                               gpointer user_data
+);
+static gboolean map_view_on_button_release_event(G_GNUC_UNUSED GtkWidget *widget,
+                                                 GdkEventButton *event,
+                                                 gpointer user_data
+);
+static gboolean map_view_on_motion_notify_event(G_GNUC_UNUSED GtkWidget *widget,
+                                                GdkEventMotion *event,
+                                                gpointer user_data
+);
+
+Map_view *map_view_create(GtkWidget *event_widget, GtkDrawingArea *drawing_area,
+                          GtkFixed *map_points_fixed
+) {
+    g_return_val_if_fail(GTK_IS_WIDGET(event_widget), NULL);
+    g_return_val_if_fail(GTK_IS_DRAWING_AREA(drawing_area), NULL);
+    g_return_val_if_fail(GTK_IS_FIXED(map_points_fixed), NULL);
+
+    Map_view *view;
+
+    view = g_slice_new0(Map_view);
+    view->event_widget = g_object_ref(event_widget);
+    view->drawing_area = g_object_ref(drawing_area);
+    view->map_points_fixed = g_object_ref(map_points_fixed);
+    view->zoom = MIN_ZOOM;
+    view->tiles = g_hash_table_new(g_direct_hash, g_direct_equal);
+    view->tile_queue = g_queue_new();
+
+    if (!map_view_load_pyramid(view)) {
+        view->levels = 0;
+    }
+
+    g_signal_connect(drawing_area, "draw", G_CALLBACK(map_view_on_draw), view);
+    g_signal_connect(
+        drawing_area, "size-allocate",
+        G_CALLBACK(map_view_on_size_allocate), view
+    );
+    g_signal_connect(
+        drawing_area, "notify::scale-factor",
+        G_CALLBACK(map_view_on_scale_factor_notify), view
+    );
+    g_signal_connect(
+        event_widget, "scroll-event",
+        G_CALLBACK(map_view_on_scroll_event), view
+    );
+    g_signal_connect(
+        event_widget, "button-press-event",
+        G_CALLBACK(map_view_on_button_press_event), view
+    );
+    g_signal_connect(
+        event_widget, "button-release-event",
+        G_CALLBACK(map_view_on_button_release_event), view
+    );
+    g_signal_connect(
+        event_widget, "motion-notify-event",
+        G_CALLBACK(map_view_on_motion_notify_event), view
+    );
+
+    return view;
+}
+
+void map_view_destroy(Map_view *view) {
+    g_return_if_fail(view != NULL);
+
+    GList *i;
+
+    g_signal_handlers_disconnect_by_data(view->drawing_area, view);
+    g_signal_handlers_disconnect_by_data(view->event_widget, view);
+
+    for (i = view->points; i != NULL; i = i->next) {
+        g_slice_free(Map_view_point, i->data);
+    }
+    g_list_free(view->points);
+
+    g_hash_table_destroy(view->tiles);
+    g_queue_free_full(view->tile_queue, map_view_tile_free);
+
+    g_object_unref(view->map_points_fixed);
+    g_object_unref(view->drawing_area);
+    g_object_unref(view->event_widget);
+    g_slice_free(Map_view, view);
+}
+
+void map_view_add_map_point(Map_view *view, Map_point *map_point) {
+    g_return_if_fail(view != NULL);
+    g_return_if_fail(map_point != NULL);
+
+    gint button_position;
+    gint natural_width;
+    Map_view_point *point;
+    GtkContainer *container;
+
+    container = map_point_get_container(map_point);
+
+    point = g_slice_new0(Map_view_point);
+    point->map_point = map_point;
+    point->anchor_x = MAP_POINT_ANCHOR;
+    point->anchor_y = MAP_POINT_ANCHOR;
+    point->visible = TRUE;
+    map_point_get_position(map_point, &point->x, &point->y);
+
+    // Some map points have the name on the left side of the button,
+    // the location on the map is the center of the button, not the
+    // top left corner of the container.
+    gtk_container_child_get(
+        container,
+        GTK_WIDGET(map_point_get_button(map_point)),
+        "position", &button_position,
+        NULL
+    );
+    if (button_position > 0) {
+        gtk_widget_get_preferred_width(GTK_WIDGET(container), NULL, &natural_width);
+        point->anchor_x = natural_width - MAP_POINT_ANCHOR;
+    }
+
+    view->points = g_list_prepend(view->points, point);
+}
+
+gdouble map_view_get_zoom(Map_view *view) {
+    g_return_val_if_fail(view != NULL, MIN_ZOOM);
+
+    return view->zoom;
+}
+
+void map_view_set_zoom(Map_view *view, gdouble zoom,
+                       gdouble anchor_x, gdouble anchor_y
+) {
+    g_return_if_fail(view != NULL);
+
+    gdouble map_x, map_y;
+    gdouble max_zoom;
+
+    max_zoom = MAX(MIN_MAX_ZOOM, (gdouble) (1 << MAX(view->levels, 1)));
+    zoom = CLAMP(zoom, MIN_ZOOM, max_zoom);
+
+    if (zoom == view->zoom) {
+        return;
+    }
+
+    // Keep the part of the map under the anchor in place.
+    map_x = (view->offset_x + anchor_x) / view->zoom;
+    map_y = (view->offset_y + anchor_y) / view->zoom;
+
+    view->zoom = zoom;
+    view->offset_x = map_x * zoom - anchor_x;
+    view->offset_y = map_y * zoom - anchor_y;
+
+    map_view_update(view);
+}
+
+void map_view_pan(Map_view *view, gdouble dx, gdouble dy) {
+    g_return_if_fail(view != NULL);
+
+    view->offset_x += dx;
+    view->offset_y += dy;
+
+    map_view_update(view);
+}
+
+void map_view_reset(Map_view *view) {
+    g_return_if_fail(view != NULL);
+
+    view->zoom = MIN_ZOOM;
+    view->offset_x = 0;
+    view->offset_y = 0;
+
+    map_view_update(view);
+}
+
+void map_view_map_to_view(Map_view *view, gdouble map_x, gdouble map_y,
+                          gdouble *x, gdouble *y
+) {
+    g_return_if_fail(view != NULL);
+
+    if (x != NULL) {
+        *x = map_x * view->zoom - view->offset_x;
+    }
+
+    if (y != NULL) {
+        *y = map_y * view->zoom - view->offset_y;
+    }
+}
+
+void map_view_get_map_size(Map_view *view, gint *width, gint *height) {
+    g_return_if_fail(view != NULL);
+
+    if (width != NULL) {
+        *width = view->width;
+    }
+
+    if (height != NULL) {
+        *height = view->height;
+    }
+}
+
+gsize map_view_get_tiles_size(Map_view *view) {
+    g_return_val_if_fail(view != NULL, 0);
+
+    // The pixels of the rendered tiles that are kept, at most the budget.
+    return view->tiles_size;
+}
+
+void map_view_get_map_point_location(Map_view *view, Map_point *map_point,
+                                     gdouble *x, gdouble *y
+) {
+    g_return_if_fail(view != NULL);
+    g_return_if_fail(map_point != NULL);
+
+    GList *i;
+    gint base_x, base_y;
+    gint anchor_x = MAP_POINT_ANCHOR, anchor_y = MAP_POINT_ANCHOR;
+    Map_view_point *point;
+
+    for (i = view->points; i != NULL; i = i->next) {
+        point = (Map_view_point *) i->data;
+
+        if (point->map_point == map_point) {
+            anchor_x = point->anchor_x;
+            anchor_y = point->anchor_y;
+            break;
+        }
+    }
+
+    map_point_get_position(map_point, &base_x, &base_y);
+
+    if (x != NULL) {
+        *x = base_x + anchor_x;
+    }
+
+    if (y != NULL) {
+        *y = base_y + anchor_y;
+    }
+}
+
+void map_view_set_overlay(Map_view *view, Map_view_overlay_func func,
+                          gpointer user_data
+) {
+    g_return_if_fail(view != NULL);
+
+    view->overlay_func = func;
+    view->overlay_data = user_data;
+
+    gtk_widget_queue_draw(GTK_WIDGET(view->drawing_area));
+}
+
+void map_view_queue_overlay_draw(Map_view *view) {
+    g_return_if_fail(view != NULL);
+
+    if (view->overlay_func != NULL) {
+        gtk_widget_queue_draw(GTK_WIDGET(view->drawing_area));
+    }
+}
+
+static gboolean map_view_load_pyramid(Map_view *view) {
+    GBytes *bytes;
+    GKeyFile *key_file;
+    GError *error = NULL;
+
+    bytes = g_resources_lookup_data(
+        TILES_PATH "/pyramid.ini",
+        G_RESOURCE_LOOKUP_FLAGS_NONE,
+        &error
+    );
+
+    if (error != NULL) {
+        g_printerr("%s\n", error->message);
+
+        g_error_free(error);
+        return FALSE;
+    }
+
+    key_file = g_key_file_new();
+    g_key_file_load_from_bytes(key_file, bytes, G_KEY_FILE_NONE, &error);
+
+    if (error != NULL) {
+        g_printerr("%s\n", error->message);
+
+        g_error_free(error);
+        g_key_file_free(key_file);
+        g_bytes_unref(bytes);
+        return FALSE;
+    }
+
+    view->width = g_key_file_get_integer(key_file, "pyramid", "width", NULL);
+    view->height = g_key_file_get_integer(key_file, "pyramid", "height", NULL);
+    view->tile_size = g_key_file_get_integer(key_file, "pyramid", "tile_size", NULL);
+    view->levels = g_key_file_get_integer(key_file, "pyramid", "levels", NULL);
+
+    g_key_file_free(key_file);
+    g_bytes_unref(bytes);
+
+    return view->width > 0 && view->height > 0 &&
+           view->tile_size > 0 && view->levels > 0;
+}
+
+static gint map_view_pick_level(Map_view *view) {
+    gint level = 0;
+    gdouble device_zoom;
+
+    // Level n of the pyramid has 2^n pixels per map unit, on HiDPI
+    // screens a more detailed level is used for the same zoom.
+    device_zoom = view->zoom * gtk_widget_get_scale_factor(
+        GTK_WIDGET(view->drawing_area)
+    );
+
+    while (level < view->levels - 1 && (gdouble) (1 << level) < device_zoom) {
+        level++;
+    }
+
+    return level;
+}
+
+static cairo_surface_t *map_view_get_tile(Map_view *view, gint level,
+                                          gint column, gint row
+) {
+    guint key;
+    GList *link;
+    Map_tile *tile;
+
+    key = TILE_KEY(level, column, row);
+    link = (GList *) g_hash_table_lookup(view->tiles, GUINT_TO_POINTER(key));
+
+    if (link != NULL) {
+        g_queue_unlink(view->tile_queue, link);
+        g_queue_push_head_link(view->tile_queue, link);
+
+        return ((Map_tile *) link->data)->surface;
+    }
+
+    tile = g_slice_new(Map_tile);
+    tile->key = key;
+    tile->surface = map_view_load_tile(level, column, row);
+
+    g_queue_push_head(view->tile_queue, tile);
+    g_hash_table_insert(
+        view->tiles,
+        GUINT_TO_POINTER(key),
+        g_queue_peek_head_link(view->tile_queue)
+    );
+
+    view->tiles_size += map_view_get_tile_size(tile);
+    map_view_evict_tiles(view);
+
+    return tile->surface;
+}
+
+static void map_view_update_tiles_budget(Map_view *view) {
+    gint level_scale;
+    gint columns, rows;
+    gint visible_columns, visible_rows;
+    gdouble tile_view_size;
+
+    if (view->levels <= 0) {
+        return;
+    }
+
+    level_scale = 1 << map_view_pick_level(view);
+    tile_view_size = view->tile_size * view->zoom / level_scale;
+
+    columns = (view->width * level_scale + view->tile_size - 1) / view->tile_size;
+    rows = (view->height * level_scale + view->tile_size - 1) / view->tile_size;
+
+    // A viewport that is not aligned to the tiles cuts one more of them.
+    visible_columns = (gint) (gtk_widget_get_allocated_width(GTK_WIDGET(view->drawing_area)) / tile_view_size) + 2;
+    visible_rows = (gint) (gtk_widget_get_allocated_height(GTK_WIDGET(view->drawing_area)) / tile_view_size) + 2;
+
+    visible_columns = MIN(visible_columns + 2 * TILE_CACHE_MARGIN, columns);
+    visible_rows = MIN(visible_rows + 2 * TILE_CACHE_MARGIN, rows);
+
+    view->tiles_budget = (gsize) visible_columns * (gsize) visible_rows *
+                         (gsize) view->tile_size * (gsize) view->tile_size * 4;
+
+    map_view_evict_tiles(view);
+}
+
+static void map_view_evict_tiles(Map_view *view) {
+    Map_tile *tile;
+
+    // The tile that was just loaded is at the head, it is never evicted.
+    while (view->tiles_size > view->tiles_budget && g_queue_get_length(view->tile_queue) > 1) {
+        tile = (Map_tile *) g_queue_pop_tail(view->tile_queue);
+
+        g_hash_table_remove(view->tiles, GUINT_TO_POINTER(tile->key));
+        view->tiles_size -= map_view_get_tile_size(tile);
+        map_view_tile_free(tile);
+    }
+}
+
+static cairo_surface_t *map_view_load_tile(gint level, gint column, gint row) {
+    gchar *path;
+    GdkPixbuf *pixbuf;
+    GError *error = NULL;
+    cairo_surface_t *surface;
+
+    path = g_strdup_printf(TILES_PATH "/%d/%d-%d.png", level, column, row);
+    pixbuf = gdk_pixbuf_new_from_resource(path, &error);
+    g_free(path);
+
+    if (error != NULL) {
+        g_printerr("%s\n", error->message);
+
+        g_error_free(error);
+        return NULL;
+    }
+
+    surface = gdk_cairo_surface_create_from_pixbuf(pixbuf, 1, NULL);
+    g_object_unref(G_OBJECT(pixbuf));
+
+    return surface;
+}
+
+static void map_view_tile_free(gpointer user_data) {
+    Map_tile *tile = (Map_tile *) user_data;
+
+    if (tile->surface != NULL) {
+        cairo_surface_destroy(tile->surface);
+    }
+
+    g_slice_free(Map_tile, tile);
+}
+
+static gsize map_view_get_tile_size(Map_tile *tile) {
+    if (tile->surface == NULL) {
+        return 0;
+    }
+
+    return (gsize) cairo_image_surface_get_stride(tile->surface) *
+           (gsize) cairo_image_surface_get_height(tile->surface);
+}
+
+static void map_view_clamp_offset(Map_view *view) {
+    gdouble max_offset_x, max_offset_y;
+
+    max_offset_x = view->width * view->zoom -
+                   gtk_widget_get_allocated_width(GTK_WIDGET(view->drawing_area));
+    max_offset_y = view->height * view->zoom -
+                   gtk_widget_get_allocated_height(GTK_WIDGET(view->drawing_area));
+
+    view->offset_x = CLAMP(view->offset_x, 0, MAX(max_offset_x, 0));
+    view->offset_y = CLAMP(view->offset_y, 0, MAX(max_offset_y, 0));
+}
+
+static void map_view_update(Map_view *view) {
+    map_view_clamp_offset(view);
+    map_view_update_map_points(view);
+    // The zoom picks the level, and with it the size of the tiles on screen.
+    map_view_update_tiles_budget(view);
+
+    gtk_widget_queue_draw(GTK_WIDGET(view->drawing_area));
+}
+
+static void map_view_update_map_points(Map_view *view) {
+    GList *i;
+    gint x, y;
+    gint base_x, base_y;
+    gint width, height;
+    gdouble view_x, view_y;
+    gboolean visible;
+    GtkWidget *container;
+    Map_view_point *point;
+
+    width = gtk_widget_get_allocated_width(GTK_WIDGET(view->drawing_area));
+    height = gtk_widget_get_allocated_height(GTK_WIDGET(view->drawing_area));
+
+    for (i = view->points; i != NULL; i = i->next) {
+        point = (Map_view_point *) i->data;
+        container = GTK_WIDGET(map_point_get_container(point->map_point));
+
+        map_point_get_position(point->map_point, &base_x, &base_y);
+        map_view_map_to_view(
+            view,
+            base_x + point->anchor_x,
+            base_y + point->anchor_y,
+            &view_x, &view_y
+        );
+
+        visible = view_x >= 0 && view_y >= 0 && view_x < width && view_y < height;
+        if (visible != point->visible) {
+            gtk_widget_set_child_visible(container, visible);
+            point->visible = visible;
+        }
+
+        x = (gint) view_x - point->anchor_x;
+        y = (gint) view_y - point->anchor_y;
+
+        // gtk_fixed_move always queues a resize, so skip the points
+        // that did not move to avoid an endless size-allocate loop.
+        if (visible && (x != point->x || y != point->y)) {
+            gtk_fixed_move(view->map_points_fixed, container, x, y);
+            point->x = x;
+            point->y = y;
+        }
+    }
+}
+
+static void map_view_event_position(Map_view *view, gdouble x_root, gdouble y_root,
+                                    gdouble *x, gdouble *y
+) {
+    gint origin_x = 0, origin_y = 0;
+    GdkWindow *window;
+
+    window = gtk_widget_get_window(GTK_WIDGET(view->drawing_area));
+    if (window != NULL) {
+        gdk_window_get_origin(window, &origin_x, &origin_y);
+    }
+
+    *x = x_root - origin_x;
+    *y = y_root - origin_y;
+}
+
+static gboolean map_view_on_draw(GtkWidget *widget, cairo_t *cr, gpointer user_data) {
+    Map_view *view = (Map_view *) user_data;
+
+    gint level, level_scale;
+    gint column, row, columns, rows;
+    gint first_column, last_column, first_row, last_row;
+    gdouble scale;
+    cairo_surface_t *tile;
+
+    if (view->levels <= 0) {
+        return FALSE;
+    }
+
+    watchdog_enter(G_STRFUNC);
+
+    level = map_view_pick_level(view);
+    level_scale = 1 << level;
+    scale = view->zoom / level_scale;
+
+    columns = (view->width * level_scale + view->tile_size - 1) / view->tile_size;
+    rows = (view->height * level_scale + view->tile_size - 1) / view->tile_size;
+
+    // Only the tiles that intersect the viewport are loaded.
+    first_column = (gint) (view->offset_x / scale) / view->tile_size;
+    first_row = (gint) (view->offset_y / scale) / view->tile_size;
+    last_column = (gint) (
+        (view->offset_x + gtk_widget_get_allocated_width(widget)) / scale
+    ) / view->tile_size;
+    last_row = (gint) (
+        (view->offset_y + gtk_widget_get_allocated_height(widget)) / scale
+    ) / view->tile_size;
+
+    first_column = CLAMP(first_column, 0, columns - 1);
+    first_row = CLAMP(first_row, 0, rows - 1);
+    last_column = CLAMP(last_column, 0, columns - 1);
+    last_row = CLAMP(last_row, 0, rows - 1);
+
+    cairo_save(cr);
+    cairo_translate(cr, -view->offset_x, -view->offset_y);
+    cairo_scale(cr, scale, scale);
+
+    for (row = first_row; row <= last_row; row++) {
+        for (column = first_column; column <= last_column; column++) {
+            tile = map_view_get_tile(view, level, column, row);
+            if (tile == NULL) {
+                continue;
+            }
+
+            cairo_set_source_surface(
+                cr, tile,
+                column * view->tile_size,
+                row * view->tile_size
+            );
+            // Avoids seams between the tiles at fractional zoom levels.
+            cairo_pattern_set_extend(cairo_get_source(cr), CAIRO_EXTEND_PAD);
+            cairo_rectangle(
+                cr,
+                column * view->tile_size,
+                row * view->tile_size,
+                cairo_image_surface_get_width(tile),
+                cairo_image_surface_get_height(tile)
+            );
+            cairo_fill(cr);
+        }
+    }
+
+    cairo_restore(cr);
+
+    if (view->overlay_func != NULL) {
+        map_view_draw_overlay(view, widget, cr);
+    }
+
+    watchdog_leave();
+
+    return FALSE;
+}
+
+static void map_view_draw_overlay(Map_view *view, GtkWidget *widget, cairo_t *cr) {
+    cairo_surface_t *overlay;
+
+    // The overlay is rendered once at the base resolution and only scaled
+    // here, zooming and panning never render it again.
+    overlay = view->overlay_func(gtk_widget_get_scale_factor(widget), view->overlay_data);
+    if (overlay == NULL) {
+        return;
+    }
+
+    cairo_save(cr);
+    cairo_translate(cr, -view->offset_x, -view->offset_y);
+    cairo_scale(cr, view->zoom, view->zoom);
+    cairo_set_source_surface(cr, overlay, 0, 0);
+    cairo_paint(cr);
+    cairo_restore(cr);
+}
+
+static void map_view_on_size_allocate(G_GNUC_UNUSED GtkWidget *widget,
+                                      G_GNUC_UNUSED GdkRectangle *allocation,
+                                      gpointer user_data
+) {
+    Map_view *view = (Map_view *) user_data;
+
+    map_view_clamp_offset(view);
+    map_view_update_map_points(view);
+    map_view_update_tiles_budget(view);
+}
+
+static void map_view_on_scale_factor_notify(G_GNUC_UNUSED GObject *object,
+                                            G_GNUC_UNUSED GParamSpec *pspec,
+                                            gpointer user_data
+) {
+    // A HiDPI screen draws from a more detailed level.
+    map_view_update_tiles_budget((Map_view *) user_data);
+}
+
+static gboolean map_view_on_scroll_event(G_GNUC_UNUSED GtkWidget *widget,
+                                         GdkEventScroll *event,
+                                         gpointer user_data
+) {
+    Map_view *view = (Map_view *) user_data;
+
+    gdouble x, y;
+    gdouble delta_x, delta_y;
+    gdouble factor;
+
+    switch (event->direction) {
+        case GDK_SCROLL_UP:
+            factor = ZOOM_STEP;
+            break;
+        case GDK_SCROLL_DOWN:
+            factor = 1.0 / ZOOM_STEP;
+            break;
+        case GDK_SCROLL_SMOOTH:
+            gdk_event_get_scroll_deltas((GdkEvent *) event, &delta_x, &delta_y);
+            if (delta_y == 0) {
+                return FALSE;
+            }
+
+            factor = delta_y < 0 ? ZOOM_STEP : 1.0 / ZOOM_STEP;
+            break;
+        default:
+            return FALSE;
+    }
+
+    map_view_event_position(view, event->x_root, event->y_root, &x, &y);
+    map_view_set_zoom(view, view->zoom * factor, x, y);
+
+    return TRUE;
+}
+
+static gboolean map_view_on_button_press_event(G_GNUC_UNUSED GtkWidget *widget,
+                                               GdkEventButton *event,
+                                               gpointer user_data
+) {
+    Map_view *view = (Map_view *) user_data;
+
+    if (event->button != GDK_BUTTON_PRIMARY) {
+        return FALSE;
+    }
+
+    if (event->type == GDK_2BUTTON_PRESS) {
+        map_view_reset(view);
+        return TRUE;
+    }
+
+    view->dragging = TRUE;
+    view->drag_x = event->x_root;
+    view->drag_y = event->y_root;
+
+    return TRUE;
+}
+
+static gboolean map_view_on_button_release_event(G_GNUC_UNUSED GtkWidget *widget,
+                                                 GdkEventButton *event,
+                                                 gpointer user_data
+) {
+    Map_view *view = (Map_view *) user_data;
+
+    if (event->button != GDK_BUTTON_PRIMARY || !view->dragging) {
+        return FALSE;
+    }
+
+    view->dragging = FALSE;
+
+    return TRUE;
+}
+
+static gboolean map_view_on_motion_notify_event(G_GNUC_UNUSED GtkWidget *widget,
+                                                GdkEventMotion *event,
+                                                gpointer user_data
+) {
+    Map_view *view = (Map_view *) user_data;
+
+    if (!view->dragging) {
+        return FALSE;
+    }
+
+    map_view_pan(view, view->drag_x - event->x_root, view->drag_y - event->y_root);
+    view->drag_x = event->x_root;
+    view->drag_y = event->y_root;
+
+    return TRUE;
+}
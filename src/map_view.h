@@ -0,0 +1,37 @@
+#ifndef MAP_VIEW_H
+#define MAP_VIEW_H
+
+#include <gtk/gtk.h>
+#include "map_point.h"
+
+typedef struct map_view_t Map_view;
+
+// Returns a surface that covers the whole map in map units, with
+// scale_factor pixels per unit. The surface stays owned by the caller.
+typedef cairo_surface_t *(*Map_view_overlay_func)(gint scale_factor, gpointer user_data);
+
+Map_view *map_view_create(GtkWidget *event_widget, GtkDrawingArea *drawing_area,
+                          GtkFixed *map_points_fixed
+);
+void map_view_destroy(Map_view *view);
+void map_view_add_map_point(Map_view *view, Map_point *map_point);
+gdouble map_view_get_zoom(Map_view *view);
+void map_view_set_zoom(Map_view *view, gdouble zoom,
+                       gdouble anchor_x, gdouble anchor_y
+);
+void map_view_pan(Map_view *view, gdouble dx, gdouble dy);
+void map_view_reset(Map_view *view);
+void map_view_map_to_view(Map_view *view, gdouble map_x, gdouble map_y,
+                          gdouble *x, gdouble *y
+);
+void map_view_get_map_size(Map_view *view, gint *width, gint *height);
+void map_view_get_map_point_location(Map_view *view, Map_point *map_point,
+                                     gdouble *x, gdouble *y
+);
+void map_view_set_overlay(Map_view *view, Map_view_overlay_func func,
+                          gpointer user_data
+);
+void map_view_queue_overlay_draw(Map_view *view);
+gsize map_view_get_tiles_size(Map_view *view);
+
+#endif
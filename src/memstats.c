@@ -0,0 +1,185 @@
+#include <string.h>
+#include <gtk/gtk.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include "memstats.h"
+
+#define MEMSTATS_STATUS_PATH "/proc/self/status"
+#define MEMSTATS_RESIDENT_FIELD "VmRSS:"
+
+// Memory report by owner. The sizes come from the owners themselves
+// (counters kept where the memory is allocated), the resident size from
+// the kernel, and whatever the owners do not account for is reported as
+// untracked: the heap overhead, GTK internals and the shared libraries.
+// The sizes that are computed rather than counted are marked as
+// estimates.
+typedef struct memstats_entry_t {
+    const gchar *owner;
+    gsize size;
+    gboolean estimate;
+} Memstats_entry;
+
+struct memstats_t {
+    GArray *entries;
+};
+
+static void memstats_append(Memstats *stats, const gchar *owner, gsize size, gboolean estimate);
+static void memstats_add_widget_size(GtkWidget *widget, gpointer user_data);
+
+Memstats *memstats_create(void) {
+    Memstats *stats;
+
+    stats = g_slice_new(Memstats);
+    stats->entries = g_array_new(FALSE, FALSE, sizeof(Memstats_entry));
+
+    return stats;
+}
+
+void memstats_destroy(Memstats *stats) {
+    g_return_if_fail(stats != NULL);
+
+    g_array_free(stats->entries, TRUE);
+    g_slice_free(Memstats, stats);
+}
+
+void memstats_add(Memstats *stats, const gchar *owner, gsize size) {
+    g_return_if_fail(stats != NULL);
+    g_return_if_fail(owner != NULL);
+
+    memstats_append(stats, owner, size, FALSE);
+}
+
+void memstats_add_estimate(Memstats *stats, const gchar *owner, gsize size) {
+    g_return_if_fail(stats != NULL);
+    g_return_if_fail(owner != NULL);
+
+    memstats_append(stats, owner, size, TRUE);
+}
+
+void memstats_print(Memstats *stats) {
+    g_return_if_fail(stats != NULL);
+
+    guint i;
+    gsize total, resident;
+    Memstats_entry *entry;
+
+    total = 0;
+    for (i = 0; i < stats->entries->len; i++) {
+        entry = &g_array_index(stats->entries, Memstats_entry, i);
+        total += entry->size;
+
+        g_printerr(
+            "memstats: %-28s %8" G_GSIZE_FORMAT " kB%s\n", entry->owner,
+            (entry->size + 1023) / 1024, entry->estimate ? " estimate" : ""
+        );
+    }
+
+    g_printerr("memstats: %-28s %8" G_GSIZE_FORMAT " kB\n", "tracked", (total + 1023) / 1024);
+
+    resident = memstats_get_resident_size();
+    if (resident == 0) {
+        g_printerr("memstats: %-28s %8s\n", "resident", "unknown");
+        return;
+    }
+
+    g_printerr("memstats: %-28s %8" G_GSIZE_FORMAT " kB\n", "resident", resident / 1024);
+    g_printerr(
+        "memstats: %-28s %8" G_GSIZE_FORMAT " kB\n", "untracked",
+        resident > total ? (resident - total) / 1024 : 0
+    );
+}
+
+gsize memstats_get_resource_size(const gchar *path) {
+    g_return_val_if_fail(path != NULL, 0);
+
+    gsize size, total;
+    gchar **children;
+    gchar *child_path;
+    guint i;
+
+    // A path that is not a directory has no children.
+    children = g_resources_enumerate_children(path, G_RESOURCE_LOOKUP_FLAGS_NONE, NULL);
+    if (children == NULL) {
+        return g_resources_get_info(path, G_RESOURCE_LOOKUP_FLAGS_NONE, &size, NULL, NULL) ? size : 0;
+    }
+
+    total = 0;
+    for (i = 0; children[i] != NULL; i++) {
+        child_path = g_build_path("/", path, children[i], NULL);
+        total += memstats_get_resource_size(child_path);
+        g_free(child_path);
+    }
+
+    g_strfreev(children);
+
+    return total;
+}
+
+gsize memstats_get_widget_size(GtkWidget *widget) {
+    g_return_val_if_fail(GTK_IS_WIDGET(widget), 0);
+
+    gsize size = 0;
+
+    memstats_add_widget_size(widget, &size);
+
+    return size;
+}
+
+gsize memstats_get_heap_size(void) {
+    // Bytes in use in the heap of the whole process, mallinfo2 sums every
+    // arena, 0 where it is unknown. A difference of two calls also counts
+    // what the other threads allocated or freed in between.
+#if defined(__GLIBC__) && defined(__GLIBC_PREREQ)
+#if __GLIBC_PREREQ(2, 33)
+    return mallinfo2().uordblks;
+#else
+    return 0;
+#endif
+#else
+    return 0;
+#endif
+}
+
+gsize memstats_get_resident_size(void) {
+    gchar *status;
+    gchar *line;
+    gsize size = 0;
+
+    // Linux only, everywhere else the resident size is unknown.
+    if (!g_file_get_contents(MEMSTATS_STATUS_PATH, &status, NULL, NULL)) {
+        return 0;
+    }
+
+    line = strstr(status, MEMSTATS_RESIDENT_FIELD);
+    if (line != NULL) {
+        size = (gsize) g_ascii_strtoull(line + strlen(MEMSTATS_RESIDENT_FIELD), NULL, 10) * 1024;
+    }
+
+    g_free(status);
+
+    return size;
+}
+
+static void memstats_append(Memstats *stats, const gchar *owner, gsize size, gboolean estimate) {
+    Memstats_entry entry;
+
+    entry.owner = owner;
+    entry.size = size;
+    entry.estimate = estimate;
+    g_array_append_val(stats->entries, entry);
+}
+
+static void memstats_add_widget_size(GtkWidget *widget, gpointer user_data) {
+    GTypeQuery query;
+
+    // Only the instance structures, the private data of the widgets is
+    // not visible through GType, so this is a lower bound.
+    g_type_query(G_OBJECT_TYPE(widget), &query);
+    *((gsize *) user_data) += query.instance_size;
+
+    // Internal children included, so are the popovers of a window.
+    if (GTK_IS_CONTAINER(widget)) {
+        gtk_container_forall(GTK_CONTAINER(widget), memstats_add_widget_size, user_data);
+    }
+}
@@ -0,0 +1,18 @@
+#ifndef MEMSTATS_H
+#define MEMSTATS_H
+
+#include <gtk/gtk.h>
+
+typedef struct memstats_t Memstats;
+
+Memstats *memstats_create(void);
+void memstats_destroy(Memstats *stats);
+void memstats_add(Memstats *stats, const gchar *owner, gsize size);
+void memstats_add_estimate(Memstats *stats, const gchar *owner, gsize size);
+void memstats_print(Memstats *stats);
+gsize memstats_get_resource_size(const gchar *path);
+gsize memstats_get_widget_size(GtkWidget *widget);
+gsize memstats_get_heap_size(void);
+gsize memstats_get_resident_size(void);
+
+#endif
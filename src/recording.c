@@ -0,0 +1,374 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include "recording.h"
+#include "city.h"
+
+// File format, all of the fixed size numbers are little endian and the
+// variable size ones are LEB128 varints:
+//
+//   header  "GSRC", version (u32), city count (u32), fingerprint (u32)
+//   cities  the names in the order of the game, with the terminating NULs
+//   events  type (u8), delay in microseconds (varint), and for
+//             start, restart  seed (u32), mode (u8), difficulty (u8)
+//             answer          correct (u8), length (varint), the answer
+//                             with the terminating NUL
+//
+// Only the input is recorded, the cities of a game follow from its seed,
+// so the same cities in the same order (checked by the fingerprint)
+// replay the same games.
+// The events are written as they happen, an event cut off by a crash
+// ends the recording.
+#define RECORDING_MAGIC "GSRC"
+#define RECORDING_VERSION 2
+#define RECORDING_HEADER_SIZE 16
+// Type, delay and the start payload.
+#define RECORDING_MAX_FIXED_SIZE 32
+#define RECORDING_FNV_OFFSET 2166136261u
+#define RECORDING_FNV_PRIME 16777619u
+
+struct recorder_t {
+    FILE *file;
+    gint64 last_time;
+    // The buffer of the file, so recording an answer never allocates.
+    gchar buffer[BUFSIZ];
+};
+
+struct recording_t {
+    gchar *path;
+    gchar *contents;
+    gsize length;
+    gsize position;
+    // The first event, after the names of the cities.
+    gsize events_position;
+    guint32 city_count;
+    guint32 fingerprint;
+    // Point into the contents.
+    const gchar **city_names;
+};
+
+static gsize recording_write_varint(guint8 *buffer, guint64 value);
+static gboolean recording_read_varint(Recording *recording, guint64 *value);
+static void recording_write_u32(guint8 *buffer, guint32 value);
+static guint32 recording_read_u32(const gchar *buffer);
+
+guint32 recording_fingerprint(GList *cities) {
+    guint32 hash = RECORDING_FNV_OFFSET;
+    const gchar *name;
+
+    // FNV-1a of the names in the order of the list, with the NULs.
+    for (; cities != NULL; cities = cities->next) {
+        name = city_get_name((City *) cities->data);
+
+        do {
+            hash = (hash ^ (guint8) *name) * RECORDING_FNV_PRIME;
+        } while (*name++ != '\0');
+    }
+
+    return hash;
+}
+
+Recorder *recorder_create(const gchar *path, GList *cities, GError **error) {
+    g_return_val_if_fail(path != NULL, NULL);
+
+    FILE *file;
+    guint8 header[RECORDING_HEADER_SIZE];
+    const gchar *name;
+    Recorder *recorder;
+
+    file = g_fopen(path, "wb");
+    if (file == NULL) {
+        g_set_error(
+            error, G_FILE_ERROR, g_file_error_from_errno(errno),
+            "Could not open %s: %s", path, g_strerror(errno)
+        );
+        return NULL;
+    }
+
+    recorder = g_slice_new(Recorder);
+    recorder->file = file;
+    setvbuf(file, recorder->buffer, _IOFBF, sizeof(recorder->buffer));
+
+    memcpy(header, RECORDING_MAGIC, 4);
+    recording_write_u32(header + 4, RECORDING_VERSION);
+    recording_write_u32(header + 8, g_list_length(cities));
+    recording_write_u32(header + 12, recording_fingerprint(cities));
+    fwrite(header, 1, sizeof(header), file);
+
+    for (; cities != NULL; cities = cities->next) {
+        name = city_get_name((City *) cities->data);
+        fwrite(name, 1, strlen(name) + 1, file);
+    }
+
+    recorder->last_time = g_get_monotonic_time();
+
+    return recorder;
+}
+
+void recorder_destroy(Recorder *recorder) {
+    g_return_if_fail(recorder != NULL);
+
+    fclose(recorder->file);
+    g_slice_free(Recorder, recorder);
+}
+
+void recorder_write(Recorder *recorder, const Recording_event *event) {
+    g_return_if_fail(recorder != NULL);
+    g_return_if_fail(event != NULL);
+    g_return_if_fail(event->type != RECORDING_ANSWER || event->answer != NULL);
+
+    gsize size, length;
+    gint64 now;
+    guint8 buffer[RECORDING_MAX_FIXED_SIZE];
+
+    now = g_get_monotonic_time();
+
+    buffer[0] = (guint8) event->type;
+    size = 1 + recording_write_varint(buffer + 1, (guint64) (now - recorder->last_time));
+    recorder->last_time = now;
+
+    switch (event->type) {
+        case RECORDING_START:
+        case RECORDING_RESTART:
+            recording_write_u32(buffer + size, event->seed);
+            buffer[size + 4] = event->mode;
+            buffer[size + 5] = event->difficulty;
+            size += 6;
+            break;
+        case RECORDING_ANSWER:
+            length = strlen(event->answer) + 1;
+            buffer[size] = event->correct ? 1 : 0;
+            size += 1 + recording_write_varint(buffer + size + 1, length);
+            break;
+        default:
+            break;
+    }
+
+    fwrite(buffer, 1, size, recorder->file);
+
+    if (event->type == RECORDING_ANSWER) {
+        fwrite(event->answer, 1, strlen(event->answer) + 1, recorder->file);
+    }
+
+    // A finished game is on disk even if the application crashes later.
+    if (event->type == RECORDING_STOP) {
+        fflush(recorder->file);
+    }
+}
+
+Recording *recording_load(const gchar *path, GError **error) {
+    g_return_val_if_fail(path != NULL, NULL);
+
+    gsize length, position;
+    guint32 i, city_count;
+    gchar *contents, *end;
+    const gchar **city_names = NULL;
+    Recording *recording;
+
+    if (!g_file_get_contents(path, &contents, &length, error)) {
+        return NULL;
+    }
+
+    // Every name takes at least its NUL.
+    city_count = length >= RECORDING_HEADER_SIZE ? recording_read_u32(contents + 8) : 0;
+    position = RECORDING_HEADER_SIZE;
+    i = 0;
+
+    if (length >= RECORDING_HEADER_SIZE && city_count <= length - RECORDING_HEADER_SIZE) {
+        city_names = g_new(const gchar *, city_count);
+
+        for (; i < city_count; i++) {
+            end = memchr(contents + position, '\0', length - position);
+            if (end == NULL) {
+                break;
+            }
+
+            city_names[i] = contents + position;
+            position = (gsize) (end - contents) + 1;
+        }
+    }
+
+    if (length < RECORDING_HEADER_SIZE ||
+        i < city_count ||
+        memcmp(contents, RECORDING_MAGIC, 4) != 0 ||
+        recording_read_u32(contents + 4) != RECORDING_VERSION) {
+        g_set_error(
+            error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+            "%s is not a valid recording!", path
+        );
+
+        g_free(city_names);
+        g_free(contents);
+        return NULL;
+    }
+
+    recording = g_slice_new(Recording);
+    recording->path = g_strdup(path);
+    recording->contents = contents;
+    recording->length = length;
+    recording->position = position;
+    recording->events_position = position;
+    recording->city_count = city_count;
+    recording->fingerprint = recording_read_u32(contents + 12);
+    recording->city_names = city_names;
+
+    return recording;
+}
+
+void recording_destroy(Recording *recording) {
+    g_return_if_fail(recording != NULL);
+
+    g_free(recording->city_names);
+    g_free(recording->contents);
+    g_free(recording->path);
+    g_slice_free(Recording, recording);
+}
+
+guint32 recording_get_city_count(Recording *recording) {
+    g_return_val_if_fail(recording != NULL, 0);
+
+    return recording->city_count;
+}
+
+guint32 recording_get_fingerprint(Recording *recording) {
+    g_return_val_if_fail(recording != NULL, 0);
+
+    return recording->fingerprint;
+}
+
+const gchar *recording_get_city_name(Recording *recording, guint index) {
+    g_return_val_if_fail(recording != NULL, NULL);
+    g_return_val_if_fail(index < recording->city_count, NULL);
+
+    return recording->city_names[index];
+}
+
+void recording_rewind(Recording *recording) {
+    g_return_if_fail(recording != NULL);
+
+    recording->position = recording->events_position;
+}
+
+gboolean recording_next(Recording *recording, Recording_event *event, GError **error) {
+    g_return_val_if_fail(recording != NULL, FALSE);
+    g_return_val_if_fail(event != NULL, FALSE);
+
+    gsize start;
+    guint64 length;
+    const gchar *data;
+
+    start = recording->position;
+    data = recording->contents;
+
+    if (start >= recording->length) {
+        return FALSE;
+    }
+
+    memset(event, 0, sizeof(Recording_event));
+    event->type = (Recording_event_type) (guint8) data[recording->position++];
+
+    if (!recording_read_varint(recording, &event->delay)) {
+        goto truncated;
+    }
+
+    switch (event->type) {
+        case RECORDING_START:
+        case RECORDING_RESTART:
+            if (recording->length - recording->position < 6) {
+                goto truncated;
+            }
+
+            event->seed = recording_read_u32(data + recording->position);
+            event->mode = (guint8) data[recording->position + 4];
+            event->difficulty = (guint8) data[recording->position + 5];
+            recording->position += 6;
+            return TRUE;
+        case RECORDING_ANSWER:
+            if (recording->position >= recording->length) {
+                goto truncated;
+            }
+
+            event->correct = data[recording->position++] != 0;
+
+            if (!recording_read_varint(recording, &length) ||
+                length > recording->length - recording->position) {
+                goto truncated;
+            }
+
+            if (length == 0 || data[recording->position + length - 1] != '\0') {
+                break;
+            }
+
+            event->answer = data + recording->position;
+            recording->position += length;
+            return TRUE;
+        case RECORDING_NEXT_QUESTION:
+        case RECORDING_STOP:
+            return TRUE;
+        default:
+            break;
+    }
+
+    g_set_error(
+        error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+        "%s: invalid event at offset %" G_GSIZE_FORMAT "!", recording->path, start
+    );
+    recording->position = recording->length;
+
+    return FALSE;
+
+truncated:
+    // Written only partially, the application stopped in the middle.
+    recording->position = recording->length;
+
+    return FALSE;
+}
+
+static gsize recording_write_varint(guint8 *buffer, guint64 value) {
+    gsize size = 0;
+
+    while (value >= 0x80) {
+        buffer[size++] = (guint8) (value | 0x80);
+        value >>= 7;
+    }
+    buffer[size++] = (guint8) value;
+
+    return size;
+}
+
+static gboolean recording_read_varint(Recording *recording, guint64 *value) {
+    guint shift;
+    guint8 byte;
+
+    *value = 0;
+
+    for (shift = 0; shift < 64; shift += 7) {
+        if (recording->position >= recording->length) {
+            return FALSE;
+        }
+
+        byte = (guint8) recording->contents[recording->position++];
+        *value |= (guint64) (byte & 0x7F) << shift;
+
+        if ((byte & 0x80) == 0) {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+static void recording_write_u32(guint8 *buffer, guint32 value) {
+    value = GUINT32_TO_LE(value);
+    memcpy(buffer, &value, sizeof(value));
+}
+
+static guint32 recording_read_u32(const gchar *buffer) {
+    guint32 value;
+
+    memcpy(&value, buffer, sizeof(value));
+
+    return GUINT32_FROM_LE(value);
+}
@@ -0,0 +1,44 @@
+#ifndef RECORDING_H
+#define RECORDING_H
+
+#include <glib.h>
+
+typedef struct recorder_t Recorder;
+typedef struct recording_t Recording;
+
+typedef enum recording_event_type_t {
+    RECORDING_START = 1,
+    RECORDING_ANSWER,
+    RECORDING_NEXT_QUESTION,
+    RECORDING_STOP,
+    RECORDING_RESTART
+} Recording_event_type;
+
+typedef struct recording_event_t {
+    Recording_event_type type;
+    // Microseconds since the previous event.
+    guint64 delay;
+    // RECORDING_START and RECORDING_RESTART
+    guint32 seed;
+    guint8 mode;
+    guint8 difficulty;
+    // RECORDING_ANSWER, the answer is owned by the recording.
+    gboolean correct;
+    const gchar *answer;
+} Recording_event;
+
+guint32 recording_fingerprint(GList *cities);
+
+Recorder *recorder_create(const gchar *path, GList *cities, GError **error);
+void recorder_destroy(Recorder *recorder);
+void recorder_write(Recorder *recorder, const Recording_event *event);
+
+Recording *recording_load(const gchar *path, GError **error);
+void recording_destroy(Recording *recording);
+guint32 recording_get_city_count(Recording *recording);
+guint32 recording_get_fingerprint(Recording *recording);
+const gchar *recording_get_city_name(Recording *recording, guint index);
+void recording_rewind(Recording *recording);
+gboolean recording_next(Recording *recording, Recording_event *event, GError **error);
+
+#endif
@@ -0,0 +1,258 @@
+#include <stdlib.h>
+#include <glib.h>
+#include "city.h"
+#include "game_data.h"
+#include "game_logic.h"
+#include "recording.h"
+
+// Replays the sessions recorded with gradovi-srbije --record through
+// game_logic.c at full speed, without the user interface. The games are
+// restarted with the recorded seeds, so every answer must be judged the
+// same as in the recorded session, a different judgement is reported as
+// a mismatch. The replay time is compared with the recorded one, so the
+// real sessions also serve as a throughput benchmark.
+
+typedef struct replay_stats_t {
+    guint64 event_count;
+    guint64 game_count;
+    guint64 answer_count;
+    guint64 mismatch_count;
+    // The time the player took, in microseconds.
+    guint64 recorded_time;
+    // The slowest game_check_user_answer, in microseconds.
+    gint64 max_answer_time;
+} Replay_stats;
+
+static gint repeat_count = 1;
+static gchar *data_path = NULL;
+static gchar **recording_paths = NULL;
+
+static GOptionEntry option_entries[] = {
+    {"repeat", 'r', 0, G_OPTION_ARG_INT, &repeat_count, "Replay every recording N times", "N"},
+    {"data", 'd', 0, G_OPTION_ARG_FILENAME, &data_path, "Dataset instead of the built-in cities", "FILE"},
+    {
+        G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &recording_paths,
+        NULL, "RECORDING..."
+    },
+    {NULL, 0, 0, G_OPTION_ARG_NONE, NULL, NULL, NULL}
+};
+
+static GList *find_recorded_cities(Game_data *data, Recording *recording);
+static gboolean replay(Game *game, Recording *recording, Replay_stats *stats, GError **error);
+static void replay_start(Game *game, const Recording_event *event);
+
+int main(int argc, char *argv[]) {
+    gint i, j;
+    gint64 start;
+    gdouble elapsed;
+    gboolean replayed = TRUE;
+    gboolean ok;
+    Game *game;
+    GList *cities;
+    Game_data *data;
+    Recording *recording;
+    Replay_stats stats = {0};
+    GOptionContext *option_context;
+    GError *error = NULL;
+
+    option_context = g_option_context_new(NULL);
+    g_option_context_set_summary(
+        option_context,
+        "Replays the recorded game sessions without the user interface."
+    );
+    g_option_context_add_main_entries(option_context, option_entries, NULL);
+
+    if (!g_option_context_parse(option_context, &argc, &argv, &error)) {
+        g_printerr("%s\n", error->message);
+
+        g_error_free(error);
+        g_option_context_free(option_context);
+        exit(EXIT_FAILURE);
+    }
+
+    g_option_context_free(option_context);
+
+    if (recording_paths == NULL || repeat_count <= 0) {
+        g_printerr("Invalid options!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    game_data_set_index_cache_rebuild(FALSE);
+
+    if (data_path != NULL) {
+        data = game_data_create_from_file(data_path, &error);
+    } else {
+        data = game_data_create();
+    }
+
+    if (data == NULL) {
+        if (error != NULL) {
+            g_printerr("%s\n", error->message);
+            g_error_free(error);
+        }
+        exit(EXIT_FAILURE);
+    }
+
+    elapsed = 0;
+
+    for (i = 0; recording_paths[i] != NULL; i++) {
+        recording = recording_load(recording_paths[i], &error);
+        if (recording == NULL) {
+            g_printerr("%s\n", error->message);
+            g_clear_error(&error);
+            replayed = FALSE;
+            continue;
+        }
+
+        cities = find_recorded_cities(data, recording);
+        if (cities == NULL) {
+            g_printerr("%s was recorded with different cities!\n", recording_paths[i]);
+            recording_destroy(recording);
+            replayed = FALSE;
+            continue;
+        }
+
+        game = game_create(cities);
+
+        start = g_get_monotonic_time();
+        for (j = 0, ok = TRUE; j < repeat_count && ok; j++) {
+            recording_rewind(recording);
+            ok = replay(game, recording, &stats, &error);
+        }
+        elapsed += (g_get_monotonic_time() - start) / (gdouble) G_USEC_PER_SEC;
+
+        if (!ok) {
+            g_printerr("%s\n", error->message);
+            g_clear_error(&error);
+            replayed = FALSE;
+        }
+
+        game_destroy(game);
+        g_list_free(cities);
+        recording_destroy(recording);
+    }
+
+    g_print(
+        "%" G_GUINT64_FORMAT " events, %" G_GUINT64_FORMAT " games, %"
+        G_GUINT64_FORMAT " answers in %.3f s (%.0f events/s)\n",
+        stats.event_count, stats.game_count, stats.answer_count,
+        elapsed, stats.event_count / MAX(elapsed, 1e-9)
+    );
+    g_print(
+        "recorded time %.1f s, %.0fx faster, slowest answer %" G_GINT64_FORMAT " us\n",
+        stats.recorded_time / (gdouble) G_USEC_PER_SEC,
+        stats.recorded_time / (gdouble) G_USEC_PER_SEC / MAX(elapsed, 1e-9),
+        stats.max_answer_time
+    );
+
+    if (stats.mismatch_count > 0) {
+        g_print("%" G_GUINT64_FORMAT " answers judged differently!\n", stats.mismatch_count);
+        replayed = FALSE;
+    }
+
+    g_strfreev(recording_paths);
+    g_free(data_path);
+    game_data_destroy(data);
+
+    exit(replayed ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+static GList *find_recorded_cities(Game_data *data, Recording *recording) {
+    guint i;
+    City *city;
+    GList *cities = NULL;
+
+    // The seeds depend on the order of the cities in the game, it is the
+    // order of the recording, not of the dataset (a hash table). Only the
+    // recorded cities are looked up: the game leaves out the cities
+    // without a map point.
+    for (i = recording_get_city_count(recording); i > 0; i--) {
+        city = game_data_get_city(data, recording_get_city_name(recording, i - 1));
+        if (city == NULL) {
+            g_list_free(cities);
+            return NULL;
+        }
+
+        cities = g_list_prepend(cities, city);
+    }
+
+    if (recording_fingerprint(cities) != recording_get_fingerprint(recording)) {
+        g_list_free(cities);
+        return NULL;
+    }
+
+    return cities;
+}
+
+static gboolean replay(Game *game, Recording *recording, Replay_stats *stats, GError **error) {
+    gint64 start;
+    gboolean correct;
+    Recording_event event;
+
+    while (recording_next(recording, &event, error)) {
+        stats->event_count++;
+        stats->recorded_time += event.delay;
+
+        switch (event.type) {
+            case RECORDING_START:
+            case RECORDING_RESTART:
+                replay_start(game, &event);
+                stats->game_count++;
+                break;
+            case RECORDING_ANSWER:
+                if (!game_is_running(game)) {
+                    break;
+                }
+
+                start = g_get_monotonic_time();
+                correct = game_check_user_answer(game, event.answer);
+                stats->max_answer_time = MAX(stats->max_answer_time, g_get_monotonic_time() - start);
+
+                stats->answer_count++;
+                if (correct != event.correct) {
+                    stats->mismatch_count++;
+                }
+                break;
+            case RECORDING_NEXT_QUESTION:
+                if (game_is_running(game)) {
+                    game_next_question(game);
+                }
+                break;
+            case RECORDING_STOP:
+                if (game_is_running(game)) {
+                    game_stop(game);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    // The last game of a session that was not stopped.
+    if (game_is_running(game)) {
+        game_stop(game);
+    }
+
+    return error == NULL || *error == NULL;
+}
+
+static void replay_start(Game *game, const Recording_event *event) {
+    if (game_is_running(game)) {
+        game_stop(game);
+    }
+
+    game_set_mode(game, event->mode == TYPING || event->mode == CHOICE ? (Game_mode) event->mode : SELECTION);
+
+    switch (event->difficulty) {
+        case EASY:
+        case MEDIUM:
+        case HARD:
+            game_set_difficulty(game, (Game_difficulty) event->difficulty);
+            break;
+        default:
+            break;
+    }
+
+    game_set_seed(game, event->seed);
+    game_start(game);
+}
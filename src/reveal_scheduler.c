@@ -0,0 +1,262 @@
+#include <gtk/gtk.h>
+#include "reveal_scheduler.h"
+
+// Same as the default transition of GtkRevealer.
+#define REVEAL_DURATION (250 * G_TIME_SPAN_MILLISECOND)
+// Upper bound for the names that fade in the same frame, the rest wait.
+#define REVEAL_MAX_ACTIVE 48
+
+// Fades the names of the map points in and out from a single tick
+// callback, instead of a revealer transition for every map point.
+//
+// A toggle is pending until its start time (later for the map points
+// further east when it is staggered) and then active until its fade is
+// finished. All of the active fades are advanced with the same frame
+// time and at most REVEAL_MAX_ACTIVE of them are active at once, so the
+// work of a frame does not grow with the number of map points.
+typedef struct reveal_t {
+    Map_point *map_point;
+    gboolean reveal;
+    gint64 start_time;
+    gdouble start_opacity;
+    gboolean active;
+} Reveal;
+
+struct reveal_scheduler_t {
+    GtkWidget *widget;
+    guint tick_id;
+    gint64 stagger;
+    gint map_width;
+    // Map_point -> Reveal, every map point has at most one.
+    GHashTable *reveals;
+    // Sorted by the start time on the next tick when pending_sorted is FALSE.
+    GPtrArray *pending;
+    guint pending_head;
+    gboolean pending_sorted;
+    GPtrArray *active;
+};
+
+static void reveal_scheduler_schedule(Reveal_scheduler *scheduler);
+static gboolean reveal_scheduler_on_tick(G_GNUC_UNUSED GtkWidget *widget,
+                                         GdkFrameClock *frame_clock,
+                                         gpointer user_data
+);
+static void reveal_scheduler_start(Reveal_scheduler *scheduler, Reveal *reveal,
+                                   gint64 frame_time
+);
+static gboolean reveal_advance(Reveal *reveal, gint64 frame_time);
+static gint reveal_compare_start_time(gconstpointer a, gconstpointer b);
+static void reveal_free(gpointer user_data);
+
+Reveal_scheduler *reveal_scheduler_create(GtkWidget *widget) {
+    g_return_val_if_fail(GTK_IS_WIDGET(widget), NULL);
+
+    Reveal_scheduler *scheduler;
+
+    scheduler = g_slice_new0(Reveal_scheduler);
+    scheduler->widget = g_object_ref(widget);
+    scheduler->reveals = g_hash_table_new_full(
+        g_direct_hash, g_direct_equal,
+        NULL, reveal_free
+    );
+    scheduler->pending = g_ptr_array_new();
+    scheduler->pending_sorted = TRUE;
+    scheduler->active = g_ptr_array_new();
+
+    return scheduler;
+}
+
+void reveal_scheduler_destroy(Reveal_scheduler *scheduler) {
+    g_return_if_fail(scheduler != NULL);
+
+    if (scheduler->tick_id > 0) {
+        gtk_widget_remove_tick_callback(scheduler->widget, scheduler->tick_id);
+    }
+
+    g_ptr_array_free(scheduler->active, TRUE);
+    g_ptr_array_free(scheduler->pending, TRUE);
+    g_hash_table_destroy(scheduler->reveals);
+    g_object_unref(scheduler->widget);
+    g_slice_free(Reveal_scheduler, scheduler);
+}
+
+void reveal_scheduler_set_stagger(Reveal_scheduler *scheduler, gint64 stagger,
+                                  gint map_width
+) {
+    g_return_if_fail(scheduler != NULL);
+
+    scheduler->stagger = MAX(stagger, 0);
+    scheduler->map_width = map_width;
+}
+
+void reveal_scheduler_toggle(Reveal_scheduler *scheduler, Map_point *map_point,
+                             gboolean reveal, gboolean staggered
+) {
+    g_return_if_fail(scheduler != NULL);
+    g_return_if_fail(map_point != NULL);
+
+    gint x;
+    Reveal *pending_reveal;
+
+    pending_reveal = (Reveal *) g_hash_table_lookup(scheduler->reveals, map_point);
+
+    // Turned around from where it is, without restarting the fade.
+    if (pending_reveal != NULL) {
+        if (pending_reveal->active && pending_reveal->reveal != reveal) {
+            pending_reveal->start_opacity = map_point_get_name_opacity(map_point);
+            pending_reveal->start_time = g_get_monotonic_time();
+        }
+
+        pending_reveal->reveal = reveal;
+        return;
+    }
+
+    if (reveal ? map_point_has_name(map_point) && map_point_get_name_opacity(map_point) == 1.0
+               : !map_point_has_name(map_point)) {
+        return;
+    }
+
+    pending_reveal = g_slice_new0(Reveal);
+    pending_reveal->map_point = map_point;
+    pending_reveal->reveal = reveal;
+    pending_reveal->start_time = g_get_monotonic_time();
+
+    // A sweep from west to east across the map.
+    if (staggered && scheduler->stagger > 0 && scheduler->map_width > 0) {
+        map_point_get_position(map_point, &x, NULL);
+        pending_reveal->start_time += scheduler->stagger * CLAMP(x, 0, scheduler->map_width) /
+                                      scheduler->map_width;
+    }
+
+    g_hash_table_insert(scheduler->reveals, map_point, pending_reveal);
+    g_ptr_array_add(scheduler->pending, pending_reveal);
+    scheduler->pending_sorted = FALSE;
+
+    reveal_scheduler_schedule(scheduler);
+}
+
+static void reveal_scheduler_schedule(Reveal_scheduler *scheduler) {
+    if (scheduler->tick_id > 0) {
+        return;
+    }
+
+    scheduler->tick_id = gtk_widget_add_tick_callback(
+        scheduler->widget,
+        reveal_scheduler_on_tick,
+        scheduler,
+        NULL
+    );
+}
+
+static gboolean reveal_scheduler_on_tick(G_GNUC_UNUSED GtkWidget *widget,
+                                         GdkFrameClock *frame_clock,
+                                         gpointer user_data
+) {
+    Reveal_scheduler *scheduler = (Reveal_scheduler *) user_data;
+
+    guint i;
+    Reveal *reveal;
+    gint64 frame_time;
+
+    frame_time = gdk_frame_clock_get_frame_time(frame_clock);
+
+    for (i = 0; i < scheduler->active->len;) {
+        reveal = (Reveal *) g_ptr_array_index(scheduler->active, i);
+
+        if (reveal_advance(reveal, frame_time)) {
+            g_ptr_array_remove_index_fast(scheduler->active, i);
+            g_hash_table_remove(scheduler->reveals, reveal->map_point);
+        } else {
+            i++;
+        }
+    }
+
+    if (!scheduler->pending_sorted) {
+        g_ptr_array_remove_range(scheduler->pending, 0, scheduler->pending_head);
+        g_ptr_array_sort(scheduler->pending, reveal_compare_start_time);
+        scheduler->pending_head = 0;
+        scheduler->pending_sorted = TRUE;
+    }
+
+    while (scheduler->pending_head < scheduler->pending->len &&
+           scheduler->active->len < REVEAL_MAX_ACTIVE) {
+        reveal = (Reveal *) g_ptr_array_index(scheduler->pending, scheduler->pending_head);
+        if (reveal->start_time > frame_time) {
+            break;
+        }
+
+        scheduler->pending_head++;
+        reveal_scheduler_start(scheduler, reveal, frame_time);
+    }
+
+    if (scheduler->pending_head == scheduler->pending->len) {
+        g_ptr_array_set_size(scheduler->pending, 0);
+        scheduler->pending_head = 0;
+    }
+
+    if (g_hash_table_size(scheduler->reveals) == 0) {
+        scheduler->tick_id = 0;
+        return G_SOURCE_REMOVE;
+    }
+
+    return G_SOURCE_CONTINUE;
+}
+
+static void reveal_scheduler_start(Reveal_scheduler *scheduler, Reveal *reveal,
+                                   gint64 frame_time
+) {
+    // A map point that waited for a free slot fades from the frame it
+    // gets one, not from its start time.
+    reveal->active = TRUE;
+    reveal->start_time = frame_time;
+
+    if (reveal->reveal && !map_point_has_name(reveal->map_point)) {
+        map_point_set_name_opacity(reveal->map_point, 0.0);
+        map_point_toggle_name(reveal->map_point, TRUE);
+    }
+    reveal->start_opacity = map_point_get_name_opacity(reveal->map_point);
+
+    if (reveal_advance(reveal, frame_time)) {
+        g_hash_table_remove(scheduler->reveals, reveal->map_point);
+    } else {
+        g_ptr_array_add(scheduler->active, reveal);
+    }
+}
+
+static gboolean reveal_advance(Reveal *reveal, gint64 frame_time) {
+    gdouble opacity;
+    gdouble progress;
+
+    progress = (gdouble) (frame_time - reveal->start_time) / REVEAL_DURATION;
+
+    if (reveal->reveal) {
+        opacity = MIN(reveal->start_opacity + progress, 1.0);
+    } else {
+        opacity = MAX(reveal->start_opacity - progress, 0.0);
+    }
+
+    map_point_set_name_opacity(reveal->map_point, opacity);
+
+    if (opacity != (reveal->reveal ? 1.0 : 0.0)) {
+        return FALSE;
+    }
+
+    if (!reveal->reveal) {
+        map_point_toggle_name(reveal->map_point, FALSE);
+    }
+
+    return TRUE;
+}
+
+static gint reveal_compare_start_time(gconstpointer a, gconstpointer b) {
+    gint64 start_time_a, start_time_b;
+
+    start_time_a = (*(Reveal **) a)->start_time;
+    start_time_b = (*(Reveal **) b)->start_time;
+
+    return (start_time_a > start_time_b) - (start_time_a < start_time_b);
+}
+
+static void reveal_free(gpointer user_data) {
+    g_slice_free(Reveal, user_data);
+}
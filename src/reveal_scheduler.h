@@ -0,0 +1,18 @@
+#ifndef REVEAL_SCHEDULER_H
+#define REVEAL_SCHEDULER_H
+
+#include <gtk/gtk.h>
+#include "map_point.h"
+
+typedef struct reveal_scheduler_t Reveal_scheduler;
+
+Reveal_scheduler *reveal_scheduler_create(GtkWidget *widget);
+void reveal_scheduler_destroy(Reveal_scheduler *scheduler);
+void reveal_scheduler_set_stagger(Reveal_scheduler *scheduler, gint64 stagger,
+                                  gint map_width
+);
+void reveal_scheduler_toggle(Reveal_scheduler *scheduler, Map_point *map_point,
+                             gboolean reveal, gboolean staggered
+);
+
+#endif
@@ -0,0 +1,319 @@
+#include <stdlib.h>
+#include <math.h>
+#include <glib.h>
+#include "city.h"
+#include "game_data.h"
+#include "game_logic.h"
+
+// Runs the data paths of the game against datasets of different sizes
+// (see dataset-generator) and reports how each of them scales:
+//
+//   load      game_data_create_from_file
+//   lookup    game_data_get_city, half of the names do not exist
+//   start     game_start/game_stop, picks the questions of a hard game
+//   complete  one keystroke of the entry completion, every city is matched
+//             against the key like GtkEntryCompletion does
+//   check     game_check_user_answer, correct and incorrect answers
+//
+// The last table contains the scaling exponents between consecutive
+// datasets, 0 means constant and 1 linear time.
+
+#define LOAD_RUNS 3
+#define LOOKUP_COUNT 200000
+#define START_COUNT 2000
+#define COMPLETION_KEY_COUNT 64
+#define CHECK_COUNT 200000
+
+typedef enum scale_path_t {
+    PATH_LOAD,
+    PATH_LOOKUP,
+    PATH_START,
+    PATH_COMPLETE,
+    PATH_CHECK,
+    PATH_COUNT
+} Scale_path;
+
+typedef struct scale_result_t {
+    const gchar *path;
+    guint city_count;
+    // Microseconds per operation.
+    gdouble times[PATH_COUNT];
+} Scale_result;
+
+static const gchar *path_names[PATH_COUNT] = {
+    "load ms", "lookup ns", "start us", "complete ms", "check ns"
+};
+// Scales the microseconds to the units in path_names.
+static const gdouble path_scales[PATH_COUNT] = {
+    1e-3, 1e3, 1.0, 1e-3, 1e3
+};
+
+static gboolean run_dataset(const gchar *path, Scale_result *result);
+static gdouble benchmark_load(const gchar *path);
+static gdouble benchmark_lookup(Game_data *data, GPtrArray *names, GRand *random_generator);
+static gdouble benchmark_start(Game *game);
+static gdouble benchmark_complete(GList *cities, GPtrArray *names, GRand *random_generator);
+static gdouble benchmark_check(Game *game);
+static void print_results(Scale_result *results, gint count);
+
+int main(int argc, char *argv[]) {
+    gint i, count;
+    Scale_result *results;
+
+    if (argc < 2) {
+        g_printerr("Usage: %s DATASET...\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    // Every load is measured the same way, without a rebuild running.
+    game_data_set_index_cache_rebuild(FALSE);
+
+    results = g_new0(Scale_result, argc - 1);
+
+    count = 0;
+    for (i = 1; i < argc; i++) {
+        if (run_dataset(argv[i], &results[count])) {
+            count++;
+        }
+    }
+
+    print_results(results, count);
+
+    g_free(results);
+
+    exit(count == argc - 1 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+static gboolean run_dataset(const gchar *path, Scale_result *result) {
+    GList *i;
+    GList *cities;
+    Game *game;
+    GRand *random_generator;
+    GPtrArray *names;
+    Game_data *data;
+    GError *error = NULL;
+
+    data = game_data_create_from_file(path, &error);
+    if (data == NULL) {
+        g_printerr("%s: %s\n", path, error->message);
+
+        g_error_free(error);
+        return FALSE;
+    }
+
+    cities = game_data_get_cities(data);
+    if (cities == NULL) {
+        g_printerr("%s: no cities!\n", path);
+
+        game_data_destroy(data);
+        return FALSE;
+    }
+
+    // The same keys and names for every dataset.
+    random_generator = g_rand_new_with_seed(1);
+    names = g_ptr_array_new();
+    for (i = cities; i != NULL; i = i->next) {
+        g_ptr_array_add(names, city_get_name((City *) i->data));
+    }
+
+    game = game_create(cities);
+    game_set_mode(game, TYPING);
+    game_set_difficulty(game, HARD);
+
+    result->path = path;
+    result->city_count = names->len;
+    result->times[PATH_LOAD] = benchmark_load(path);
+    result->times[PATH_LOOKUP] = benchmark_lookup(data, names, random_generator);
+    result->times[PATH_START] = benchmark_start(game);
+    result->times[PATH_COMPLETE] = benchmark_complete(cities, names, random_generator);
+    result->times[PATH_CHECK] = benchmark_check(game);
+
+    game_destroy(game);
+    g_ptr_array_free(names, TRUE);
+    g_rand_free(random_generator);
+    g_list_free(cities);
+    game_data_destroy(data);
+
+    return TRUE;
+}
+
+static gdouble benchmark_load(const gchar *path) {
+    gint i;
+    gint64 start, time, best;
+    Game_data *data;
+
+    best = G_MAXINT64;
+    for (i = 0; i < LOAD_RUNS; i++) {
+        start = g_get_monotonic_time();
+        data = game_data_create_from_file(path, NULL);
+        time = g_get_monotonic_time() - start;
+
+        if (data != NULL) {
+            game_data_destroy(data);
+        }
+
+        best = MIN(best, time);
+    }
+
+    return (gdouble) best;
+}
+
+static gdouble benchmark_lookup(Game_data *data, GPtrArray *names, GRand *random_generator) {
+    guint i;
+    guint found;
+    gint64 start;
+    gchar **keys;
+
+    // The missing names differ from the existing ones only in the last
+    // byte, the worst case for comparing the keys.
+    keys = g_new(gchar *, LOOKUP_COUNT);
+    for (i = 0; i < LOOKUP_COUNT; i++) {
+        keys[i] = g_strdup_printf(
+            i % 2 == 0 ? "%s" : "%s_",
+            (gchar *) g_ptr_array_index(
+                names, g_rand_int_range(random_generator, 0, (gint32) names->len)
+            )
+        );
+    }
+
+    found = 0;
+    start = g_get_monotonic_time();
+    for (i = 0; i < LOOKUP_COUNT; i++) {
+        if (game_data_get_city(data, keys[i]) != NULL) {
+            found++;
+        }
+    }
+    start = g_get_monotonic_time() - start;
+
+    g_assert(found >= LOOKUP_COUNT / 2);
+
+    for (i = 0; i < LOOKUP_COUNT; i++) {
+        g_free(keys[i]);
+    }
+    g_free(keys);
+
+    return (gdouble) start / LOOKUP_COUNT;
+}
+
+static gdouble benchmark_start(Game *game) {
+    guint i;
+    gint64 start;
+
+    start = g_get_monotonic_time();
+    for (i = 0; i < START_COUNT; i++) {
+        game_start(game);
+        game_stop(game);
+    }
+
+    return (gdouble) (g_get_monotonic_time() - start) / START_COUNT;
+}
+
+static gdouble benchmark_complete(GList *cities, GPtrArray *names, GRand *random_generator) {
+    guint i;
+    guint matches;
+    gint64 start;
+    gchar *keys[COMPLETION_KEY_COUNT];
+    const gchar *name;
+    GList *j;
+
+    // One, two and three characters typed, like while the user is typing.
+    for (i = 0; i < COMPLETION_KEY_COUNT; i++) {
+        name = g_ptr_array_index(
+            names, g_rand_int_range(random_generator, 0, (gint32) names->len)
+        );
+
+        keys[i] = g_utf8_substring(name, 0, MIN(1 + i % 3, g_utf8_strlen(name, -1)));
+    }
+
+    matches = 0;
+    start = g_get_monotonic_time();
+    for (i = 0; i < COMPLETION_KEY_COUNT; i++) {
+        for (j = cities; j != NULL; j = j->next) {
+            if (city_matches_search((City *) j->data, keys[i])) {
+                matches++;
+            }
+        }
+    }
+    start = g_get_monotonic_time() - start;
+
+    g_assert(matches >= COMPLETION_KEY_COUNT);
+
+    for (i = 0; i < COMPLETION_KEY_COUNT; i++) {
+        g_free(keys[i]);
+    }
+
+    return (gdouble) start / COMPLETION_KEY_COUNT;
+}
+
+static gdouble benchmark_check(Game *game) {
+    guint i;
+    gint64 start;
+    gchar *correct_answer, *incorrect_answer;
+
+    game_start(game);
+
+    // Answers with different case, the comparison is caseless.
+    correct_answer = g_utf8_strup(city_get_name(game_get_current_city(game)), -1);
+    incorrect_answer = g_strconcat(correct_answer, "a", NULL);
+
+    start = g_get_monotonic_time();
+    for (i = 0; i < CHECK_COUNT; i++) {
+        game_check_user_answer(game, i % 2 == 0 ? correct_answer : incorrect_answer);
+    }
+    start = g_get_monotonic_time() - start;
+
+    g_assert(game_get_correct_answer_count(game) == CHECK_COUNT / 2);
+
+    game_stop(game);
+    g_free(incorrect_answer);
+    g_free(correct_answer);
+
+    return (gdouble) start / CHECK_COUNT;
+}
+
+static void print_results(Scale_result *results, gint count) {
+    gint i, path;
+
+    g_print("%10s", "cities");
+    for (path = 0; path < PATH_COUNT; path++) {
+        g_print(" %12s", path_names[path]);
+    }
+    g_print("  dataset\n");
+
+    for (i = 0; i < count; i++) {
+        g_print("%10u", results[i].city_count);
+        for (path = 0; path < PATH_COUNT; path++) {
+            g_print(" %12.3f", results[i].times[path] * path_scales[path]);
+        }
+        g_print("  %s\n", results[i].path);
+    }
+
+    if (count < 2) {
+        return;
+    }
+
+    g_print("\nscaling exponents (time ~ cities^k)\n%21s", "cities");
+    for (path = 0; path < PATH_COUNT; path++) {
+        g_print(" %12s", path_names[path]);
+    }
+    g_print("\n");
+
+    for (i = 1; i < count; i++) {
+        g_print("%10u -> %7u", results[i - 1].city_count, results[i].city_count);
+
+        for (path = 0; path < PATH_COUNT; path++) {
+            if (results[i].city_count == results[i - 1].city_count ||
+                results[i].times[path] <= 0 || results[i - 1].times[path] <= 0) {
+                g_print(" %12s", "-");
+                continue;
+            }
+
+            g_print(
+                " %12.2f",
+                log(results[i].times[path] / results[i - 1].times[path]) /
+                log((gdouble) results[i].city_count / results[i - 1].city_count)
+            );
+        }
+        g_print("\n");
+    }
+}
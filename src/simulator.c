@@ -0,0 +1,567 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <glib.h>
+#include <json-glib/json-glib.h>
+#include "city.h"
+#include "game_data.h"
+#include "game_logic.h"
+#include "work_stealing.h"
+
+// Plays large numbers of games with simulated players (bots) against
+// game_logic.c and estimates how hard every city is, so the difficulty
+// tiers can be calibrated for a dataset.
+//
+// Each bot has a skill theta drawn from a normal distribution. A bot knows
+// a city with the probability of the two-parameter logistic model of item
+// response theory, 1 / (1 + exp(-DISCRIMINATION * (theta - b))), where b is
+// the true difficulty of the city given by the skill model:
+//
+//   prominence  the better known cities (with longer descriptions) are
+//               easier, b goes from -2 for the best known to 2
+//   uniform     b is 0 for every city
+//
+// In the selection mode a bot that does not know the city clicks a random
+// one. In the typing mode some bots never type the diacritics (č, ć, đ, š,
+// ž), which is an incorrect answer for the names that contain them.
+//
+// The games are split into chunks run by a work-stealing pool. The random
+// generator is seeded per chunk, so the results only depend on --seed and
+// not on the number of threads or the scheduling.
+
+#define CHUNK_SIZE 256
+#define DISCRIMINATION 1.7
+// Expected share of correct answers the tiers are calibrated for.
+#define EASY_TARGET 0.8
+#define MEDIUM_TARGET 0.6
+
+typedef struct sim_city_t {
+    City *city;
+    gchar *ascii_name;
+    gdouble difficulty;
+} Sim_city;
+
+typedef struct sim_city_stats_t {
+    guint64 attempts;
+    guint64 correct;
+} Sim_city_stats;
+
+typedef struct sim_worker_t {
+    Game *game;
+    GRand *random_generator;
+    Sim_city_stats *city_stats;
+    // Indexed by the tier (EASY, MEDIUM, HARD).
+    guint64 tier_games[3];
+    guint64 tier_correct[3];
+    guint64 tier_questions[3];
+} Sim_worker;
+
+typedef struct simulator_t {
+    Game_mode mode;
+    gdouble skill_mean;
+    gdouble skill_sd;
+    gdouble no_diacritics_rate;
+    guint32 seed;
+
+    GList *cities;
+    Sim_city *sim_cities;
+    guint city_count;
+    GHashTable *city_indices;
+
+    Sim_worker *workers;
+} Simulator;
+
+typedef struct sim_city_estimate_t {
+    Sim_city *sim_city;
+    gdouble correct_rate;
+    gdouble difficulty;
+    guint64 attempts;
+} Sim_city_estimate;
+
+static const Game_difficulty tiers[] = {EASY, MEDIUM, HARD};
+static const gchar *tier_names[] = {"easy", "medium", "hard"};
+
+static gint64 game_count = 100000;
+static gint thread_count = 0;
+static gchar *mode_name = NULL;
+static gchar *model_name = NULL;
+static gdouble skill_mean = 0.0;
+static gdouble skill_sd = 1.0;
+static gdouble no_diacritics_rate = 0.3;
+static gint64 seed = 1;
+static gchar *data_path = NULL;
+static gchar *output_path = NULL;
+
+static GOptionEntry option_entries[] = {
+    {"games", 'n', 0, G_OPTION_ARG_INT64, &game_count, "Number of simulated games", "N"},
+    {"threads", 'j', 0, G_OPTION_ARG_INT, &thread_count, "Number of threads (0 for all cores)", "N"},
+    {"mode", 'm', 0, G_OPTION_ARG_STRING, &mode_name, "Game mode: selection or typing", "MODE"},
+    {"model", 0, 0, G_OPTION_ARG_STRING, &model_name, "Skill model: prominence or uniform", "MODEL"},
+    {"skill-mean", 0, 0, G_OPTION_ARG_DOUBLE, &skill_mean, "Mean skill of the bots", "THETA"},
+    {"skill-sd", 0, 0, G_OPTION_ARG_DOUBLE, &skill_sd, "Standard deviation of the skill", "SD"},
+    {
+        "no-diacritics", 0, 0, G_OPTION_ARG_DOUBLE, &no_diacritics_rate,
+        "Share of the bots that never type diacritics", "RATE"
+    },
+    {"seed", 's', 0, G_OPTION_ARG_INT64, &seed, "Seed of the random generators", "SEED"},
+    {"data", 'd', 0, G_OPTION_ARG_FILENAME, &data_path, "Dataset instead of the built-in cities", "FILE"},
+    {"output", 'o', 0, G_OPTION_ARG_FILENAME, &output_path, "Write the estimates as JSON to FILE", "FILE"},
+    {NULL, 0, 0, G_OPTION_ARG_NONE, NULL, NULL, NULL}
+};
+
+static void simulator_init_cities(Simulator *simulator, gboolean prominence);
+static void simulator_play_chunk(guint64 first, guint64 last, guint worker, gpointer user_data);
+static void simulator_play_game(Simulator *simulator, Sim_worker *worker, guint tier);
+static const gchar *simulator_bot_answer(Simulator *simulator, Sim_worker *worker,
+                                         Sim_city *sim_city, gdouble skill,
+                                         gboolean types_diacritics
+);
+static gdouble random_normal(GRand *random_generator, gdouble mean, gdouble sd);
+static gint compare_sim_city_descriptions(gconstpointer a, gconstpointer b);
+static gint compare_estimates(gconstpointer a, gconstpointer b);
+static guint recommend_pool_size(Sim_city_estimate *estimates, guint count,
+                                 guint question_count, gdouble target
+);
+static void print_report(Simulator *simulator, Sim_city_estimate *estimates,
+                         guint *pool_sizes, gdouble elapsed
+);
+static gboolean write_report(const gchar *path, Simulator *simulator,
+                             Sim_city_estimate *estimates, guint *pool_sizes
+);
+
+int main(int argc, char *argv[]) {
+    guint i, j, t;
+    gint64 start;
+    gdouble rate;
+    gboolean written;
+    guint pool_sizes[G_N_ELEMENTS(tiers)];
+    Simulator simulator = {0};
+    Sim_worker *worker;
+    Sim_city_stats *stats;
+    Sim_city_estimate *estimates;
+    Game_data *data;
+    Work_stealing *pool;
+    GOptionContext *option_context;
+    GError *error = NULL;
+
+    option_context = g_option_context_new(NULL);
+    g_option_context_set_summary(
+        option_context,
+        "Estimates the difficulty of the cities with simulated games."
+    );
+    g_option_context_add_main_entries(option_context, option_entries, NULL);
+
+    if (!g_option_context_parse(option_context, &argc, &argv, &error)) {
+        g_printerr("%s\n", error->message);
+
+        g_error_free(error);
+        g_option_context_free(option_context);
+        exit(EXIT_FAILURE);
+    }
+
+    g_option_context_free(option_context);
+
+    if (game_count <= 0 || thread_count < 0 || skill_sd < 0 ||
+        no_diacritics_rate < 0 || no_diacritics_rate > 1) {
+        g_printerr("Invalid options!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (mode_name == NULL || g_strcmp0(mode_name, "selection") == 0) {
+        simulator.mode = SELECTION;
+    } else if (g_strcmp0(mode_name, "typing") == 0) {
+        simulator.mode = TYPING;
+    } else {
+        g_printerr("Unknown mode %s!\n", mode_name);
+        exit(EXIT_FAILURE);
+    }
+
+    if (model_name != NULL &&
+        g_strcmp0(model_name, "prominence") != 0 &&
+        g_strcmp0(model_name, "uniform") != 0) {
+        g_printerr("Unknown skill model %s!\n", model_name);
+        exit(EXIT_FAILURE);
+    }
+
+    game_data_set_index_cache_rebuild(FALSE);
+
+    if (data_path != NULL) {
+        data = game_data_create_from_file(data_path, &error);
+    } else {
+        data = game_data_create();
+    }
+
+    if (data == NULL) {
+        if (error != NULL) {
+            g_printerr("%s\n", error->message);
+            g_error_free(error);
+        }
+        exit(EXIT_FAILURE);
+    }
+
+    simulator.skill_mean = skill_mean;
+    simulator.skill_sd = skill_sd;
+    simulator.no_diacritics_rate = no_diacritics_rate;
+    simulator.seed = (guint32) seed;
+    simulator.cities = game_data_get_cities(data);
+    simulator_init_cities(&simulator, g_strcmp0(model_name, "uniform") != 0);
+
+    pool = work_stealing_create((guint) thread_count);
+    simulator.workers = g_new0(Sim_worker, work_stealing_get_worker_count(pool));
+
+    for (i = 0; i < work_stealing_get_worker_count(pool); i++) {
+        worker = &simulator.workers[i];
+        worker->game = game_create(simulator.cities);
+        worker->random_generator = g_rand_new();
+        worker->city_stats = g_new0(Sim_city_stats, simulator.city_count);
+
+        game_set_mode(worker->game, simulator.mode);
+        game_set_random_generator(worker->game, worker->random_generator);
+    }
+
+    start = g_get_monotonic_time();
+    work_stealing_run(pool, (guint64) game_count, CHUNK_SIZE, simulator_play_chunk, &simulator);
+
+    // Merges the statistics of the workers into the first one.
+    for (i = 1; i < work_stealing_get_worker_count(pool); i++) {
+        worker = &simulator.workers[i];
+
+        for (j = 0; j < simulator.city_count; j++) {
+            simulator.workers[0].city_stats[j].attempts += worker->city_stats[j].attempts;
+            simulator.workers[0].city_stats[j].correct += worker->city_stats[j].correct;
+        }
+
+        for (t = 0; t < G_N_ELEMENTS(tiers); t++) {
+            simulator.workers[0].tier_games[t] += worker->tier_games[t];
+            simulator.workers[0].tier_correct[t] += worker->tier_correct[t];
+            simulator.workers[0].tier_questions[t] += worker->tier_questions[t];
+        }
+    }
+
+    estimates = g_new(Sim_city_estimate, simulator.city_count);
+    for (i = 0; i < simulator.city_count; i++) {
+        stats = &simulator.workers[0].city_stats[i];
+        // Smoothed, so the cities that were always (or never) answered
+        // correctly still get a finite estimate.
+        rate = (stats->correct + 0.5) / (stats->attempts + 1.0);
+
+        estimates[i].sim_city = &simulator.sim_cities[i];
+        estimates[i].attempts = stats->attempts;
+        estimates[i].correct_rate = (gdouble) stats->correct / MAX(stats->attempts, 1);
+        estimates[i].difficulty = -log(rate / (1.0 - rate)) / DISCRIMINATION;
+    }
+
+    qsort(estimates, simulator.city_count, sizeof(Sim_city_estimate), compare_estimates);
+
+    pool_sizes[0] = recommend_pool_size(estimates, simulator.city_count, EASY, EASY_TARGET);
+    pool_sizes[1] = recommend_pool_size(estimates, simulator.city_count, MEDIUM, MEDIUM_TARGET);
+    pool_sizes[2] = simulator.city_count;
+
+    print_report(
+        &simulator, estimates, pool_sizes,
+        (g_get_monotonic_time() - start) / (gdouble) G_USEC_PER_SEC
+    );
+
+    written = TRUE;
+    if (output_path != NULL) {
+        written = write_report(output_path, &simulator, estimates, pool_sizes);
+    }
+
+    for (i = 0; i < work_stealing_get_worker_count(pool); i++) {
+        worker = &simulator.workers[i];
+
+        game_destroy(worker->game);
+        g_rand_free(worker->random_generator);
+        g_free(worker->city_stats);
+    }
+
+    for (i = 0; i < simulator.city_count; i++) {
+        g_free(simulator.sim_cities[i].ascii_name);
+    }
+
+    g_free(estimates);
+    g_free(simulator.workers);
+    g_free(simulator.sim_cities);
+    g_hash_table_destroy(simulator.city_indices);
+    work_stealing_destroy(pool);
+    g_list_free(simulator.cities);
+    game_data_destroy(data);
+
+    exit(written ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+static void simulator_init_cities(Simulator *simulator, gboolean prominence) {
+    guint i;
+    GList *city;
+    Sim_city *sim_cities;
+
+    simulator->city_count = g_list_length(simulator->cities);
+    simulator->sim_cities = sim_cities = g_new0(Sim_city, simulator->city_count);
+
+    for (i = 0, city = simulator->cities; city != NULL; i++, city = city->next) {
+        sim_cities[i].city = (City *) city->data;
+        sim_cities[i].ascii_name = g_str_to_ascii(city_get_name(sim_cities[i].city), "C");
+    }
+
+    // The best known cities first.
+    qsort(sim_cities, simulator->city_count, sizeof(Sim_city), compare_sim_city_descriptions);
+
+    simulator->city_indices = g_hash_table_new(g_direct_hash, g_direct_equal);
+    for (i = 0; i < simulator->city_count; i++) {
+        if (prominence && simulator->city_count > 1) {
+            sim_cities[i].difficulty = -2.0 + 4.0 * i / (simulator->city_count - 1);
+        } else {
+            sim_cities[i].difficulty = 0.0;
+        }
+
+        g_hash_table_insert(
+            simulator->city_indices,
+            sim_cities[i].city,
+            GUINT_TO_POINTER(i)
+        );
+    }
+}
+
+static void simulator_play_chunk(guint64 first, guint64 last, guint worker, gpointer user_data) {
+    guint64 i;
+    guint32 seed[3];
+    Simulator *simulator = (Simulator *) user_data;
+
+    seed[0] = simulator->seed;
+    seed[1] = (guint32) (first / CHUNK_SIZE);
+    seed[2] = (guint32) ((first / CHUNK_SIZE) >> 32);
+    g_rand_set_seed_array(simulator->workers[worker].random_generator, seed, 3);
+
+    for (i = first; i < last; i++) {
+        simulator_play_game(simulator, &simulator->workers[worker], i % G_N_ELEMENTS(tiers));
+    }
+}
+
+static void simulator_play_game(Simulator *simulator, Sim_worker *worker, guint tier) {
+    guint index;
+    gdouble skill;
+    gboolean correct;
+    gboolean types_diacritics;
+    City *city;
+    Sim_city *sim_city;
+
+    skill = random_normal(worker->random_generator, simulator->skill_mean, simulator->skill_sd);
+    types_diacritics = g_rand_double(worker->random_generator) >= simulator->no_diacritics_rate;
+
+    game_set_difficulty(worker->game, tiers[tier]);
+    game_start(worker->game);
+
+    worker->tier_games[tier]++;
+    worker->tier_questions[tier] += game_get_remaining_questions_count(worker->game);
+
+    do {
+        city = game_get_current_city(worker->game);
+        index = GPOINTER_TO_UINT(g_hash_table_lookup(simulator->city_indices, city));
+        sim_city = &simulator->sim_cities[index];
+
+        correct = game_check_user_answer(
+            worker->game,
+            simulator_bot_answer(simulator, worker, sim_city, skill, types_diacritics)
+        );
+
+        worker->city_stats[index].attempts++;
+        if (correct) {
+            worker->city_stats[index].correct++;
+            worker->tier_correct[tier]++;
+        }
+    } while (game_next_question(worker->game));
+
+    game_stop(worker->game);
+}
+
+static const gchar *simulator_bot_answer(Simulator *simulator, Sim_worker *worker,
+                                         Sim_city *sim_city, gdouble skill,
+                                         gboolean types_diacritics
+) {
+    gdouble know_probability;
+
+    know_probability = 1.0 / (1.0 + exp(-DISCRIMINATION * (skill - sim_city->difficulty)));
+
+    if (g_rand_double(worker->random_generator) < know_probability) {
+        if (simulator->mode == TYPING && !types_diacritics) {
+            return sim_city->ascii_name;
+        }
+
+        return city_get_name(sim_city->city);
+    }
+
+    if (simulator->mode == TYPING) {
+        return "";
+    }
+
+    // A guess, it can still be correct.
+    return city_get_name(
+        simulator->sim_cities[g_rand_int_range(
+            worker->random_generator, 0, (gint32) simulator->city_count
+        )].city
+    );
+}
+
+static gdouble random_normal(GRand *random_generator, gdouble mean, gdouble sd) {
+    gdouble u, v;
+
+    // Box-Muller transform, u is never 0.
+    u = 1.0 - g_rand_double(random_generator);
+    v = g_rand_double(random_generator);
+
+    return mean + sd * sqrt(-2.0 * log(u)) * cos(2.0 * G_PI * v);
+}
+
+static gint compare_sim_city_descriptions(gconstpointer a, gconstpointer b) {
+    gsize length_a, length_b;
+
+    length_a = strlen(city_get_description(((const Sim_city *) a)->city));
+    length_b = strlen(city_get_description(((const Sim_city *) b)->city));
+
+    if (length_a != length_b) {
+        return length_a > length_b ? -1 : 1;
+    }
+
+    return g_utf8_collate(
+        city_get_name(((const Sim_city *) a)->city),
+        city_get_name(((const Sim_city *) b)->city)
+    );
+}
+
+static gint compare_estimates(gconstpointer a, gconstpointer b) {
+    gdouble difficulty_a, difficulty_b;
+
+    difficulty_a = ((const Sim_city_estimate *) a)->difficulty;
+    difficulty_b = ((const Sim_city_estimate *) b)->difficulty;
+
+    return (difficulty_a > difficulty_b) - (difficulty_a < difficulty_b);
+}
+
+static guint recommend_pool_size(Sim_city_estimate *estimates, guint count,
+                                 guint question_count, gdouble target
+) {
+    guint i;
+    guint size;
+    gdouble rate_sum;
+
+    // The largest set of the easiest cities whose average share of correct
+    // answers still reaches the target, the questions of the tier are
+    // picked from it. Never smaller than the number of questions.
+    size = MIN(question_count, count);
+    rate_sum = 0.0;
+
+    for (i = 0; i < count; i++) {
+        rate_sum += estimates[i].correct_rate;
+
+        if (i + 1 >= size && rate_sum / (i + 1) >= target) {
+            size = i + 1;
+        }
+    }
+
+    return size;
+}
+
+static void print_report(Simulator *simulator, Sim_city_estimate *estimates,
+                         guint *pool_sizes, gdouble elapsed
+) {
+    guint i;
+    guint64 games;
+    Sim_worker *totals = &simulator->workers[0];
+
+    games = totals->tier_games[0] + totals->tier_games[1] + totals->tier_games[2];
+
+    g_print(
+        "%" G_GUINT64_FORMAT " games in %.2f s (%.0f games/s)\n\n",
+        games, elapsed, games / MAX(elapsed, 1e-9)
+    );
+
+    g_print("%-6s %-32s %10s %8s %10s %8s\n", "rank", "city", "attempts", "correct", "difficulty", "model");
+    for (i = 0; i < simulator->city_count; i++) {
+        g_print(
+            "%-6u %-32s %10" G_GUINT64_FORMAT " %7.1f%% %10.2f %8.2f\n",
+            i + 1,
+            city_get_name(estimates[i].sim_city->city),
+            estimates[i].attempts,
+            estimates[i].correct_rate * 100.0,
+            estimates[i].difficulty,
+            estimates[i].sim_city->difficulty
+        );
+    }
+
+    g_print("\n%-8s %10s %10s %16s\n", "tier", "questions", "correct", "recommended pool");
+    for (i = 0; i < G_N_ELEMENTS(tiers); i++) {
+        g_print(
+            "%-8s %10u %9.1f%% %16u\n",
+            tier_names[i],
+            (guint) tiers[i],
+            100.0 * totals->tier_correct[i] / MAX(totals->tier_questions[i], 1),
+            pool_sizes[i]
+        );
+    }
+}
+
+static gboolean write_report(const gchar *path, Simulator *simulator,
+                             Sim_city_estimate *estimates, guint *pool_sizes
+) {
+    guint i, j;
+    gboolean written;
+    JsonNode *root;
+    JsonBuilder *builder;
+    JsonGenerator *generator;
+    GError *error = NULL;
+
+    builder = json_builder_new();
+
+    json_builder_begin_object(builder);
+    json_builder_set_member_name(builder, "cities");
+    json_builder_begin_array(builder);
+    for (i = 0; i < simulator->city_count; i++) {
+        json_builder_begin_object(builder);
+        json_builder_set_member_name(builder, "name");
+        json_builder_add_string_value(builder, city_get_name(estimates[i].sim_city->city));
+        json_builder_set_member_name(builder, "attempts");
+        json_builder_add_int_value(builder, (gint64) estimates[i].attempts);
+        json_builder_set_member_name(builder, "correct_rate");
+        json_builder_add_double_value(builder, estimates[i].correct_rate);
+        json_builder_set_member_name(builder, "difficulty");
+        json_builder_add_double_value(builder, estimates[i].difficulty);
+        json_builder_end_object(builder);
+    }
+    json_builder_end_array(builder);
+
+    // The pools are prefixes of the cities sorted from the easiest.
+    json_builder_set_member_name(builder, "tiers");
+    json_builder_begin_object(builder);
+    for (i = 0; i < G_N_ELEMENTS(tiers); i++) {
+        json_builder_set_member_name(builder, tier_names[i]);
+        json_builder_begin_object(builder);
+        json_builder_set_member_name(builder, "questions");
+        json_builder_add_int_value(builder, tiers[i]);
+        json_builder_set_member_name(builder, "pool");
+        json_builder_begin_array(builder);
+        for (j = 0; j < pool_sizes[i]; j++) {
+            json_builder_add_string_value(builder, city_get_name(estimates[j].sim_city->city));
+        }
+        json_builder_end_array(builder);
+        json_builder_end_object(builder);
+    }
+    json_builder_end_object(builder);
+    json_builder_end_object(builder);
+
+    root = json_builder_get_root(builder);
+    generator = json_generator_new();
+    json_generator_set_pretty(generator, TRUE);
+    json_generator_set_root(generator, root);
+
+    written = json_generator_to_file(generator, path, &error);
+    if (!written) {
+        g_printerr("%s\n", error->message);
+        g_error_free(error);
+    }
+
+    g_object_unref(G_OBJECT(generator));
+    json_node_unref(root);
+    g_object_unref(G_OBJECT(builder));
+
+    return written;
+}
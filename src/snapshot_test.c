@@ -0,0 +1,168 @@
+#include <string.h>
+#include <glib.h>
+#include "city.h"
+#include "game_logic.h"
+
+// Feeds game_restore_snapshot snapshots that are truncated or out of
+// range, none of them may restore a game (see `make check`).
+
+#define SNAPSHOT_TEST_CITY_COUNT 12
+#define SNAPSHOT_TEST_SEED 7
+
+typedef struct snapshot_test_fixture_t {
+    GList *cities;
+    Game *game;
+    guint8 *snapshot;
+    gsize size;
+} Snapshot_test_fixture;
+
+static void snapshot_test_setup(Snapshot_test_fixture *fixture, gconstpointer user_data);
+static void snapshot_test_teardown(Snapshot_test_fixture *fixture, gconstpointer user_data);
+static gboolean snapshot_test_restore(Snapshot_test_fixture *fixture, const guint8 *data, gsize size);
+static void snapshot_test_write_u32(guint8 *buffer, guint32 value);
+static void test_valid(Snapshot_test_fixture *fixture, gconstpointer user_data);
+static void test_truncated(Snapshot_test_fixture *fixture, gconstpointer user_data);
+static void test_out_of_range(Snapshot_test_fixture *fixture, gconstpointer user_data);
+
+int main(int argc, char *argv[]) {
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add(
+        "/snapshot/valid", Snapshot_test_fixture, NULL,
+        snapshot_test_setup, test_valid, snapshot_test_teardown
+    );
+    g_test_add(
+        "/snapshot/truncated", Snapshot_test_fixture, NULL,
+        snapshot_test_setup, test_truncated, snapshot_test_teardown
+    );
+    g_test_add(
+        "/snapshot/out-of-range", Snapshot_test_fixture, NULL,
+        snapshot_test_setup, test_out_of_range, snapshot_test_teardown
+    );
+
+    return g_test_run();
+}
+
+static void snapshot_test_setup(Snapshot_test_fixture *fixture,
+                                G_GNUC_UNUSED gconstpointer user_data
+) {
+    guint i;
+    gchar *name;
+
+    fixture->cities = NULL;
+    for (i = 0; i < SNAPSHOT_TEST_CITY_COUNT; i++) {
+        name = g_strdup_printf("Grad %u", i);
+        fixture->cities = g_list_prepend(fixture->cities, city_create(name, "", NULL));
+        g_free(name);
+    }
+
+    // A game with one answered question.
+    fixture->game = game_create(fixture->cities);
+    game_set_mode(fixture->game, TYPING);
+    game_set_difficulty(fixture->game, EASY);
+    game_set_seed(fixture->game, SNAPSHOT_TEST_SEED);
+    game_start(fixture->game);
+    game_check_user_answer(fixture->game, game_get_current_city_name(fixture->game));
+    game_next_question(fixture->game);
+
+    fixture->size = game_get_snapshot_size(fixture->game);
+    fixture->snapshot = g_malloc(fixture->size);
+    game_write_snapshot(fixture->game, 0, fixture->snapshot);
+    game_stop(fixture->game);
+}
+
+static void snapshot_test_teardown(Snapshot_test_fixture *fixture,
+                                   G_GNUC_UNUSED gconstpointer user_data
+) {
+    g_free(fixture->snapshot);
+    game_destroy(fixture->game);
+    g_list_free_full(fixture->cities, (GDestroyNotify) city_destroy);
+}
+
+static gboolean snapshot_test_restore(Snapshot_test_fixture *fixture, const guint8 *data, gsize size) {
+    gboolean restored;
+    GBytes *bytes;
+    GError *error = NULL;
+
+    bytes = g_bytes_new(data, size);
+    restored = game_restore_snapshot(fixture->game, bytes, NULL, &error);
+    g_bytes_unref(bytes);
+
+    if (restored) {
+        g_assert_no_error(error);
+        g_assert_nonnull(game_get_current_city(fixture->game));
+        game_stop(fixture->game);
+    } else {
+        g_assert_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL);
+        g_assert_false(game_is_running(fixture->game));
+        g_error_free(error);
+    }
+
+    return restored;
+}
+
+static void snapshot_test_write_u32(guint8 *buffer, guint32 value) {
+    buffer[0] = (guint8) value;
+    buffer[1] = (guint8) (value >> 8);
+    buffer[2] = (guint8) (value >> 16);
+    buffer[3] = (guint8) (value >> 24);
+}
+
+static void test_valid(Snapshot_test_fixture *fixture, G_GNUC_UNUSED gconstpointer user_data) {
+    g_assert_true(snapshot_test_restore(fixture, fixture->snapshot, fixture->size));
+}
+
+static void test_truncated(Snapshot_test_fixture *fixture, G_GNUC_UNUSED gconstpointer user_data) {
+    gsize size;
+
+    for (size = 0; size < fixture->size; size++) {
+        g_assert_false(snapshot_test_restore(fixture, fixture->snapshot, size));
+    }
+}
+
+static void test_out_of_range(Snapshot_test_fixture *fixture, G_GNUC_UNUSED gconstpointer user_data) {
+    guint i;
+    guint8 *data;
+    guint32 question_count;
+    // Offset and value of a header field, every one is out of range.
+    static const struct {
+        guint offset;
+        guint32 value;
+    } fields[] = {
+        {20, 0},                // no questions
+        {24, 9},                // question index == question count (EASY)
+        {24, G_MAXUINT32},      // question index past the questions
+        {28, 10},               // more correct answers than questions
+        {28, G_MAXUINT32},      // correct + incorrect overflows
+        {32, G_MAXUINT32},
+    };
+
+    question_count = (guint32) fixture->snapshot[20];
+    g_assert_cmpuint(question_count, ==, EASY);
+
+    data = g_malloc(fixture->size);
+
+    for (i = 0; i < G_N_ELEMENTS(fields); i++) {
+        memcpy(data, fixture->snapshot, fixture->size);
+        snapshot_test_write_u32(data + fields[i].offset, fields[i].value);
+        g_assert_false(snapshot_test_restore(fixture, data, fixture->size));
+    }
+
+    // A mode and a difficulty that do not exist.
+    memcpy(data, fixture->snapshot, fixture->size);
+    data[8] = 7;
+    g_assert_false(snapshot_test_restore(fixture, data, fixture->size));
+
+    memcpy(data, fixture->snapshot, fixture->size);
+    data[9] = 10;
+    g_assert_false(snapshot_test_restore(fixture, data, fixture->size));
+
+    // Every answer byte that is not a Game_answer.
+    for (i = 0; i < question_count; i++) {
+        memcpy(data, fixture->snapshot, fixture->size);
+        data[fixture->size - question_count + i] = GAME_INCORRECT_ANSWER + 1;
+        g_assert_false(snapshot_test_restore(fixture, data, fixture->size));
+    }
+
+    g_free(data);
+}
@@ -0,0 +1,177 @@
+#include <glib.h>
+#include <glib/gstdio.h>
+#include "snapshot_writer.h"
+
+typedef enum snapshot_writer_request_t {
+    SNAPSHOT_WRITER_NONE,
+    SNAPSHOT_WRITER_SAVE,
+    SNAPSHOT_WRITER_DELETE
+} Snapshot_writer_request;
+
+// Writes the snapshots of the running game on its own thread, so that
+// the answer that takes one neither allocates nor waits for the disk.
+//
+// The UI thread writes the snapshot into the pending buffer, which is
+// reserved for the size of the game when it starts. The writer thread
+// swaps it with its own buffer under the mutex and writes the file
+// outside of it. Only the last request counts: a snapshot that was not
+// written yet is replaced by the next one, or dropped by a delete.
+struct snapshot_writer_t {
+    gchar *path;
+
+    guint8 *pending;
+    gsize pending_capacity;
+    gsize pending_size;
+    guint8 *written;
+    gsize written_capacity;
+    // Reserved size, both buffers grow to it before they become pending.
+    gsize capacity;
+
+    Snapshot_writer_request request;
+    gboolean running;
+
+    GThread *thread;
+    GMutex mutex;
+    GCond cond;
+};
+
+static gpointer snapshot_writer_thread(gpointer user_data);
+
+Snapshot_writer *snapshot_writer_create(const gchar *path) {
+    g_return_val_if_fail(path != NULL, NULL);
+
+    Snapshot_writer *writer;
+
+    writer = g_new0(Snapshot_writer, 1);
+    writer->path = g_strdup(path);
+    writer->running = TRUE;
+    g_mutex_init(&writer->mutex);
+    g_cond_init(&writer->cond);
+
+    writer->thread = g_thread_new("snapshot", snapshot_writer_thread, writer);
+
+    return writer;
+}
+
+void snapshot_writer_destroy(Snapshot_writer *writer) {
+    g_return_if_fail(writer != NULL);
+
+    // The last request is still carried out.
+    g_mutex_lock(&writer->mutex);
+    writer->running = FALSE;
+    g_cond_signal(&writer->cond);
+    g_mutex_unlock(&writer->mutex);
+
+    g_thread_join(writer->thread);
+
+    g_cond_clear(&writer->cond);
+    g_mutex_clear(&writer->mutex);
+    g_free(writer->written);
+    g_free(writer->pending);
+    g_free(writer->path);
+    g_free(writer);
+}
+
+void snapshot_writer_reserve(Snapshot_writer *writer, gsize size) {
+    g_return_if_fail(writer != NULL);
+
+    g_mutex_lock(&writer->mutex);
+
+    if (size > writer->capacity) {
+        writer->capacity = size;
+    }
+
+    if (writer->pending_capacity < writer->capacity) {
+        writer->pending = g_realloc(writer->pending, writer->capacity);
+        writer->pending_capacity = writer->capacity;
+    }
+
+    g_mutex_unlock(&writer->mutex);
+}
+
+void snapshot_writer_save(Snapshot_writer *writer, Game *game, guint64 elapsed) {
+    g_return_if_fail(writer != NULL);
+    g_return_if_fail(game != NULL);
+
+    gsize size;
+
+    // The capacity is only changed by this thread.
+    size = game_get_snapshot_size(game);
+    g_return_if_fail(size > 0 && size <= writer->capacity);
+
+    g_mutex_lock(&writer->mutex);
+    game_write_snapshot(game, elapsed, writer->pending);
+    writer->pending_size = size;
+    writer->request = SNAPSHOT_WRITER_SAVE;
+    g_cond_signal(&writer->cond);
+    g_mutex_unlock(&writer->mutex);
+}
+
+void snapshot_writer_delete(Snapshot_writer *writer) {
+    g_return_if_fail(writer != NULL);
+
+    g_mutex_lock(&writer->mutex);
+    writer->request = SNAPSHOT_WRITER_DELETE;
+    g_cond_signal(&writer->cond);
+    g_mutex_unlock(&writer->mutex);
+}
+
+static gpointer snapshot_writer_thread(gpointer user_data) {
+    Snapshot_writer *writer = (Snapshot_writer *) user_data;
+
+    gsize size, capacity;
+    guint8 *buffer;
+    GError *error = NULL;
+    Snapshot_writer_request request;
+
+    g_mutex_lock(&writer->mutex);
+
+    while (TRUE) {
+        while (writer->request == SNAPSHOT_WRITER_NONE && writer->running) {
+            g_cond_wait(&writer->cond, &writer->mutex);
+        }
+
+        if (writer->request == SNAPSHOT_WRITER_NONE) {
+            break;
+        }
+
+        // Grown here, so the buffer handed back is never smaller than
+        // the size the UI thread reserved.
+        if (writer->written_capacity < writer->capacity) {
+            writer->written = g_realloc(writer->written, writer->capacity);
+            writer->written_capacity = writer->capacity;
+        }
+
+        buffer = writer->pending;
+        capacity = writer->pending_capacity;
+        writer->pending = writer->written;
+        writer->pending_capacity = writer->written_capacity;
+        writer->written = buffer;
+        writer->written_capacity = capacity;
+
+        size = writer->pending_size;
+        request = writer->request;
+        writer->request = SNAPSHOT_WRITER_NONE;
+
+        g_mutex_unlock(&writer->mutex);
+
+        // Written to a temporary file and renamed, a crash never leaves
+        // half of a snapshot.
+        if (request == SNAPSHOT_WRITER_SAVE) {
+            if (!g_file_set_contents(writer->path, (const gchar *) buffer, (gssize) size, &error)) {
+                g_printerr("%s\n", error->message);
+
+                g_error_free(error);
+                error = NULL;
+            }
+        } else {
+            g_unlink(writer->path);
+        }
+
+        g_mutex_lock(&writer->mutex);
+    }
+
+    g_mutex_unlock(&writer->mutex);
+
+    return NULL;
+}
@@ -0,0 +1,15 @@
+#ifndef SNAPSHOT_WRITER_H
+#define SNAPSHOT_WRITER_H
+
+#include <glib.h>
+#include "game_logic.h"
+
+typedef struct snapshot_writer_t Snapshot_writer;
+
+Snapshot_writer *snapshot_writer_create(const gchar *path);
+void snapshot_writer_destroy(Snapshot_writer *writer);
+void snapshot_writer_reserve(Snapshot_writer *writer, gsize size);
+void snapshot_writer_save(Snapshot_writer *writer, Game *game, guint64 elapsed);
+void snapshot_writer_delete(Snapshot_writer *writer);
+
+#endif
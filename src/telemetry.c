@@ -0,0 +1,275 @@
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <json-glib/json-glib.h>
+#include "telemetry.h"
+
+// Must be a power of two.
+#define TELEMETRY_CAPACITY 1024
+#define TELEMETRY_MASK (TELEMETRY_CAPACITY - 1)
+// Upper bound for the delay of an event when the writer misses a wakeup.
+#define TELEMETRY_MAX_WAIT G_USEC_PER_SEC
+
+// Single-producer/single-consumer ring buffer. The UI thread is the only
+// writer of head and the telemetry thread the only writer of tail, so the
+// producer never waits for the consumer: when the buffer is full the event
+// is dropped and counted.
+struct telemetry_t {
+    Telemetry_event events[TELEMETRY_CAPACITY];
+    volatile gint head;
+    volatile gint tail;
+    volatile gint dropped_count;
+    volatile gint running;
+
+    FILE *sink;
+    gboolean close_sink;
+
+    GThread *thread;
+    GMutex mutex;
+    GCond cond;
+};
+
+static gpointer telemetry_thread(gpointer user_data);
+static guint telemetry_drain(Telemetry *telemetry);
+static void telemetry_write_event(Telemetry *telemetry, const Telemetry_event *event,
+                                  JsonGenerator *generator
+);
+static const gchar *telemetry_event_type_name(Telemetry_event_type type);
+
+Telemetry *telemetry_create(const gchar *sink, GError **error) {
+    g_return_val_if_fail(sink != NULL, NULL);
+
+    FILE *file;
+    Telemetry *telemetry;
+
+    if (g_strcmp0(sink, "-") == 0) {
+        file = stdout;
+    } else {
+        file = g_fopen(sink, "a");
+
+        if (file == NULL) {
+            g_set_error(
+                error, G_FILE_ERROR, g_file_error_from_errno(errno),
+                "Could not open %s: %s", sink, g_strerror(errno)
+            );
+            return NULL;
+        }
+    }
+
+    telemetry = g_new0(Telemetry, 1);
+    telemetry->sink = file;
+    telemetry->close_sink = file != stdout;
+    telemetry->running = TRUE;
+    g_mutex_init(&telemetry->mutex);
+    g_cond_init(&telemetry->cond);
+
+    telemetry->thread = g_thread_new("telemetry", telemetry_thread, telemetry);
+
+    return telemetry;
+}
+
+void telemetry_destroy(Telemetry *telemetry) {
+    g_return_if_fail(telemetry != NULL);
+
+    g_atomic_int_set(&telemetry->running, FALSE);
+
+    g_mutex_lock(&telemetry->mutex);
+    g_cond_signal(&telemetry->cond);
+    g_mutex_unlock(&telemetry->mutex);
+
+    g_thread_join(telemetry->thread);
+
+    if (telemetry_get_dropped_count(telemetry) > 0) {
+        g_printerr(
+            "telemetry: %u events dropped\n",
+            telemetry_get_dropped_count(telemetry)
+        );
+    }
+
+    if (telemetry->close_sink) {
+        fclose(telemetry->sink);
+    } else {
+        fflush(telemetry->sink);
+    }
+
+    g_cond_clear(&telemetry->cond);
+    g_mutex_clear(&telemetry->mutex);
+    g_free(telemetry);
+}
+
+gboolean telemetry_push(Telemetry *telemetry, const Telemetry_event *event) {
+    g_return_val_if_fail(telemetry != NULL, FALSE);
+    g_return_val_if_fail(event != NULL, FALSE);
+
+    guint head, tail;
+
+    head = (guint) g_atomic_int_get(&telemetry->head);
+    tail = (guint) g_atomic_int_get(&telemetry->tail);
+
+    if (head - tail >= TELEMETRY_CAPACITY) {
+        g_atomic_int_inc(&telemetry->dropped_count);
+        return FALSE;
+    }
+
+    telemetry->events[head & TELEMETRY_MASK] = *event;
+    // Publishes the event, g_atomic_int_set is a full memory barrier.
+    g_atomic_int_set(&telemetry->head, (gint) (head + 1));
+
+    // Wake the writer only if it is not busy, the producer never waits
+    // for the mutex. A missed wakeup delays the event by at most
+    // TELEMETRY_MAX_WAIT.
+    if (g_mutex_trylock(&telemetry->mutex)) {
+        g_cond_signal(&telemetry->cond);
+        g_mutex_unlock(&telemetry->mutex);
+    }
+
+    return TRUE;
+}
+
+guint telemetry_get_dropped_count(Telemetry *telemetry) {
+    g_return_val_if_fail(telemetry != NULL, 0);
+
+    return (guint) g_atomic_int_get(&telemetry->dropped_count);
+}
+
+void telemetry_event_set_city_name(Telemetry_event *event, const gchar *name) {
+    g_return_if_fail(event != NULL);
+    g_return_if_fail(name != NULL);
+
+    gsize length;
+
+    length = strlen(name);
+
+    // A long name is cut before the character that does not fit whole,
+    // so the sink always gets valid UTF-8.
+    if (length >= sizeof(event->city_name)) {
+        length = (gsize) (g_utf8_find_prev_char(name, name + sizeof(event->city_name)) - name);
+    }
+
+    memcpy(event->city_name, name, length);
+    event->city_name[length] = '\0';
+}
+
+static gpointer telemetry_thread(gpointer user_data) {
+    Telemetry *telemetry = (Telemetry *) user_data;
+
+    gboolean running;
+    gboolean empty;
+
+    do {
+        running = g_atomic_int_get(&telemetry->running);
+        telemetry_drain(telemetry);
+
+        g_mutex_lock(&telemetry->mutex);
+
+        empty = g_atomic_int_get(&telemetry->head) == g_atomic_int_get(&telemetry->tail);
+        if (empty && g_atomic_int_get(&telemetry->running)) {
+            g_cond_wait_until(
+                &telemetry->cond, &telemetry->mutex,
+                g_get_monotonic_time() + TELEMETRY_MAX_WAIT
+            );
+        }
+
+        g_mutex_unlock(&telemetry->mutex);
+    } while (running);
+
+    // Events pushed right before the shutdown.
+    telemetry_drain(telemetry);
+
+    return NULL;
+}
+
+static guint telemetry_drain(Telemetry *telemetry) {
+    guint head, tail;
+    guint count;
+    JsonGenerator *generator;
+
+    head = (guint) g_atomic_int_get(&telemetry->head);
+    tail = (guint) g_atomic_int_get(&telemetry->tail);
+
+    if (head == tail) {
+        return 0;
+    }
+
+    generator = json_generator_new();
+
+    for (count = 0; tail != head; tail++, count++) {
+        telemetry_write_event(telemetry, &telemetry->events[tail & TELEMETRY_MASK], generator);
+        // Hands the slot back to the producer.
+        g_atomic_int_set(&telemetry->tail, (gint) (tail + 1));
+    }
+
+    fflush(telemetry->sink);
+    g_object_unref(G_OBJECT(generator));
+
+    return count;
+}
+
+static void telemetry_write_event(Telemetry *telemetry, const Telemetry_event *event,
+                                  JsonGenerator *generator
+) {
+    gchar *line;
+    JsonNode *root;
+    JsonBuilder *builder;
+
+    builder = json_builder_new();
+
+    json_builder_begin_object(builder);
+    json_builder_set_member_name(builder, "time");
+    json_builder_add_int_value(builder, event->time);
+    json_builder_set_member_name(builder, "event");
+    json_builder_add_string_value(builder, telemetry_event_type_name(event->type));
+    json_builder_set_member_name(builder, "mode");
+    json_builder_add_int_value(builder, event->mode);
+    json_builder_set_member_name(builder, "difficulty");
+    json_builder_add_int_value(builder, event->difficulty);
+
+    if (event->city_name[0] != '\0') {
+        json_builder_set_member_name(builder, "city");
+        json_builder_add_string_value(builder, event->city_name);
+    }
+
+    if (event->type == TELEMETRY_ANSWER) {
+        json_builder_set_member_name(builder, "correct");
+        json_builder_add_boolean_value(builder, event->correct);
+    }
+
+    json_builder_set_member_name(builder, "correct_count");
+    json_builder_add_int_value(builder, event->correct_count);
+    json_builder_set_member_name(builder, "incorrect_count");
+    json_builder_add_int_value(builder, event->incorrect_count);
+    json_builder_set_member_name(builder, "remaining_count");
+    json_builder_add_int_value(builder, event->remaining_count);
+    json_builder_set_member_name(builder, "dropped");
+    json_builder_add_int_value(builder, telemetry_get_dropped_count(telemetry));
+    json_builder_end_object(builder);
+
+    root = json_builder_get_root(builder);
+    json_generator_set_root(generator, root);
+    line = json_generator_to_data(generator, NULL);
+
+    fprintf(telemetry->sink, "%s\n", line);
+
+    g_free(line);
+    json_node_unref(root);
+    g_object_unref(G_OBJECT(builder));
+}
+
+static const gchar *telemetry_event_type_name(Telemetry_event_type type) {
+    switch (type) {
+        case TELEMETRY_GAME_START:
+            return "start";
+        case TELEMETRY_ANSWER:
+            return "answer";
+        case TELEMETRY_NEXT_QUESTION:
+            return "next_question";
+        case TELEMETRY_GAME_STOP:
+            return "stop";
+        case TELEMETRY_GAME_RESTART:
+            return "restart";
+        default:
+            return "unknown";
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <glib.h>
+
+#define TELEMETRY_CITY_NAME_SIZE 64
+
+typedef struct telemetry_t Telemetry;
+
+typedef enum telemetry_event_type_t {
+    TELEMETRY_GAME_START,
+    TELEMETRY_ANSWER,
+    TELEMETRY_NEXT_QUESTION,
+    TELEMETRY_GAME_STOP,
+    TELEMETRY_GAME_RESTART
+} Telemetry_event_type;
+
+// Fixed-size record, so pushing an event never allocates.
+typedef struct telemetry_event_t {
+    gint64 time;
+    Telemetry_event_type type;
+    guint mode;
+    guint difficulty;
+    gboolean correct;
+    guint correct_count;
+    guint incorrect_count;
+    guint remaining_count;
+    gchar city_name[TELEMETRY_CITY_NAME_SIZE];
+} Telemetry_event;
+
+Telemetry *telemetry_create(const gchar *sink, GError **error);
+void telemetry_destroy(Telemetry *telemetry);
+gboolean telemetry_push(Telemetry *telemetry, const Telemetry_event *event);
+guint telemetry_get_dropped_count(Telemetry *telemetry);
+void telemetry_event_set_city_name(Telemetry_event *event, const gchar *name);
+
+#endif
@@ -0,0 +1,188 @@
+#include <stdlib.h>
+#include <glib.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+// Builds the tile pyramid of the map at build time.
+//
+// Level 0 is the map scaled to the base size (the size of the map in the
+// user interface), every next level doubles the resolution until the
+// resolution of the source image is reached. Each level is split into
+// tile_size x tile_size tiles which are saved as
+// OUTPUT_DIR/<level>/<column>-<row>.png, together with the pyramid.ini
+// description and the tiles.gresource.xml used to bundle the tiles.
+
+#define TILES_PREFIX "/ns/dragi/gradovi-srbije/tiles"
+#define DEFAULT_TILE_SIZE 256
+
+static gboolean save_level(GdkPixbuf *level_pixbuf, gint level, gint tile_size,
+                           const gchar *output_dir, GString *gresource_xml
+);
+static gboolean save_pyramid_description(const gchar *output_dir, gint width,
+                                         gint height, gint tile_size, gint levels
+);
+
+int main(int argc, char *argv[]) {
+    gint level, levels;
+    gint width, height, tile_size;
+    gchar *path;
+    gboolean saved;
+    GString *gresource_xml;
+    GdkPixbuf *source, *level_pixbuf;
+    GError *error = NULL;
+
+    if (argc < 5) {
+        g_printerr(
+            "Usage: %s SOURCE OUTPUT_DIR BASE_WIDTH BASE_HEIGHT [TILE_SIZE]\n",
+            argv[0]
+        );
+        exit(EXIT_FAILURE);
+    }
+
+    width = atoi(argv[3]);
+    height = atoi(argv[4]);
+    tile_size = argc > 5 ? atoi(argv[5]) : DEFAULT_TILE_SIZE;
+
+    if (width <= 0 || height <= 0 || tile_size <= 0) {
+        g_printerr("Invalid base size or tile size!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    source = gdk_pixbuf_new_from_file(argv[1], &error);
+    if (error != NULL) {
+        g_printerr("%s\n", error->message);
+
+        g_error_free(error);
+        exit(EXIT_FAILURE);
+    }
+
+    levels = 1;
+    while (width << levels <= gdk_pixbuf_get_width(source) &&
+           height << levels <= gdk_pixbuf_get_height(source)) {
+        levels++;
+    }
+
+    gresource_xml = g_string_new(
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<gresources>\n"
+        "  <gresource prefix=\"" TILES_PREFIX "\">\n"
+        "    <file>pyramid.ini</file>\n"
+    );
+
+    saved = TRUE;
+    for (level = 0; level < levels && saved; level++) {
+        level_pixbuf = gdk_pixbuf_scale_simple(
+            source,
+            width << level,
+            height << level,
+            GDK_INTERP_HYPER
+        );
+
+        saved = save_level(level_pixbuf, level, tile_size, argv[2], gresource_xml);
+
+        g_object_unref(G_OBJECT(level_pixbuf));
+    }
+
+    g_string_append(gresource_xml, "  </gresource>\n</gresources>\n");
+
+    if (saved) {
+        saved = save_pyramid_description(argv[2], width, height, tile_size, levels);
+    }
+
+    if (saved) {
+        path = g_build_filename(argv[2], "tiles.gresource.xml", NULL);
+        saved = g_file_set_contents(path, gresource_xml->str, -1, &error);
+        g_free(path);
+
+        if (error != NULL) {
+            g_printerr("%s\n", error->message);
+            g_error_free(error);
+        }
+    }
+
+    g_string_free(gresource_xml, TRUE);
+    g_object_unref(G_OBJECT(source));
+
+    exit(saved ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+static gboolean save_level(GdkPixbuf *level_pixbuf, gint level, gint tile_size,
+                           const gchar *output_dir, GString *gresource_xml
+) {
+    gint row, column;
+    gint tile_width, tile_height;
+    gchar *level_dir, *name, *path;
+    gboolean saved;
+    GdkPixbuf *tile;
+    GError *error = NULL;
+
+    level_dir = g_strdup_printf("%s/%d", output_dir, level);
+    if (g_mkdir_with_parents(level_dir, 0755) != 0) {
+        g_printerr("Could not create %s!\n", level_dir);
+
+        g_free(level_dir);
+        return FALSE;
+    }
+    g_free(level_dir);
+
+    saved = TRUE;
+    for (row = 0; row * tile_size < gdk_pixbuf_get_height(level_pixbuf) && saved; row++) {
+        for (column = 0; column * tile_size < gdk_pixbuf_get_width(level_pixbuf) && saved; column++) {
+            tile_width = MIN(tile_size, gdk_pixbuf_get_width(level_pixbuf) - column * tile_size);
+            tile_height = MIN(tile_size, gdk_pixbuf_get_height(level_pixbuf) - row * tile_size);
+
+            tile = gdk_pixbuf_new_subpixbuf(
+                level_pixbuf,
+                column * tile_size,
+                row * tile_size,
+                tile_width,
+                tile_height
+            );
+
+            name = g_strdup_printf("%d/%d-%d.png", level, column, row);
+            path = g_build_filename(output_dir, name, NULL);
+
+            saved = gdk_pixbuf_save(tile, path, "png", &error, NULL);
+            if (error != NULL) {
+                g_printerr("%s\n", error->message);
+                g_error_free(error);
+                error = NULL;
+            }
+
+            g_string_append_printf(gresource_xml, "    <file>%s</file>\n", name);
+
+            g_free(path);
+            g_free(name);
+            g_object_unref(G_OBJECT(tile));
+        }
+    }
+
+    return saved;
+}
+
+static gboolean save_pyramid_description(const gchar *output_dir, gint width,
+                                         gint height, gint tile_size, gint levels
+) {
+    gchar *path;
+    gboolean saved;
+    GKeyFile *key_file;
+    GError *error = NULL;
+
+    key_file = g_key_file_new();
+    g_key_file_set_integer(key_file, "pyramid", "width", width);
+    g_key_file_set_integer(key_file, "pyramid", "height", height);
+    g_key_file_set_integer(key_file, "pyramid", "tile_size", tile_size);
+    g_key_file_set_integer(key_file, "pyramid", "levels", levels);
+
+    path = g_build_filename(output_dir, "pyramid.ini", NULL);
+    saved = g_key_file_save_to_file(key_file, path, &error);
+
+    if (error != NULL) {
+        g_printerr("%s\n", error->message);
+        g_error_free(error);
+    }
+
+    g_free(path);
+    g_key_file_free(key_file);
+
+    return saved;
+}
@@ -0,0 +1,150 @@
+#include <string.h>
+#include <glib.h>
+#include "transliteration.h"
+
+// Serbian Latin and Cyrillic alphabets. Every Cyrillic letter is a single
+// character, while lj, nj and dž are written with two Latin characters.
+// All of the functions lower the case of the text, characters that are not
+// Serbian letters are only lowered.
+typedef struct transliteration_letter_t {
+    gunichar latin[2];
+    gunichar cyrillic;
+} Transliteration_letter;
+
+// The digraphs come first, so they take precedence over l, n and d.
+static const Transliteration_letter letters[] = {
+    {{'l', 'j'}, 0x0459}, {{'n', 'j'}, 0x045A}, {{'d', 0x017E}, 0x045F},
+    {{'a', 0}, 0x0430}, {{'b', 0}, 0x0431}, {{'v', 0}, 0x0432},
+    {{'g', 0}, 0x0433}, {{'d', 0}, 0x0434}, {{0x0111, 0}, 0x0452},
+    {{'e', 0}, 0x0435}, {{0x017E, 0}, 0x0436}, {{'z', 0}, 0x0437},
+    {{'i', 0}, 0x0438}, {{'j', 0}, 0x0458}, {{'k', 0}, 0x043A},
+    {{'l', 0}, 0x043B}, {{'m', 0}, 0x043C}, {{'n', 0}, 0x043D},
+    {{'o', 0}, 0x043E}, {{'p', 0}, 0x043F}, {{'r', 0}, 0x0440},
+    {{'s', 0}, 0x0441}, {{'t', 0}, 0x0442}, {{0x0107, 0}, 0x045B},
+    {{'u', 0}, 0x0443}, {{'f', 0}, 0x0444}, {{'h', 0}, 0x0445},
+    {{'c', 0}, 0x0446}, {{0x010D, 0}, 0x0447}, {{0x0161, 0}, 0x0448}
+};
+
+gchar *transliteration_to_latin(const gchar *text) {
+    g_return_val_if_fail(text != NULL, NULL);
+
+    gsize i;
+    gunichar c;
+    GString *latin;
+
+    latin = g_string_sized_new(strlen(text));
+
+    for (; *text != '\0'; text = g_utf8_next_char(text)) {
+        c = g_unichar_tolower(g_utf8_get_char(text));
+
+        for (i = 0; i < G_N_ELEMENTS(letters); i++) {
+            if (letters[i].cyrillic == c) {
+                break;
+            }
+        }
+
+        if (i == G_N_ELEMENTS(letters)) {
+            g_string_append_unichar(latin, c);
+            continue;
+        }
+
+        g_string_append_unichar(latin, letters[i].latin[0]);
+        if (letters[i].latin[1] != 0) {
+            g_string_append_unichar(latin, letters[i].latin[1]);
+        }
+    }
+
+    return g_string_free(latin, FALSE);
+}
+
+gchar *transliteration_to_cyrillic(const gchar *text) {
+    g_return_val_if_fail(text != NULL, NULL);
+
+    gsize i;
+    gunichar c, next;
+    const gchar *next_char;
+    GString *cyrillic;
+
+    cyrillic = g_string_sized_new(strlen(text) * 2);
+
+    while (*text != '\0') {
+        c = g_unichar_tolower(g_utf8_get_char(text));
+        next_char = g_utf8_next_char(text);
+        next = *next_char != '\0' ? g_unichar_tolower(g_utf8_get_char(next_char)) : 0;
+
+        for (i = 0; i < G_N_ELEMENTS(letters); i++) {
+            if (letters[i].latin[0] == c &&
+                (letters[i].latin[1] == 0 || letters[i].latin[1] == next)) {
+                break;
+            }
+        }
+
+        if (i == G_N_ELEMENTS(letters)) {
+            g_string_append_unichar(cyrillic, c);
+        } else {
+            g_string_append_unichar(cyrillic, letters[i].cyrillic);
+
+            if (letters[i].latin[1] != 0) {
+                next_char = g_utf8_next_char(next_char);
+            }
+        }
+
+        text = next_char;
+    }
+
+    return g_string_free(cyrillic, FALSE);
+}
+
+gchar *transliteration_strip_diacritics(const gchar *latin_text) {
+    g_return_val_if_fail(latin_text != NULL, NULL);
+
+    gunichar c;
+    GString *ascii;
+
+    // Character for character, so the result can be walked together with
+    // the Latin text.
+    ascii = g_string_sized_new(strlen(latin_text));
+
+    for (; *latin_text != '\0'; latin_text = g_utf8_next_char(latin_text)) {
+        c = g_unichar_tolower(g_utf8_get_char(latin_text));
+
+        switch (c) {
+            case 0x010D:
+            case 0x0107:
+                c = 'c';
+                break;
+            case 0x0111:
+                c = 'd';
+                break;
+            case 0x0161:
+                c = 's';
+                break;
+            case 0x017E:
+                c = 'z';
+                break;
+            default:
+                break;
+        }
+
+        g_string_append_unichar(ascii, c);
+    }
+
+    return g_string_free(ascii, FALSE);
+}
+
+gboolean transliteration_is_cyrillic(const gchar *text) {
+    g_return_val_if_fail(text != NULL, FALSE);
+
+    gunichar c;
+
+    // Decided by the first letter, the rest of the text is not inspected.
+    for (; *text != '\0'; text = g_utf8_next_char(text)) {
+        c = g_utf8_get_char(text);
+
+        if (g_unichar_isalpha(c)) {
+            return g_unichar_get_script(c) == G_UNICODE_SCRIPT_CYRILLIC;
+        }
+    }
+
+    return FALSE;
+}
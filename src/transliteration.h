@@ -0,0 +1,11 @@
+#ifndef TRANSLITERATION_H
+#define TRANSLITERATION_H
+
+#include <glib.h>
+
+gchar *transliteration_to_latin(const gchar *text);
+gchar *transliteration_to_cyrillic(const gchar *text);
+gchar *transliteration_strip_diacritics(const gchar *latin_text);
+gboolean transliteration_is_cyrillic(const gchar *text);
+
+#endif
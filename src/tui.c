@@ -0,0 +1,504 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#ifdef G_OS_UNIX
+#include <unistd.h>
+#include <termios.h>
+#endif
+#include "tui.h"
+#include "city.h"
+#include "game_data.h"
+#include "game_logic.h"
+
+// Typing mode quiz in the terminal (--tui), the user interface is never
+// initialized. The question is the first paragraph of the description
+// with the name of the city hidden. Tab completes the answer from a
+// sorted index of the Latin, ASCII and Cyrillic keys of the cities (the
+// keys of City, often borrowed from the index cache): the
+// cities that start with a prefix are a contiguous range of the index,
+// found with a binary search. Without a terminal (or on systems without
+// termios) the answers are read line by line, without the completion.
+#define TUI_PROMPT "> "
+#define TUI_MAX_CANDIDATES 20
+#define TUI_CTRL_C 0x03
+#define TUI_CTRL_D 0x04
+#define TUI_BACKSPACE 0x08
+#define TUI_TAB 0x09
+#define TUI_ESCAPE 0x1B
+#define TUI_DELETE 0x7F
+
+typedef struct tui_index_entry_t {
+    // Owned by the city.
+    const gchar *key;
+    City *city;
+    gboolean cyrillic;
+} Tui_index_entry;
+
+typedef struct tui_t {
+    Game *game;
+    GList *cities;
+    // Sorted by the key, byte by byte.
+    GArray *index;
+    gboolean raw;
+#ifdef G_OS_UNIX
+    struct termios saved_termios;
+#endif
+} Tui;
+
+static void tui_build_index(Tui *tui);
+static void tui_add_index_entry(Tui *tui, const gchar *key, City *city, gboolean cyrillic);
+static gint tui_compare_entries(gconstpointer a, gconstpointer b);
+static guint tui_find_prefix(Tui *tui, const gchar *prefix, guint *count);
+static gboolean tui_enable_raw_mode(Tui *tui);
+static void tui_disable_raw_mode(Tui *tui);
+static gboolean tui_play(Tui *tui, Game_difficulty difficulty);
+static gboolean tui_ask_difficulty(Tui *tui, Game_difficulty *difficulty);
+static gchar *tui_read_line(Tui *tui, const gchar *prompt, gboolean complete);
+#ifdef G_OS_UNIX
+static gchar *tui_read_raw_line(Tui *tui, const gchar *prompt, gboolean complete);
+#endif
+static void tui_complete(Tui *tui, GString *line, gboolean list);
+static void tui_redraw_line(const gchar *prompt, GString *line);
+static gchar *tui_create_hint(City *city);
+
+gint tui_run(Game_data *data) {
+    g_return_val_if_fail(data != NULL, EXIT_FAILURE);
+
+    Tui tui;
+    gchar *answer;
+    Game_difficulty difficulty;
+
+    tui.cities = game_data_get_cities(data);
+    if (tui.cities == NULL) {
+        g_printerr("There are no cities!\n");
+        return EXIT_FAILURE;
+    }
+
+    tui.game = game_create(tui.cities);
+    game_set_mode(tui.game, TYPING);
+    tui_build_index(&tui);
+    tui.raw = tui_enable_raw_mode(&tui);
+
+    printf("Gradovi Srbije, %u gradova. Tab dopunjuje ime grada, Ctrl-D završava igru.\n\n",
+           g_list_length(tui.cities));
+
+    while (tui_ask_difficulty(&tui, &difficulty) && tui_play(&tui, difficulty)) {
+        answer = tui_read_line(&tui, "Nova igra? [D/n] ", FALSE);
+        if (answer == NULL || g_ascii_tolower(answer[0]) == 'n') {
+            g_free(answer);
+            break;
+        }
+        g_free(answer);
+    }
+
+    tui_disable_raw_mode(&tui);
+
+    g_array_free(tui.index, TRUE);
+    game_destroy(tui.game);
+    g_list_free(tui.cities);
+
+    return EXIT_SUCCESS;
+}
+
+static void tui_build_index(Tui *tui) {
+    GList *i;
+    City *city;
+    const gchar *latin_key, *ascii_key;
+
+    tui->index = g_array_sized_new(FALSE, FALSE, sizeof(Tui_index_entry), g_list_length(tui->cities) * 3);
+
+    for (i = tui->cities; i != NULL; i = i->next) {
+        city = (City *) i->data;
+
+        latin_key = city_get_latin_key(city);
+        ascii_key = city_get_ascii_key(city);
+
+        tui_add_index_entry(tui, latin_key, city, FALSE);
+        if (strcmp(ascii_key, latin_key) != 0) {
+            tui_add_index_entry(tui, ascii_key, city, FALSE);
+        }
+        tui_add_index_entry(tui, city_get_cyrillic_key(city), city, TRUE);
+    }
+
+    g_array_sort(tui->index, tui_compare_entries);
+}
+
+static void tui_add_index_entry(Tui *tui, const gchar *key, City *city, gboolean cyrillic) {
+    Tui_index_entry entry;
+
+    entry.key = key;
+    entry.city = city;
+    entry.cyrillic = cyrillic;
+
+    g_array_append_val(tui->index, entry);
+}
+
+static gint tui_compare_entries(gconstpointer a, gconstpointer b) {
+    return strcmp(((const Tui_index_entry *) a)->key, ((const Tui_index_entry *) b)->key);
+}
+
+static guint tui_find_prefix(Tui *tui, const gchar *prefix, guint *count) {
+    guint low, high, middle, first;
+    gsize length;
+
+    length = strlen(prefix);
+
+    // The first key that is not smaller than the prefix...
+    low = 0;
+    high = tui->index->len;
+    while (low < high) {
+        middle = low + (high - low) / 2;
+
+        if (strcmp(g_array_index(tui->index, Tui_index_entry, middle).key, prefix) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    first = low;
+
+    // ...and the first one after it without the prefix.
+    high = tui->index->len;
+    while (low < high) {
+        middle = low + (high - low) / 2;
+
+        if (strncmp(g_array_index(tui->index, Tui_index_entry, middle).key, prefix, length) == 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    *count = low - first;
+
+    return first;
+}
+
+static gboolean tui_enable_raw_mode(Tui *tui) {
+#ifdef G_OS_UNIX
+    struct termios raw;
+
+    if (!isatty(STDIN_FILENO) || tcgetattr(STDIN_FILENO, &tui->saved_termios) != 0) {
+        return FALSE;
+    }
+
+    // Byte by byte without the echo, Ctrl-C is read as a key so the
+    // terminal is always restored.
+    raw = tui->saved_termios;
+    raw.c_lflag &= ~(tcflag_t) (ICANON | ECHO | ISIG);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+
+    return tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) == 0;
+#else
+    (void) tui;
+
+    return FALSE;
+#endif
+}
+
+static void tui_disable_raw_mode(Tui *tui) {
+#ifdef G_OS_UNIX
+    if (tui->raw) {
+        tcsetattr(STDIN_FILENO, TCSAFLUSH, &tui->saved_termios);
+    }
+#else
+    (void) tui;
+#endif
+}
+
+static gboolean tui_ask_difficulty(Tui *tui, Game_difficulty *difficulty) {
+    gchar *answer;
+
+    answer = tui_read_line(tui, "Težina (1 lako, 2 srednje, 3 teško) [2]: ", FALSE);
+    if (answer == NULL) {
+        return FALSE;
+    }
+
+    switch (answer[0]) {
+        case '1':
+            *difficulty = EASY;
+            break;
+        case '3':
+            *difficulty = HARD;
+            break;
+        default:
+            *difficulty = MEDIUM;
+            break;
+    }
+
+    g_free(answer);
+
+    return TRUE;
+}
+
+static gboolean tui_play(Tui *tui, Game_difficulty difficulty) {
+    guint question, question_count;
+    gint64 start;
+    gint seconds;
+    gchar *hint;
+    gchar *answer;
+    City *city;
+
+    game_set_difficulty(tui->game, difficulty);
+    game_start(tui->game);
+
+    question_count = game_get_remaining_questions_count(tui->game);
+    start = g_get_monotonic_time();
+
+    for (question = 1; (city = game_get_current_city(tui->game)) != NULL; question++) {
+        hint = tui_create_hint(city);
+        printf("\n[%u/%u] %s\n", question, question_count, hint);
+        g_free(hint);
+
+        answer = tui_read_line(tui, TUI_PROMPT, TRUE);
+        if (answer == NULL) {
+            game_stop(tui->game);
+            printf("\n");
+            return FALSE;
+        }
+
+        if (game_check_user_answer(tui->game, answer)) {
+            printf("Tačno!\n");
+        } else {
+            printf("Netačno, to je %s.\n", city_get_name(city));
+        }
+        g_free(answer);
+
+        if (!game_next_question(tui->game)) {
+            break;
+        }
+    }
+
+    seconds = (gint) ((g_get_monotonic_time() - start) / G_USEC_PER_SEC);
+    printf(
+        "\nTačnih odgovora: %u od %u, vreme: %02d:%02d\n\n",
+        game_get_correct_answer_count(tui->game), question_count,
+        seconds / 60, seconds % 60
+    );
+
+    game_stop(tui->game);
+
+    return TRUE;
+}
+
+static gchar *tui_read_line(Tui *tui, const gchar *prompt, gboolean complete) {
+    gchar buffer[256];
+    gsize length;
+
+#ifdef G_OS_UNIX
+    if (tui->raw) {
+        return tui_read_raw_line(tui, prompt, complete);
+    }
+#else
+    (void) tui;
+    (void) complete;
+#endif
+
+    fputs(prompt, stdout);
+    fflush(stdout);
+
+    if (fgets(buffer, sizeof(buffer), stdin) == NULL) {
+        return NULL;
+    }
+
+    length = strlen(buffer);
+    while (length > 0 && (buffer[length - 1] == '\n' || buffer[length - 1] == '\r')) {
+        buffer[--length] = '\0';
+    }
+
+    return g_strdup(buffer);
+}
+
+#ifdef G_OS_UNIX
+static gchar *tui_read_raw_line(Tui *tui, const gchar *prompt, gboolean complete) {
+    gchar c;
+    gchar *end;
+    gboolean listed = FALSE;
+    gboolean last_tab = FALSE;
+    GString *line;
+
+    line = g_string_new(NULL);
+
+    fputs(prompt, stdout);
+    fflush(stdout);
+
+    while (read(STDIN_FILENO, &c, 1) == 1) {
+        if (c == '\r' || c == '\n') {
+            fputs("\n", stdout);
+            return g_string_free(line, FALSE);
+        }
+
+        if (c == TUI_CTRL_C || (c == TUI_CTRL_D && line->len == 0)) {
+            break;
+        }
+
+        if (c == TUI_TAB && complete) {
+            // The second tab in a row lists the candidates.
+            listed = last_tab && !listed;
+            tui_complete(tui, line, listed);
+            tui_redraw_line(prompt, line);
+            last_tab = TRUE;
+            continue;
+        }
+
+        last_tab = FALSE;
+        listed = FALSE;
+
+        if (c == TUI_DELETE || c == TUI_BACKSPACE) {
+            if (line->len > 0) {
+                end = g_utf8_find_prev_char(line->str, line->str + line->len);
+                g_string_truncate(line, end != NULL ? (gsize) (end - line->str) : 0);
+                fputs("\b \b", stdout);
+            }
+        } else if (c == TUI_ESCAPE) {
+            // Arrow keys and the other escape sequences are ignored.
+            if (read(STDIN_FILENO, &c, 1) == 1 && c == '[') {
+                while (read(STDIN_FILENO, &c, 1) == 1 && (c < 0x40 || c > 0x7E)) {
+                    // The parameters of the sequence.
+                }
+            }
+        } else if ((guchar) c >= 0x20) {
+            g_string_append_c(line, c);
+            fputc(c, stdout);
+        }
+
+        fflush(stdout);
+    }
+
+    fputs("\n", stdout);
+    g_string_free(line, TRUE);
+
+    return NULL;
+}
+#endif
+
+static void tui_complete(Tui *tui, GString *line, gboolean list) {
+    guint i, first, count, shown;
+    gsize common;
+    gchar *prefix;
+    gchar *name;
+    const gchar *key;
+    City *city;
+    GHashTable *shown_cities;
+    Tui_index_entry *entry;
+
+    prefix = g_utf8_strdown(line->str, -1);
+    first = tui_find_prefix(tui, prefix, &count);
+
+    if (count == 0) {
+        g_free(prefix);
+        return;
+    }
+
+    entry = &g_array_index(tui->index, Tui_index_entry, first);
+
+    if (list) {
+        fputs("\n", stdout);
+        // A city can match with more than one of its keys.
+        shown_cities = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+        for (i = 0, shown = 0; i < count && shown < TUI_MAX_CANDIDATES; i++) {
+            city = entry[i].city;
+
+            if (g_hash_table_contains(shown_cities, city)) {
+                continue;
+            }
+
+            g_hash_table_add(shown_cities, city);
+            printf("  %s\n", city_get_name(city));
+            shown++;
+        }
+
+        if (i < count) {
+            printf("  ...\n");
+        }
+
+        g_hash_table_destroy(shown_cities);
+    }
+
+    // All of the keys of a single city, the answer is its real name. The
+    // keys of one city are not always next to each other ("nis", "nisava",
+    // "niš"), so the whole range is compared.
+    for (i = 1; i < count; i++) {
+        if (entry[i].city != entry[0].city) {
+            break;
+        }
+    }
+
+    if (i == count) {
+        if (entry[0].cyrillic) {
+            name = g_strdup(entry[0].key);
+        } else {
+            name = g_strdup(city_get_name(entry[0].city));
+        }
+
+        g_string_assign(line, name);
+        g_free(name);
+        g_free(prefix);
+        return;
+    }
+
+    // The longest common prefix of the keys, in whole characters.
+    key = entry[0].key;
+    common = strlen(key);
+    for (i = 1; i < count; i++) {
+        common = MIN(common, strlen(entry[i].key));
+
+        while (common > 0 && strncmp(key, entry[i].key, common) != 0) {
+            common--;
+        }
+    }
+    while (common > 0 && !g_utf8_validate(key, (gssize) common, NULL)) {
+        common--;
+    }
+
+    if (common > strlen(prefix)) {
+        g_string_assign(line, "");
+        g_string_append_len(line, key, (gssize) common);
+    }
+
+    g_free(prefix);
+}
+
+static void tui_redraw_line(const gchar *prompt, GString *line) {
+    printf("\r\033[K%s%s", prompt, line->str);
+    fflush(stdout);
+}
+
+static gchar *tui_create_hint(City *city) {
+    gsize i;
+    gsize name_length;
+    gboolean tag = FALSE;
+    const gchar *c;
+    const gchar *name;
+    GString *hint;
+
+    name = city_get_name(city);
+    name_length = strlen(name);
+    hint = g_string_new(NULL);
+
+    // The first paragraph without the markup, the name is hidden.
+    for (c = city_get_description(city); *c != '\0' && *c != '\n'; c++) {
+        if (*c == '<') {
+            tag = TRUE;
+        } else if (*c == '>') {
+            tag = FALSE;
+        } else if (tag) {
+            continue;
+        } else if (strncmp(c, name, name_length) == 0) {
+            for (i = 0; i < (gsize) g_utf8_strlen(name, -1); i++) {
+                g_string_append_c(hint, '_');
+            }
+            c += name_length - 1;
+        } else if (strncmp(c, "&amp;", 5) == 0) {
+            g_string_append_c(hint, '&');
+            c += 4;
+        } else {
+            g_string_append_c(hint, *c);
+        }
+    }
+
+    return g_string_free(hint, FALSE);
+}
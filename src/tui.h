@@ -0,0 +1,9 @@
+#ifndef TUI_H
+#define TUI_H
+
+#include <glib.h>
+#include "game_data.h"
+
+gint tui_run(Game_data *data);
+
+#endif
@@ -0,0 +1,210 @@
+#include <gtk/gtk.h>
+#include "ui_benchmark.h"
+
+// The main loop is considered idle when nothing was dispatched for this long.
+#define UI_BENCHMARK_QUIET_TIME (100 * G_TIME_SPAN_MILLISECOND)
+// Upper bound for waiting on a single operation (endless animations).
+#define UI_BENCHMARK_MAX_SETTLE_TIME (5 * G_TIME_SPAN_SECOND)
+
+// Times user interface operations together with the frames they cause.
+//
+// Every iteration calls the prepare function (not timed), waits until the
+// window is idle, calls the operation and then waits until the window is
+// idle again. For each operation the report contains the time spent in the
+// call itself, the time until the last frame caused by the operation was
+// painted (layout, drawing and animations included) and the number of
+// frames painted in between.
+typedef struct ui_benchmark_operation_t {
+    gchar *name;
+    Ui_benchmark_func prepare;
+    Ui_benchmark_func run;
+    gpointer user_data;
+
+    gint64 call_total, call_min, call_max;
+    gint64 settle_total, settle_min, settle_max;
+    guint frames_total;
+    guint iterations;
+} Ui_benchmark_operation;
+
+struct ui_benchmark_t {
+    GtkWidget *window;
+    GdkFrameClock *frame_clock;
+    gulong after_paint_id;
+    guint frame_count;
+    gint64 last_frame_time;
+    GList *operations;
+};
+
+static void ui_benchmark_on_after_paint(G_GNUC_UNUSED GdkFrameClock *frame_clock,
+                                        gpointer user_data
+);
+static void ui_benchmark_settle(void);
+static void ui_benchmark_run_operation(Ui_benchmark *benchmark,
+                                       Ui_benchmark_operation *operation,
+                                       guint iteration
+);
+static void ui_benchmark_print_operation(Ui_benchmark_operation *operation);
+static void ui_benchmark_operation_free(gpointer data);
+
+Ui_benchmark *ui_benchmark_create(GtkWidget *window) {
+    g_return_val_if_fail(GTK_IS_WIDGET(window), NULL);
+
+    Ui_benchmark *benchmark;
+
+    benchmark = g_slice_new0(Ui_benchmark);
+    benchmark->window = g_object_ref(window);
+
+    return benchmark;
+}
+
+void ui_benchmark_destroy(Ui_benchmark *benchmark) {
+    g_return_if_fail(benchmark != NULL);
+
+    g_list_free_full(benchmark->operations, ui_benchmark_operation_free);
+    g_object_unref(benchmark->window);
+    g_slice_free(Ui_benchmark, benchmark);
+}
+
+void ui_benchmark_add(Ui_benchmark *benchmark, const gchar *name,
+                      Ui_benchmark_func prepare, Ui_benchmark_func run,
+                      gpointer user_data
+) {
+    g_return_if_fail(benchmark != NULL);
+    g_return_if_fail(name != NULL);
+    g_return_if_fail(run != NULL);
+
+    Ui_benchmark_operation *operation;
+
+    operation = g_slice_new0(Ui_benchmark_operation);
+    operation->name = g_strdup(name);
+    operation->prepare = prepare;
+    operation->run = run;
+    operation->user_data = user_data;
+    operation->call_min = G_MAXINT64;
+    operation->settle_min = G_MAXINT64;
+
+    benchmark->operations = g_list_append(benchmark->operations, operation);
+}
+
+void ui_benchmark_run(Ui_benchmark *benchmark, guint iterations) {
+    g_return_if_fail(benchmark != NULL);
+
+    guint iteration;
+    GList *i;
+
+    gtk_widget_show(benchmark->window);
+    ui_benchmark_settle();
+
+    benchmark->frame_clock = gtk_widget_get_frame_clock(benchmark->window);
+    g_return_if_fail(benchmark->frame_clock != NULL);
+
+    benchmark->after_paint_id = g_signal_connect(
+        benchmark->frame_clock,
+        "after-paint",
+        G_CALLBACK(ui_benchmark_on_after_paint),
+        benchmark
+    );
+
+    for (i = benchmark->operations; i != NULL; i = i->next) {
+        for (iteration = 0; iteration < iterations; iteration++) {
+            ui_benchmark_run_operation(benchmark, i->data, iteration);
+        }
+    }
+
+    g_signal_handler_disconnect(benchmark->frame_clock, benchmark->after_paint_id);
+
+    g_print(
+        "%-32s %10s %10s %10s %10s %10s %10s %8s\n",
+        "operation", "call avg", "call min", "call max",
+        "paint avg", "paint min", "paint max", "frames"
+    );
+
+    for (i = benchmark->operations; i != NULL; i = i->next) {
+        ui_benchmark_print_operation(i->data);
+    }
+}
+
+static void ui_benchmark_on_after_paint(G_GNUC_UNUSED GdkFrameClock *frame_clock,
+                                        gpointer user_data
+) {
+    Ui_benchmark *benchmark = (Ui_benchmark *) user_data;
+
+    benchmark->frame_count++;
+    benchmark->last_frame_time = g_get_monotonic_time();
+}
+
+static void ui_benchmark_settle(void) {
+    gint64 start, quiet_since, now;
+
+    start = quiet_since = g_get_monotonic_time();
+
+    do {
+        now = g_get_monotonic_time();
+
+        if (g_main_context_iteration(NULL, FALSE)) {
+            quiet_since = now;
+        } else {
+            g_usleep(G_TIME_SPAN_MILLISECOND);
+        }
+    } while (now - quiet_since < UI_BENCHMARK_QUIET_TIME &&
+             now - start < UI_BENCHMARK_MAX_SETTLE_TIME);
+}
+
+static void ui_benchmark_run_operation(Ui_benchmark *benchmark,
+                                       Ui_benchmark_operation *operation,
+                                       guint iteration
+) {
+    gint64 start, call, settle;
+
+    if (operation->prepare != NULL) {
+        operation->prepare(operation->user_data, iteration);
+    }
+    ui_benchmark_settle();
+
+    benchmark->frame_count = 0;
+
+    start = g_get_monotonic_time();
+    operation->run(operation->user_data, iteration);
+    call = g_get_monotonic_time() - start;
+
+    ui_benchmark_settle();
+
+    // An operation that did not change anything on the screen is done
+    // when the call returns.
+    settle = benchmark->frame_count > 0 ? benchmark->last_frame_time - start : call;
+
+    operation->call_total += call;
+    operation->call_min = MIN(operation->call_min, call);
+    operation->call_max = MAX(operation->call_max, call);
+    operation->settle_total += settle;
+    operation->settle_min = MIN(operation->settle_min, settle);
+    operation->settle_max = MAX(operation->settle_max, settle);
+    operation->frames_total += benchmark->frame_count;
+    operation->iterations++;
+}
+
+static void ui_benchmark_print_operation(Ui_benchmark_operation *operation) {
+    if (operation->iterations == 0) {
+        return;
+    }
+
+    // All of the times are in milliseconds.
+    g_print(
+        "%-32s %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f %8.1f\n",
+        operation->name,
+        operation->call_total / 1000.0 / operation->iterations,
+        operation->call_min / 1000.0,
+        operation->call_max / 1000.0,
+        operation->settle_total / 1000.0 / operation->iterations,
+        operation->settle_min / 1000.0,
+        operation->settle_max / 1000.0,
+        (gdouble) operation->frames_total / operation->iterations
+    );
+}
+
+static void ui_benchmark_operation_free(gpointer data) {
+    Ui_benchmark_operation *operation = (Ui_benchmark_operation *) data;
+
+    g_free(operation->name);
+    g_slice_free(Ui_benchmark_operation, operation);
+}
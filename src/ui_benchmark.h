@@ -0,0 +1,17 @@
+#ifndef UI_BENCHMARK_H
+#define UI_BENCHMARK_H
+
+#include <gtk/gtk.h>
+
+typedef struct ui_benchmark_t Ui_benchmark;
+typedef void (*Ui_benchmark_func)(gpointer user_data, guint iteration);
+
+Ui_benchmark *ui_benchmark_create(GtkWidget *window);
+void ui_benchmark_destroy(Ui_benchmark *benchmark);
+void ui_benchmark_add(Ui_benchmark *benchmark, const gchar *name,
+                      Ui_benchmark_func prepare, Ui_benchmark_func run,
+                      gpointer user_data
+);
+void ui_benchmark_run(Ui_benchmark *benchmark, guint iterations);
+
+#endif
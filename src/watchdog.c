@@ -0,0 +1,227 @@
+#include <stdio.h>
+#include <errno.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include "watchdog.h"
+
+#define WATCHDOG_MAX_DEPTH 16
+#define WATCHDOG_NOW() ((guint) (g_get_monotonic_time() / 1000))
+
+// Detects the iterations of the default main loop that take longer than
+// the budget (in milliseconds).
+//
+// A source without file descriptors marks the loop as idle in prepare
+// (right before the poll) and as busy in check (right after the poll),
+// so a loop that is blocked in the poll is never reported. The watchdog
+// thread samples these marks and logs every stall together with the
+// instrumented callback (watchdog_enter/watchdog_leave) that was running:
+// once when it is detected, so a loop that never comes back still leaves
+// a trace, and again with the whole duration when the loop moves on.
+typedef struct watchdog_t {
+    guint budget;
+    FILE *log;
+    gboolean close_log;
+
+    volatile gint running;
+    volatile gint busy;
+    volatile gint iteration;
+    volatile gint busy_since;
+    gpointer volatile callback;
+
+    // Only used by the main thread.
+    const gchar *callbacks[WATCHDOG_MAX_DEPTH];
+    guint depth;
+
+    GSource *source;
+    GThread *thread;
+} Watchdog;
+
+static Watchdog *watchdog = NULL;
+
+static gboolean watchdog_source_prepare(GSource *source, gint *timeout);
+static gboolean watchdog_source_check(GSource *source);
+static gboolean watchdog_source_dispatch(GSource *source, GSourceFunc callback,
+                                         gpointer user_data
+);
+static gpointer watchdog_thread(gpointer user_data);
+static void watchdog_log_stall(Watchdog *data, guint duration, const gchar *callback_name,
+                               gboolean ended
+);
+
+static GSourceFuncs watchdog_source_funcs = {
+    watchdog_source_prepare,
+    watchdog_source_check,
+    watchdog_source_dispatch,
+    NULL,
+    NULL,
+    NULL
+};
+
+gboolean watchdog_start(guint budget, const gchar *log_path, GError **error) {
+    g_return_val_if_fail(budget > 0, FALSE);
+    g_return_val_if_fail(watchdog == NULL, FALSE);
+
+    FILE *log;
+
+    if (log_path == NULL || g_strcmp0(log_path, "-") == 0) {
+        log = stderr;
+    } else {
+        log = g_fopen(log_path, "a");
+
+        if (log == NULL) {
+            g_set_error(
+                error, G_FILE_ERROR, g_file_error_from_errno(errno),
+                "Could not open %s: %s", log_path, g_strerror(errno)
+            );
+            return FALSE;
+        }
+    }
+
+    watchdog = g_new0(Watchdog, 1);
+    watchdog->budget = budget;
+    watchdog->log = log;
+    watchdog->close_log = log != stderr;
+    watchdog->running = TRUE;
+
+    watchdog->source = g_source_new(&watchdog_source_funcs, sizeof(GSource));
+    g_source_set_name(watchdog->source, "watchdog");
+    // The main context skips the prepare and check of a source with a
+    // lower priority than one that is already ready, so the marks would
+    // be missed while the loop dispatches the default priority sources.
+    g_source_set_priority(watchdog->source, G_PRIORITY_HIGH);
+    g_source_attach(watchdog->source, NULL);
+
+    watchdog->thread = g_thread_new("watchdog", watchdog_thread, watchdog);
+
+    return TRUE;
+}
+
+void watchdog_stop(void) {
+    if (watchdog == NULL) {
+        return;
+    }
+
+    g_atomic_int_set(&watchdog->running, FALSE);
+    g_thread_join(watchdog->thread);
+
+    g_source_destroy(watchdog->source);
+    g_source_unref(watchdog->source);
+
+    if (watchdog->close_log) {
+        fclose(watchdog->log);
+    }
+
+    g_free(watchdog);
+    watchdog = NULL;
+}
+
+void watchdog_enter(const gchar *callback_name) {
+    if (watchdog == NULL) {
+        return;
+    }
+
+    if (watchdog->depth < WATCHDOG_MAX_DEPTH) {
+        watchdog->callbacks[watchdog->depth] = callback_name;
+    }
+    watchdog->depth++;
+
+    g_atomic_pointer_set(&watchdog->callback, (gpointer) callback_name);
+}
+
+void watchdog_leave(void) {
+    const gchar *callback_name = NULL;
+
+    if (watchdog == NULL || watchdog->depth == 0) {
+        return;
+    }
+
+    watchdog->depth--;
+    if (watchdog->depth > 0 && watchdog->depth <= WATCHDOG_MAX_DEPTH) {
+        callback_name = watchdog->callbacks[watchdog->depth - 1];
+    }
+
+    g_atomic_pointer_set(&watchdog->callback, (gpointer) callback_name);
+}
+
+static gboolean watchdog_source_prepare(G_GNUC_UNUSED GSource *source, gint *timeout) {
+    *timeout = -1;
+
+    g_atomic_int_set(&watchdog->busy, FALSE);
+    g_atomic_int_inc(&watchdog->iteration);
+
+    return FALSE;
+}
+
+static gboolean watchdog_source_check(G_GNUC_UNUSED GSource *source) {
+    g_atomic_int_set(&watchdog->busy_since, (gint) WATCHDOG_NOW());
+    g_atomic_int_set(&watchdog->busy, TRUE);
+
+    return FALSE;
+}
+
+static gboolean watchdog_source_dispatch(G_GNUC_UNUSED GSource *source,
+                                         G_GNUC_UNUSED GSourceFunc callback,
+                                         G_GNUC_UNUSED gpointer user_data
+) {
+    return G_SOURCE_CONTINUE;
+}
+
+static gpointer watchdog_thread(gpointer user_data) {
+    Watchdog *data = (Watchdog *) user_data;
+
+    guint now, busy_since;
+    gint iteration, stalled_iteration = 0;
+    gboolean busy, stalled = FALSE;
+    guint stall_since = 0;
+    const gchar *callback_name = NULL;
+
+    while (g_atomic_int_get(&data->running)) {
+        g_usleep(MAX(data->budget / 4, 1) * 1000);
+
+        now = WATCHDOG_NOW();
+        busy = g_atomic_int_get(&data->busy);
+        iteration = g_atomic_int_get(&data->iteration);
+        busy_since = (guint) g_atomic_int_get(&data->busy_since);
+
+        if (stalled) {
+            if (!busy || iteration != stalled_iteration) {
+                watchdog_log_stall(data, now - stall_since, callback_name, TRUE);
+                stalled = FALSE;
+            } else if (callback_name == NULL) {
+                callback_name = (const gchar *) g_atomic_pointer_get(&data->callback);
+            }
+        } else if (busy && now - busy_since > data->budget) {
+            stalled = TRUE;
+            stalled_iteration = iteration;
+            stall_since = busy_since;
+            callback_name = (const gchar *) g_atomic_pointer_get(&data->callback);
+            watchdog_log_stall(data, now - stall_since, callback_name, FALSE);
+        }
+    }
+
+    return NULL;
+}
+
+static void watchdog_log_stall(Watchdog *data, guint duration, const gchar *callback_name,
+                               gboolean ended
+) {
+    gchar *time_str;
+    GDateTime *date_time;
+
+    date_time = g_date_time_new_now_local();
+    time_str = g_date_time_format(date_time, "%F %T");
+
+    fprintf(
+        data->log,
+        ended ? "%s main loop stalled for %u ms (budget %u ms) in %s\n"
+              : "%s main loop stalled >%u ms (budget %u ms) in %s\n",
+        time_str,
+        duration,
+        data->budget,
+        callback_name != NULL ? callback_name : "an uninstrumented callback"
+    );
+    fflush(data->log);
+
+    g_free(time_str);
+    g_date_time_unref(date_time);
+}
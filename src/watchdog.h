@@ -0,0 +1,11 @@
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+#include <glib.h>
+
+gboolean watchdog_start(guint budget, const gchar *log_path, GError **error);
+void watchdog_stop(void);
+void watchdog_enter(const gchar *callback_name);
+void watchdog_leave(void);
+
+#endif
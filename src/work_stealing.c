@@ -0,0 +1,192 @@
+#include <glib.h>
+#include "work_stealing.h"
+
+// Splits count items into chunks and runs them on worker_count threads
+// (the calling thread is worker 0).
+//
+// Every worker starts with an equal, contiguous range of chunks and takes
+// them one by one from the front of its range. A worker that runs out of
+// chunks steals the back half of the range of another worker, so the
+// workers only touch each other's ranges when the load is unbalanced and
+// consecutive chunks mostly stay on the same worker.
+
+typedef struct work_stealing_range_t {
+    GMutex mutex;
+    guint64 begin;
+    guint64 end;
+} Work_stealing_range;
+
+typedef struct work_stealing_worker_t {
+    Work_stealing *pool;
+    guint index;
+} Work_stealing_worker;
+
+struct work_stealing_t {
+    guint worker_count;
+    Work_stealing_range *ranges;
+    Work_stealing_worker *workers;
+
+    // The current run.
+    guint64 count;
+    guint64 chunk_size;
+    Work_stealing_func func;
+    gpointer user_data;
+};
+
+static gpointer work_stealing_thread(gpointer user_data);
+static gboolean work_stealing_take(Work_stealing *pool, guint worker, guint64 *chunk);
+static gboolean work_stealing_steal(Work_stealing *pool, guint worker, guint64 *chunk);
+
+Work_stealing *work_stealing_create(guint worker_count) {
+    guint i;
+    Work_stealing *pool;
+
+    if (worker_count == 0) {
+        worker_count = g_get_num_processors();
+    }
+
+    pool = g_slice_new0(Work_stealing);
+    pool->worker_count = worker_count;
+    pool->ranges = g_new0(Work_stealing_range, worker_count);
+    pool->workers = g_new0(Work_stealing_worker, worker_count);
+
+    for (i = 0; i < worker_count; i++) {
+        g_mutex_init(&pool->ranges[i].mutex);
+        pool->workers[i].pool = pool;
+        pool->workers[i].index = i;
+    }
+
+    return pool;
+}
+
+void work_stealing_destroy(Work_stealing *pool) {
+    g_return_if_fail(pool != NULL);
+
+    guint i;
+
+    for (i = 0; i < pool->worker_count; i++) {
+        g_mutex_clear(&pool->ranges[i].mutex);
+    }
+
+    g_free(pool->workers);
+    g_free(pool->ranges);
+    g_slice_free(Work_stealing, pool);
+}
+
+guint work_stealing_get_worker_count(Work_stealing *pool) {
+    g_return_val_if_fail(pool != NULL, 0);
+
+    return pool->worker_count;
+}
+
+void work_stealing_run(Work_stealing *pool, guint64 count, guint64 chunk_size,
+                       Work_stealing_func func, gpointer user_data
+) {
+    g_return_if_fail(pool != NULL);
+    g_return_if_fail(chunk_size > 0);
+    g_return_if_fail(func != NULL);
+
+    guint i;
+    guint64 chunk_count;
+    GThread **threads;
+
+    if (count == 0) {
+        return;
+    }
+
+    pool->count = count;
+    pool->chunk_size = chunk_size;
+    pool->func = func;
+    pool->user_data = user_data;
+
+    chunk_count = (count + chunk_size - 1) / chunk_size;
+    for (i = 0; i < pool->worker_count; i++) {
+        pool->ranges[i].begin = chunk_count * i / pool->worker_count;
+        pool->ranges[i].end = chunk_count * (i + 1) / pool->worker_count;
+    }
+
+    threads = g_new(GThread *, pool->worker_count);
+    for (i = 1; i < pool->worker_count; i++) {
+        threads[i] = g_thread_new("worker", work_stealing_thread, &pool->workers[i]);
+    }
+
+    work_stealing_thread(&pool->workers[0]);
+
+    for (i = 1; i < pool->worker_count; i++) {
+        g_thread_join(threads[i]);
+    }
+
+    g_free(threads);
+}
+
+static gpointer work_stealing_thread(gpointer user_data) {
+    guint64 chunk;
+    guint64 first, last;
+    Work_stealing *pool;
+    Work_stealing_worker *worker = (Work_stealing_worker *) user_data;
+
+    pool = worker->pool;
+
+    while (work_stealing_take(pool, worker->index, &chunk) ||
+           work_stealing_steal(pool, worker->index, &chunk)) {
+        first = chunk * pool->chunk_size;
+        last = MIN(first + pool->chunk_size, pool->count);
+
+        pool->func(first, last, worker->index, pool->user_data);
+    }
+
+    return NULL;
+}
+
+static gboolean work_stealing_take(Work_stealing *pool, guint worker, guint64 *chunk) {
+    gboolean taken;
+    Work_stealing_range *range = &pool->ranges[worker];
+
+    g_mutex_lock(&range->mutex);
+
+    taken = range->begin < range->end;
+    if (taken) {
+        *chunk = range->begin++;
+    }
+
+    g_mutex_unlock(&range->mutex);
+
+    return taken;
+}
+
+static gboolean work_stealing_steal(Work_stealing *pool, guint worker, guint64 *chunk) {
+    guint i;
+    guint64 stolen_begin, stolen_end;
+    Work_stealing_range *victim;
+    Work_stealing_range *range = &pool->ranges[worker];
+
+    // No new chunks are ever added, so the run is over for this worker
+    // when all of the other ranges are empty.
+    for (i = 1; i < pool->worker_count; i++) {
+        victim = &pool->ranges[(worker + i) % pool->worker_count];
+
+        g_mutex_lock(&victim->mutex);
+
+        stolen_end = victim->end;
+        stolen_begin = victim->end - (victim->end - victim->begin) / 2;
+        if (stolen_begin == stolen_end && victim->begin < victim->end) {
+            // A single chunk is left.
+            stolen_begin = victim->begin;
+        }
+        victim->end = stolen_begin;
+
+        g_mutex_unlock(&victim->mutex);
+
+        if (stolen_begin < stolen_end) {
+            g_mutex_lock(&range->mutex);
+            range->begin = stolen_begin + 1;
+            range->end = stolen_end;
+            g_mutex_unlock(&range->mutex);
+
+            *chunk = stolen_begin;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
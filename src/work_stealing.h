@@ -0,0 +1,19 @@
+#ifndef WORK_STEALING_H
+#define WORK_STEALING_H
+
+#include <glib.h>
+
+typedef struct work_stealing_t Work_stealing;
+// Processes the items [first, last) of a single chunk on the given worker.
+typedef void (*Work_stealing_func)(guint64 first, guint64 last, guint worker,
+                                   gpointer user_data
+);
+
+Work_stealing *work_stealing_create(guint worker_count);
+void work_stealing_destroy(Work_stealing *pool);
+guint work_stealing_get_worker_count(Work_stealing *pool);
+void work_stealing_run(Work_stealing *pool, guint64 count, guint64 chunk_size,
+                       Work_stealing_func func, gpointer user_data
+);
+
+#endif